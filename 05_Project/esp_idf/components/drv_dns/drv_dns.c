@@ -14,6 +14,7 @@
 #include "drv_dns.h"
 
 #include <string.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -58,6 +59,8 @@ SemaphoreHandle_t flag_dns_busy = NULL;
 
 ip_addr_t ip_addr_found;
 
+portMUX_TYPE dns_request_mux = portMUX_INITIALIZER_UNLOCKED;
+
 /* *****************************************************************************
  * Prototype of functions definitions
  **************************************************************************** */
@@ -85,6 +88,109 @@ void dns_found_cb(const char *name, const ip_addr_t *ipaddr, void *callback_arg)
     }
 }
 
+void dns_request_cb(const char *name, const ip_addr_t *ipaddr, void *callback_arg)
+{
+    drv_dns_request_t* pRequest = (drv_dns_request_t*)callback_arg;
+    if (ipaddr == NULL)
+    {
+        ESP_LOGE(TAG, "DNS failed to refresh URL %s", name);
+    }
+    else
+    {
+        ip_addr_t ip_addr_resolved;
+        memcpy(&ip_addr_resolved, ipaddr, sizeof(ip_addr_t));
+        inet_ntoa_r(ip_addr_resolved, pRequest->cResolveIP, sizeof(pRequest->cResolveIP));
+        ESP_LOGI(TAG, "DNS refresh URL %s to IP Address: %s", name, pRequest->cResolveIP);
+        pRequest->bResolved = true;
+    }
+    pRequest->bBusy = false;
+    drv_dns_request_release(pRequest);      /* reference of the pending callback */
+}
+
+/* request with the reference of the caller */
+drv_dns_request_t* drv_dns_request_create(void)
+{
+    drv_dns_request_t* pRequest = malloc(sizeof(drv_dns_request_t));
+
+    if (pRequest != NULL)
+    {
+        memset(pRequest, 0, sizeof(drv_dns_request_t));
+        pRequest->u8References = 1;
+    }
+    return pRequest;
+}
+
+/* the owner releases instead of waiting for a pending resolve - freed by the callback then */
+void drv_dns_request_release(drv_dns_request_t* pRequest)
+{
+    bool bFree;
+
+    if (pRequest == NULL)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&dns_request_mux);
+    bFree = (--pRequest->u8References == 0);
+    portEXIT_CRITICAL(&dns_request_mux);
+    if (bFree)
+    {
+        free(pRequest);
+    }
+}
+
+/* 
+ * Start resolve without waiting and without clearing the DNS cache (entries expire by TTL).
+ * Result is in pRequest when bBusy gets cleared (bResolved set on success).
+ * Returns false if the request could not be started.
+ */
+bool drv_dns_resolve_async(drv_dns_request_t* pRequest, char* cName)
+{
+    ip_addr_t ip_addr_resolved;
+    bool bStarted = false;
+
+    if (pRequest->bBusy)
+    {
+        return true;
+    }
+
+    xSemaphoreTake(flag_dns_busy, portMAX_DELAY);
+    if (bInitializedDNS == false)
+    {
+        bInitializedDNS = true;
+        dns_init();
+    }
+    pRequest->bResolved = false;
+    pRequest->bBusy = true;
+    portENTER_CRITICAL(&dns_request_mux);
+    pRequest->u8References++;               /* kept by the callback */
+    portEXIT_CRITICAL(&dns_request_mux);
+    err_t resultDNS = dns_gethostbyname(cName, &ip_addr_resolved, dns_request_cb, pRequest);
+    if (resultDNS != ERR_INPROGRESS)
+    {
+        drv_dns_request_release(pRequest);  /* callback not called */
+    }
+    if (resultDNS == ERR_OK)
+    {
+        /* from cache - callback not called */
+        inet_ntoa_r(ip_addr_resolved, pRequest->cResolveIP, sizeof(pRequest->cResolveIP));
+        pRequest->bResolved = true;
+        pRequest->bBusy = false;
+        bStarted = true;
+    }
+    else if (resultDNS == ERR_INPROGRESS)
+    {
+        bStarted = true;
+    }
+    else
+    {
+        ESP_LOGE(TAG, "DNS refresh URL %s start failed %d", cName, resultDNS);
+        pRequest->bBusy = false;
+    }
+    xSemaphoreGive(flag_dns_busy);
+
+    return bStarted;
+}
+
 bool drv_dns_resolve(char* cName, char* cResolveIP, size_t nResolveIPSize, bool* waitResolve)
 {
     ip_addr_t ip_addr_resolved;
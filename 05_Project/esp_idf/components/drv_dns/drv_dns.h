@@ -20,6 +20,7 @@ extern "C"
  **************************************************************************** */
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
    
 /* *****************************************************************************
  * Configuration Definitions
@@ -36,6 +37,14 @@ extern "C"
 /* *****************************************************************************
  * Type Definitions
  **************************************************************************** */
+/* background resolve request - allocated by drv_dns_request_create, freed on the last release (owner or pending callback) */
+typedef struct
+{
+    volatile bool bBusy;                    // resolve in progress (callback pending)
+    volatile bool bResolved;                // cResolveIP valid
+    char cResolveIP[16];
+    uint8_t u8References;                   // owner and pending callback
+} drv_dns_request_t;
 
 /* *****************************************************************************
  * Function-Like Macro
@@ -49,6 +58,9 @@ extern "C"
  * Function Prototypes
  **************************************************************************** */
 bool drv_dns_resolve(char* cName, char* cResolveIP, size_t nResolveIPSize, bool* waitResolve);
+drv_dns_request_t* drv_dns_request_create(void);
+void drv_dns_request_release(drv_dns_request_t* pRequest);
+bool drv_dns_resolve_async(drv_dns_request_t* pRequest, char* cName);
 void drv_dns_init(void);
 
 
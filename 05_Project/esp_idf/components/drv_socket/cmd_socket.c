@@ -53,6 +53,15 @@
 static struct {
     struct arg_str *socket;
     struct arg_str *command;
+    struct arg_int *rate;
+    struct arg_int *burst;
+    struct arg_int *connection;
+    struct arg_int *interface;
+    struct arg_int *dscp;
+    struct arg_int *nodelay;
+    struct arg_int *sndbuf;
+    struct arg_int *rcvbuf;
+    struct arg_int *tune;
     struct arg_end *end;
 } socket_args;
 
@@ -88,6 +97,36 @@ static int update_socket(int argc, char **argv)
         drv_socket_list();
     }    
     else
+    if (strcmp(socket_command,"link") == 0)
+    {
+        drv_socket_link_print();
+    }
+    else
+    if ((strcmp(socket_command,"rate") == 0) && (strlen(socket_name) == 0))
+    {
+        if ((socket_args.interface->count > 0) && (socket_args.rate->count > 0))
+        {
+            int burst = (socket_args.burst->count > 0) ? socket_args.burst->ival[0] : 0;
+            if (drv_socket_set_interface_rate(socket_args.interface->ival[0], socket_args.rate->ival[0], burst) == false)
+            {
+                ESP_LOGE(TAG, "Error Interface %d not valid", socket_args.interface->ival[0]);
+            }
+        }
+        drv_socket_interface_rate_print();
+    }
+    else
+    if (((strcmp(socket_command,"stats") == 0) || (strcmp(socket_command,"reset") == 0)) && (strlen(socket_name) == 0))
+    {
+        if (strcmp(socket_command,"stats") == 0)
+        {
+            drv_socket_stats_print(NULL);
+        }
+        else
+        {
+            drv_socket_stats_reset(NULL);
+        }
+    }
+    else
     if (strlen(socket_name) > 0)
     {
         int index = drv_socket_get_position(socket_name);
@@ -106,6 +145,56 @@ static int update_socket(int argc, char **argv)
             {
                 drv_socket_disconnect(pSocket);
             }
+            else
+            if (strcmp(socket_command,"stats") == 0)
+            {
+                drv_socket_stats_print(pSocket);
+            }
+            else
+            if (strcmp(socket_command,"reset") == 0)
+            {
+                drv_socket_stats_reset(pSocket);
+            }
+            else
+            if (strcmp(socket_command,"rate") == 0)
+            {
+                if (socket_args.rate->count > 0)
+                {
+                    int burst = (socket_args.burst->count > 0) ? socket_args.burst->ival[0] : 0;
+                    if (socket_args.connection->count > 0)
+                    {
+                        if (drv_socket_set_connection_rate(pSocket, socket_args.connection->ival[0], socket_args.rate->ival[0], burst) == false)
+                        {
+                            ESP_LOGE(TAG, "Error Socket %s connection %d not active", socket_name, socket_args.connection->ival[0]);
+                        }
+                    }
+                    else
+                    {
+                        drv_socket_set_rate(pSocket, socket_args.rate->ival[0], burst);
+                    }
+                }
+                drv_socket_stats_print(pSocket);
+            }
+            else
+            if (strcmp(socket_command,"options") == 0)
+            {
+                drv_socket_options_t options;
+                drv_socket_get_options(pSocket, &options);
+                if ((socket_args.dscp->count > 0) || (socket_args.nodelay->count > 0) || (socket_args.sndbuf->count > 0) 
+                 || (socket_args.rcvbuf->count > 0) || (socket_args.tune->count > 0))
+                {
+                    if (socket_args.dscp->count > 0) options.u8Dscp = socket_args.dscp->ival[0];
+                    if (socket_args.nodelay->count > 0) options.bNoDelay = (socket_args.nodelay->ival[0] != 0);
+                    if (socket_args.sndbuf->count > 0) options.nSendBufferSize = socket_args.sndbuf->ival[0];
+                    if (socket_args.rcvbuf->count > 0) options.nRecvBufferSize = socket_args.rcvbuf->ival[0];
+                    if (socket_args.tune->count > 0) options.bBufferAutoTune = (socket_args.tune->ival[0] != 0);
+                    drv_socket_set_options(pSocket, &options);
+                }
+                ESP_LOGI(TAG, "Socket %s DSCP:%d NoDelay:%d KeepAlive:%s %d/%d/%d Linger:%s %d s SndBuf:%d RcvBuf:%d AutoTune:%d", 
+                    socket_name, options.u8Dscp, options.bNoDelay, options.bKeepAliveOff ? "off" : "on", 
+                    options.u16KeepAliveIdleS, options.u16KeepAliveIntervalS, options.u8KeepAliveCount, 
+                    options.bLinger ? "on" : "off", options.u16LingerS, options.nSendBufferSize, options.nRecvBufferSize, options.bBufferAutoTune);
+            }
         }
     }
     return 0;
@@ -114,8 +203,17 @@ static int update_socket(int argc, char **argv)
 static void register_socket(void)
 {
     socket_args.socket = arg_strn("s", "socket", "<socket>", 0, 1, "Command can be : socket [-s socket_name]");
-    socket_args.command = arg_strn(NULL, NULL, "<command>", 0, 1, "Command can be : socket {start|stop|list}");
-    socket_args.end = arg_end(4);
+    socket_args.command = arg_strn(NULL, NULL, "<command>", 0, 1, "Command can be : socket {start|stop|list|stats|reset|link|rate|options}");
+    socket_args.rate = arg_int0("r", "rate", "<bytes/s>", "Send limit for rate command (0 - no limit)");
+    socket_args.burst = arg_int0("b", "burst", "<bytes>", "Burst size for rate command (0 - default)");
+    socket_args.connection = arg_int0("c", "connection", "<index>", "Connection index for rate command (socket limit if not given)");
+    socket_args.interface = arg_int0("i", "interface", "<if>", "Adapter interface for rate command without socket (shared by all sockets)");
+    socket_args.dscp = arg_int0("d", "dscp", "<0..63>", "DSCP marking for options command");
+    socket_args.nodelay = arg_int0("n", "nodelay", "<0|1>", "TCP_NODELAY for options command");
+    socket_args.sndbuf = arg_int0(NULL, "sndbuf", "<bytes>", "SO_SNDBUF for options command (0 - stack default)");
+    socket_args.rcvbuf = arg_int0(NULL, "rcvbuf", "<bytes>", "SO_RCVBUF for options command (0 - stack default)");
+    socket_args.tune = arg_int0("t", "tune", "<0|1>", "Buffer auto-tune for options command");
+    socket_args.end = arg_end(12);
 
     const esp_console_cmd_t cmd_socket = {
         .command = "socket",
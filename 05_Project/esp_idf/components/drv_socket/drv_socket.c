@@ -12,8 +12,11 @@
  * Header Includes
  **************************************************************************** */
 #include "drv_socket.h"
+#include "drv_socket_match.h"
+#include "drv_socket_line.h"
 
 #include <stdint.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdbool.h>
 #include <string.h>
@@ -36,12 +39,21 @@
 #include "esp_interface.h"
 #include "esp_wifi.h"
 #include "esp_mac.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#if CONFIG_USE_ETHERNET
+#include "esp_eth.h"
+#endif
+#if CONFIG_SOCKET_EVENT_WAKEUP
+#include "esp_vfs_eventfd.h"
+#endif
 
 //#include "drv_system_if.h"
 #include "drv_eth_if.h"
 #include "drv_wifi_if.h"
 #include "drv_version_if.h"
 #include "drv_dns_if.h"
+#include "drv_trace_if.h"
 //#include "drv_console_if.h"
 
 /* *****************************************************************************
@@ -56,7 +68,62 @@
 
 #define DRV_SOCKET_TASK_REST_TIME_MS    10
 #define DRV_SOCKET_PING_SEND_TIME_MS    10000
-#define DRV_SOCKET_RECONNECT_TIME_MS    5000
+#ifndef CONFIG_SOCKET_HEARTBEAT_INTERVAL_MS
+#define CONFIG_SOCKET_HEARTBEAT_INTERVAL_MS 1000
+#endif
+#ifndef CONFIG_SOCKET_HEARTBEAT_MISS_COUNT
+#define CONFIG_SOCKET_HEARTBEAT_MISS_COUNT  3
+#endif
+#ifndef CONFIG_SOCKET_RECONNECT_BACKOFF_MIN_MS
+#define CONFIG_SOCKET_RECONNECT_BACKOFF_MIN_MS  500
+#endif
+#ifndef CONFIG_SOCKET_RECONNECT_BACKOFF_MAX_MS
+#define CONFIG_SOCKET_RECONNECT_BACKOFF_MAX_MS  60000
+#endif
+#ifndef CONFIG_SOCKET_SERVICE_QUANTUM
+#define CONFIG_SOCKET_SERVICE_QUANTUM   4096
+#endif
+#ifndef CONFIG_SOCKET_SERVICE_BUDGET_US
+#define CONFIG_SOCKET_SERVICE_BUDGET_US 20000
+#endif
+#ifndef CONFIG_SOCKET_BUFFER_TUNE_MAX
+#define CONFIG_SOCKET_BUFFER_TUNE_MAX   32768
+#endif
+#define DRV_SOCKET_BUFFER_TUNE_MIN      2920    /* two full segments */
+#define DRV_SOCKET_BUFFER_TUNE_MS       1000    /* measure period */
+#define DRV_SOCKET_PEER_IDLE_DEFAULT_S  60      /* UDP server peer idle time if u16PeerIdleS is 0 */
+#define DRV_SOCKET_PEER_IDLE_CHECK_MS   1000
+#define DRV_SOCKET_PEER_REPLACE_MS      1000    /* table full - a new peer replaces the longest idle one if idle at least this time */
+#define DRV_SOCKET_RATE_CHUNK_MIN       256     /* rate limited send waits for this many tokens (or all pending data) - no tiny segments */
+#define DRV_SOCKET_RECONNECT_FIRST_MS   100     /* first retry after a failure - jitter only */
+#define DRV_SOCKET_ENDPOINT_CACHE_TRIES 2       /* failed attempts before the cached endpoint is dropped and URL resolved again */
+#define DRV_SOCKET_INTERFACE_REFRESH_MS 1000    /* interface state re-query when the events are not registered */
+#define DRV_SOCKET_INTERFACE_WATCHDOG_MS 30000  /* interface state re-query with events (missed events only) */
+#define DRV_SOCKET_MIGRATE_RETRY_MS     5000    /* make-before-break retry after a failed attempt */
+#define DRV_SOCKET_MIGRATE_CONNECT_MS   10000   /* make-before-break connect timeout */
+#define DRV_SOCKET_MIGRATE_DRAIN_READS  8       /* make-before-break: reads of the old connection data before it is closed */
+#define DRV_SOCKET_STANDBY_RETRY_MS     5000    /* hot standby open retry after a failure */
+#define DRV_SOCKET_STANDBY_CONNECT_MS   10000   /* hot standby connect timeout */
+#define DRV_SOCKET_STANDBY_CHECK_MS     1000    /* hot standby liveness check period */
+#define DRV_SOCKET_DUAL_PATH_RETRY_MS   5000    /* path socket open retry after a failure */
+#define DRV_SOCKET_DUAL_PATH_RESYNC     1024    /* older sequence means the sender restarted */
+#define DRV_SOCKET_LINK_STALE_MS        30000   /* RTT/loss older than this are not scored */
+#define DRV_SOCKET_LINK_LOSS_WEIGHT     10      /* score per 1% loss */
+#define DRV_SOCKET_LINK_RSSI_GOOD       (-70)   /* no score below this signal level */
+#define DRV_SOCKET_LINK_RSSI_WEIGHT     10      /* score per dBm under DRV_SOCKET_LINK_RSSI_GOOD */
+#define DRV_SOCKET_LINK_RSSI_PERIOD_MS  1000
+
+#if (DRV_SOCKET_LINK_HISTORY_COUNT & (DRV_SOCKET_LINK_HISTORY_COUNT - 1)) != 0
+#error "DRV_SOCKET_LINK_HISTORY_COUNT must be a power of 2"
+#endif
+#define DRV_SOCKET_IDLE_WAKE_TIME_MS    1000    /* max select() sleep - adapter interface selection is still polled */
+#define DRV_SOCKET_IDENTIFY_TIMEOUT_MS  10000
+#define DRV_SOCKET_ACCEPT_LOG_TIME_MS   30000
+#define DRV_SOCKET_STATS_RATE_WINDOW_MS 1000
+
+#ifndef CONFIG_SOCKET_TRACE_LEVEL
+#define CONFIG_SOCKET_TRACE_LEVEL       DRV_TRACE_LEVEL_NONE
+#endif
 
 #define DRV_SOCKET_COUNT_MAX            10
 
@@ -75,6 +142,35 @@
 /* *****************************************************************************
  * Function-Like Macros
  **************************************************************************** */
+#define SOCKET_TRACE(nLevel, eEvent, pSocket, nConnectionIndex, nSocket, a1, a2) \
+    DRV_TRACE(CONFIG_SOCKET_TRACE_LEVEL, DRV_TRACE_COMPONENT_SOCKET, nLevel, eEvent, pSocket, ((uint32_t)(nConnectionIndex) << 16) | ((nSocket) & 0xFFFF), a1, a2)
+
+/* optional features (Kconfig) - a disabled feature is constant false and its branches are removed by the compiler */
+#if CONFIG_SOCKET_FEATURE_IDENTIFY
+#define SOCKET_IDENTIFY_FORCED(pSocket)         ((pSocket)->bIndentifyForced)
+#else
+#define SOCKET_IDENTIFY_FORCED(pSocket)         false
+#endif
+#if CONFIG_SOCKET_FEATURE_PING
+#define SOCKET_PING_USE(pSocket)                ((pSocket)->bPingUse)
+#else
+#define SOCKET_PING_USE(pSocket)                false
+#endif
+#if CONFIG_SOCKET_FEATURE_LINE_ENDING
+#define SOCKET_LINE_ENDING_FIX(pSocket)         ((pSocket)->bLineEndingFixCRLFToCR)
+#else
+#define SOCKET_LINE_ENDING_FIX(pSocket)         false
+#endif
+#if CONFIG_SOCKET_FEATURE_BROADCAST
+#define SOCKET_BROADCAST(pRuntime)              ((pRuntime)->bBroadcastRxTx)
+#else
+#define SOCKET_BROADCAST(pRuntime)              false
+#endif
+#if CONFIG_SOCKET_FEATURE_PREVENT_OVERFLOW
+#define SOCKET_PREVENT_OVERFLOW(pSocket)        ((pSocket)->bPreventOverflowReceivedData)
+#else
+#define SOCKET_PREVENT_OVERFLOW(pSocket)        false
+#endif
 
 /* *****************************************************************************
  * Variables Definitions
@@ -83,16 +179,110 @@ drv_socket_t * pSocketList[DRV_SOCKET_COUNT_MAX] = {NULL};
 int nSocketListCount = 0;
 int nSocketCountTotal = 0;
 
-TickType_t nReconnectTimeTicks = pdMS_TO_TICKS(DRV_SOCKET_RECONNECT_TIME_MS);
 TickType_t nTaskRestTimeTicks = pdMS_TO_TICKS(DRV_SOCKET_TASK_REST_TIME_MS);
 
 uint8_t last_mac_addr_on_identification_request[6] = {0};
 
+#if CONFIG_SOCKET_FEATURE_IDENTIFY
+/* identify requests detected over the received stream (pattern index = socket_identify_pattern_t) */
+typedef enum
+{
+    SOCKET_IDENTIFY_PATTERN_MAN_MAC,
+    SOCKET_IDENTIFY_PATTERN_MAN_VER,
+    SOCKET_IDENTIFY_PATTERN_BINARY,
+    SOCKET_IDENTIFY_PATTERN_COUNT
+} socket_identify_pattern_t;
+
+const uint8_t au8IdentifyRequestBinary[DRV_SOCKET_IDENTIFY_REQUEST_SIZE] = {DRV_SOCKET_IDENTIFY_MAGIC_0, DRV_SOCKET_IDENTIFY_MAGIC_1, DRV_SOCKET_IDENTIFY_MAGIC_2, DRV_SOCKET_IDENTIFY_REQUEST};
+const drv_socket_match_pattern_t asIdentifyPattern[SOCKET_IDENTIFY_PATTERN_COUNT] = 
+{
+    {(const uint8_t*)"man mac", 7},
+    {(const uint8_t*)"man ver", 7},
+    {au8IdentifyRequestBinary, DRV_SOCKET_IDENTIFY_REQUEST_SIZE},
+};
+typedef enum
+{
+    SOCKET_IDENTIFY_MATCH_NONE,
+    SOCKET_IDENTIFY_MATCH_BUILDING,
+    SOCKET_IDENTIFY_MATCH_BUILT,
+    SOCKET_IDENTIFY_MATCH_FAILED,
+} socket_identify_match_state_t;
+
+/* shared by all sockets - built once (drv_socket_init or the first socket task), read only afterwards */
+drv_socket_match_t identifyMatch;
+volatile socket_identify_match_state_t eIdentifyMatchState = SOCKET_IDENTIFY_MATCH_NONE;
+portMUX_TYPE identify_match_mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+#if CONFIG_SOCKET_EVENT_WAKEUP
+bool bSocketEventFdRegistered = false;
+#endif
+/* drv_socket_wake() from other tasks against the wake eventfd close and the runtime free */
+portMUX_TYPE wake_mux = portMUX_INITIALIZER_UNLOCKED;
+
+drv_socket_connection_t asConnectionPool[DRV_SOCKET_CONNECTION_POOL_SIZE];
+drv_socket_connection_t* pConnectionPoolFree = NULL;
+int nConnectionPoolUsed = 0;
+bool bConnectionPoolInitialized = false;
+portMUX_TYPE connection_pool_mux = portMUX_INITIALIZER_UNLOCKED;
+/* generation of the last added connection (under connection_pool_mux) - not reset on task restart, old handles stay stale */
+uint16_t u16ConnectionGeneration = 0;
+
+/* interface connected state cache (bit = esp_interface_t) - updated on netif/IP events, read by the socket tasks */
+uint32_t u32InterfaceUpMask = 0;
+volatile uint32_t u32InterfaceDirtyMask = 0xFFFFFFFF;     /* interfaces to re-query (all at start) */
+volatile int64_t s64InterfaceEventUs = 0;
+TickType_t nInterfaceRefreshTicks = 0;
+uint32_t u32InterfaceStateGeneration = 0;       /* incremented on a u32InterfaceUpMask change - the socket tasks re-evaluate their interface */
+bool bInterfaceEventsRegistered = false;
+bool bInterfaceEventsActive = false;            /* handlers registered - the periodic re-query is a watchdog only */
+portMUX_TYPE interface_state_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* link quality per interface (index = esp_interface_t) and interface decision history - shared by all sockets */
+drv_socket_link_quality_t asLinkQuality[DRV_SOCKET_INTERFACE_COUNT_MAX];
+drv_socket_link_decision_t asLinkDecision[DRV_SOCKET_LINK_HISTORY_COUNT];
+uint32_t u32LinkDecisionCount = 0;
+TickType_t nLinkRssiTicks = 0;          /* last Wi-Fi signal read (any socket task) */
+portMUX_TYPE link_quality_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* send limit per interface (index = esp_interface_t) shared by all sockets, all rate buckets are updated under rate_mux */
+drv_socket_rate_t asInterfaceRate[DRV_SOCKET_INTERFACE_COUNT_MAX];
+portMUX_TYPE rate_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* drv_socket_t options written by the application tasks */
+portMUX_TYPE options_mux = portMUX_INITIALIZER_UNLOCKED;
+
 /* *****************************************************************************
  * Prototype of functions definitions
  **************************************************************************** */
 void socket_set_options(drv_socket_t* pSocket, int nConnectionIndex);
+void socket_set_fd_options(drv_socket_t* pSocket, int nConnectionIndex, int nSocket);
+void socket_buffer_tune(void* pArg, int nArg);
+drv_socket_link_quality_t* socket_link_get(esp_interface_t adapter_if);
+void socket_reconnect_schedule(drv_socket_t* pSocket);
+void socket_reconnect_success(drv_socket_t* pSocket);
+void socket_standby_close(drv_socket_t* pSocket);
+void socket_dual_path_close(drv_socket_t* pSocket);
+void socket_migrate_close(drv_socket_t* pSocket);
+bool socket_dual_path_active(drv_socket_t* pSocket);
+bool socket_dual_path_receive(drv_socket_t* pSocket, uint8_t u8Path, uint8_t* pData, int* pLength);
+bool socket_dual_path_receive_peer(drv_socket_t* pSocket, uint8_t* pData, int* pLength);
+void socket_dual_path_header(drv_socket_t* pSocket, uint8_t* pHeader, uint8_t u8Path);
+void socket_dual_path_send(drv_socket_t* pSocket, uint8_t* pData, int nLength, bool bActiveSent);
 void socket_on_connect(drv_socket_t* pSocket, int nConnectionIndex);
+void socket_connection_timers_stop(drv_socket_t* pSocket, drv_socket_connection_t* pConnection);
+void socket_io_select(drv_socket_t* pSocket);
+int socket_pipeline_run(drv_socket_t* pSocket, drv_socket_stage_direction_t eDirection, int nConnectionIndex, uint8_t* pData, int nLength, int nSize);
+void socket_heartbeat_init(drv_socket_t* pSocket, int nConnectionIndex);
+void socket_heartbeat(void* pArg, int nConnectionIndex);
+int socket_heartbeat_filter(drv_socket_t* pSocket, int nConnectionIndex, uint8_t* pData, int nLength);
+int socket_heartbeat_record_size(drv_socket_t* pSocket);
+void socket_heartbeat_record(uint8_t* pHeader, int nLength);
+void socket_dgram_recv(drv_socket_t* pSocket, int nConnectionIndex);
+void socket_dgram_send(drv_socket_t* pSocket, int nConnectionIndex);
+void socket_segment_count(drv_socket_t* pSocket, int nLength);
+void socket_peer_unlink(drv_socket_t* pSocket, int nConnectionIndex);
+void socket_peer_idle(void* pArg, int nArg);
 
 /* *****************************************************************************
  * Functions
@@ -148,1368 +338,5425 @@ drv_socket_t* drv_socket_get_handle(const char* name)
     return result;
 }
 
-void socket_connection_remove_from_list(drv_socket_t* pSocket, int nConnectionIndex)
+void socket_connection_pool_init(void)
 {
-    for (int nIndex = nConnectionIndex + 1 ; nIndex < pSocket->nSocketConnectionsCount; nIndex++)
-    {
-        pSocket->nSocketIndexPrimer[nIndex - 1] = pSocket->nSocketIndexPrimer[nIndex];
-    }
-    pSocket->nSocketConnectionsCount--;
-    if (pSocket->nSocketConnectionsCount == 0)
+    portENTER_CRITICAL(&connection_pool_mux);
+    if (bConnectionPoolInitialized == false)
     {
-        if (pSocket->bServerType)
-        {
-            /* closed server socket and 0 client connections available - do nothing (periodic client connect will be used) */
-        }
-        else
+        bConnectionPoolInitialized = true;
+        pConnectionPoolFree = NULL;
+        for (int nIndex = DRV_SOCKET_CONNECTION_POOL_SIZE - 1; nIndex >= 0; nIndex--)
         {
-            pSocket->bConnected = false;    /* disconnect the client socket */
+            asConnectionPool[nIndex].nSocket = -1;
+            asConnectionPool[nIndex].pPoolNext = pConnectionPoolFree;
+            pConnectionPoolFree = &asConnectionPool[nIndex];
         }
     }
+    portEXIT_CRITICAL(&connection_pool_mux);
+}
+
+drv_socket_connection_t* socket_connection_pool_alloc(void)
+{
+    drv_socket_connection_t* pConnection;
+
+    socket_connection_pool_init();
+
+    portENTER_CRITICAL(&connection_pool_mux);
+    pConnection = pConnectionPoolFree;
+    if (pConnection != NULL)
+    {
+        pConnectionPoolFree = pConnection->pPoolNext;
+        pConnection->pPoolNext = NULL;
+        nConnectionPoolUsed++;
+    }
+    portEXIT_CRITICAL(&connection_pool_mux);
+    return pConnection;
 }
 
-bool socket_connection_add_to_list(drv_socket_t* pSocket, int nSocketIndex)
+void socket_connection_pool_free(drv_socket_connection_t* pConnection)
 {
-    if (pSocket->nSocketConnectionsCount < DRV_SOCKET_MAX_CLIENTS)
+    /* drop data left in the own streams (application streams are left to the application) */
+    if (pConnection->sSendStream.flag_available != NULL)
     {
-        pSocket->nSocketIndexPrimer[pSocket->nSocketConnectionsCount] = nSocketIndex;
-        socket_set_options(pSocket, pSocket->nSocketConnectionsCount);
-        socket_on_connect(pSocket, pSocket->nSocketConnectionsCount);
-        pSocket->nSocketConnectionsCount++;
-        return true;
+        drv_stream_pull(&pConnection->sSendStream, NULL, drv_stream_get_size(&pConnection->sSendStream));
+    }
+    if (pConnection->sRecvStream.flag_available != NULL)
+    {
+        drv_stream_pull(&pConnection->sRecvStream, NULL, drv_stream_get_size(&pConnection->sRecvStream));
+    }
+    drv_stream_set_on_push(pConnection->pSendStream, NULL, NULL);
+    free(pConnection->pSendHeld);
+    pConnection->pSendHeld = NULL;
+    pConnection->pSendStream = NULL;
+    pConnection->pRecvStream = NULL;
+    pConnection->nSocket = -1;
+
+    portENTER_CRITICAL(&connection_pool_mux);
+    pConnection->pPoolNext = pConnectionPoolFree;
+    pConnectionPoolFree = pConnection;
+    nConnectionPoolUsed--;
+    portEXIT_CRITICAL(&connection_pool_mux);
+}
+
+void socket_peer_from_sockaddr(drv_socket_peer_t* pPeer, struct sockaddr_storage* pAddr)
+{
+    memset(pPeer, 0, sizeof(drv_socket_peer_t));
+    if (pAddr == NULL)
+    {
+        pPeer->u8Family = AF_UNSPEC;
+    }
+    else if (pAddr->ss_family == AF_INET)
+    {
+        struct sockaddr_in* pAddrIPv4 = (struct sockaddr_in*)pAddr;
+        pPeer->u8Family = AF_INET;
+        pPeer->u16Port = ntohs(pAddrIPv4->sin_port);
+        pPeer->u32IPv4 = pAddrIPv4->sin_addr.s_addr;
+    }
+    #if LWIP_IPV6
+    else if (pAddr->ss_family == AF_INET6)
+    {
+        struct sockaddr_in6* pAddrIPv6 = (struct sockaddr_in6*)pAddr;
+        pPeer->u8Family = AF_INET6;
+        pPeer->u16Port = ntohs(pAddrIPv6->sin6_port);
+        memcpy(pPeer->au8IPv6, &pAddrIPv6->sin6_addr, sizeof(pPeer->au8IPv6));
     }
+    #endif
     else
     {
-        ESP_LOGE(TAG, "Connecting Failure (Max Clients Reached) client to socket %s %d", pSocket->cName, nSocketIndex);
-        return false;
+        pPeer->u8Family = AF_UNSPEC;
     }
 }
 
+/* false - no address (AF_UNSPEC or family not supported) */
+bool socket_peer_to_sockaddr(const drv_socket_peer_t* pPeer, struct sockaddr_storage* pAddr, socklen_t* pAddrLen)
+{
+    memset(pAddr, 0, sizeof(struct sockaddr_storage));
+    if (pPeer->u8Family == AF_INET)
+    {
+        struct sockaddr_in* pAddrIPv4 = (struct sockaddr_in*)pAddr;
+        pAddrIPv4->sin_family = AF_INET;
+        pAddrIPv4->sin_port = htons(pPeer->u16Port);
+        pAddrIPv4->sin_addr.s_addr = pPeer->u32IPv4;
+        *pAddrLen = sizeof(struct sockaddr_in);
+        return true;
+    }
+    #if LWIP_IPV6
+    if (pPeer->u8Family == AF_INET6)
+    {
+        struct sockaddr_in6* pAddrIPv6 = (struct sockaddr_in6*)pAddr;
+        pAddrIPv6->sin6_family = AF_INET6;
+        pAddrIPv6->sin6_port = htons(pPeer->u16Port);
+        memcpy(&pAddrIPv6->sin6_addr, pPeer->au8IPv6, sizeof(pPeer->au8IPv6));
+        *pAddrLen = sizeof(struct sockaddr_in6);
+        return true;
+    }
+    #endif
+    return false;
+}
 
-void socket_disconnect_connection(drv_socket_t* pSocket, int nConnectionIndex)
+/* allocate the runtime together with the connection slot table sized for the socket type */
+drv_socket_runtime_t* socket_runtime_alloc(drv_socket_t* pSocket)
 {
-    int err;
+    int nSlotCount = pSocket->bServerType ? DRV_SOCKET_MAX_CLIENTS : 1;
+    size_t nSize = sizeof(drv_socket_runtime_t)
+                 + nSlotCount * (sizeof(drv_socket_connection_t*) + sizeof(uint16_t) + 4 * sizeof(uint8_t));
+    uint8_t* pMemory = malloc(nSize);
 
-    if (nConnectionIndex < pSocket->nSocketConnectionsCount)
+    if (pMemory == NULL)
     {
-        ESP_LOGE(TAG, "Disconnecting client %d socket %s %d", nConnectionIndex, pSocket->cName, pSocket->nSocketIndexPrimer[nConnectionIndex]);
-        if(shutdown(pSocket->nSocketIndexPrimer[nConnectionIndex], SHUT_RDWR) != 0)
-        {
-            err = errno;
-            ESP_LOGE(TAG, "Error shutdown client %d socket %s %d: errno %d (%s)", nConnectionIndex, pSocket->cName, pSocket->nSocketIndexPrimer[nConnectionIndex], err, strerror(err));
-        }
-        if(close(pSocket->nSocketIndexPrimer[nConnectionIndex]) != 0)
-        {
-            err = errno;
-            ESP_LOGE(TAG, "Error close client %d socket %s %d: errno %d (%s)", nConnectionIndex, pSocket->cName, pSocket->nSocketIndexPrimer[nConnectionIndex], err, strerror(err));     
-        }
-        pSocket->nSocketIndexPrimer[nConnectionIndex] = -1;
-        socket_connection_remove_from_list(pSocket, nConnectionIndex);
+        return NULL;
     }
+    memset(pMemory, 0, nSize);
+
+    drv_socket_runtime_t* pRuntime = (drv_socket_runtime_t*)pMemory;
+    pMemory += sizeof(drv_socket_runtime_t);
+    pRuntime->nSlotCount = nSlotCount;
+    pRuntime->apConnection = (drv_socket_connection_t**)pMemory;
+    pMemory += nSlotCount * sizeof(drv_socket_connection_t*);
+    pRuntime->au16Generation = (uint16_t*)pMemory;
+    pMemory += nSlotCount * sizeof(uint16_t);
+    pRuntime->au8ConnectionSlot = pMemory;
+    pMemory += nSlotCount;
+    pRuntime->au8ConnectionPosition = pMemory;
+    pMemory += nSlotCount;
+    pRuntime->au8FreeSlot = pMemory;
+    pMemory += nSlotCount;
+    pRuntime->au8PeerNext = pMemory;
+    return pRuntime;
 }
 
-
-void socket_disconnect(drv_socket_t* pSocket)
+void socket_connection_table_init(drv_socket_t* pSocket)
 {
-    int err;
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
 
-    if (pSocket->bServerType)
+    pSocket->nSocketConnectionsCount = 0;
+    pRuntime->nFreeSlotCount = pRuntime->nSlotCount;
+    for (int nSlot = 0; nSlot < pRuntime->nSlotCount; nSlot++)
     {
-        while (pSocket->nSocketConnectionsCount)
-        {
-            socket_disconnect_connection(pSocket, 0);   /* Start Removing From Socket Client Connection Index 0 */
-        }
-        if (pSocket->nSocketIndexServer >= 0)
-        {
-            ESP_LOGE(TAG, "Disconnecting server socket %s %d", pSocket->cName, pSocket->nSocketIndexServer);
-            if(shutdown(pSocket->nSocketIndexServer, SHUT_RDWR) != 0)
-            {
-                err = errno;
-                ESP_LOGE(TAG, "Error shutdown server socket %s %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));
-            }
-            if(close(pSocket->nSocketIndexServer) != 0)
-            {
-                err = errno;
-                ESP_LOGE(TAG, "Error close server socket %s %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));     
-            }
-            pSocket->nSocketIndexServer = -1;
-        }
+        pRuntime->au8FreeSlot[nSlot] = pRuntime->nSlotCount - 1 - nSlot;  /* slot 0 on top */
+        pRuntime->au8ConnectionPosition[nSlot] = DRV_SOCKET_SLOT_FREE;
+        pRuntime->apConnection[nSlot] = NULL;
     }
-    else
+    memset(pRuntime->au8PeerHash, DRV_SOCKET_SLOT_FREE, sizeof(pRuntime->au8PeerHash));
+}
+
+drv_socket_connection_t* socket_connection_get(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    return pSocket->pRuntime->apConnection[nConnectionIndex];
+}
+
+bool socket_connection_active(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    if ((nConnectionIndex < 0) || (nConnectionIndex >= pSocket->pRuntime->nSlotCount)) return false;
+    return pSocket->pRuntime->au8ConnectionPosition[nConnectionIndex] != DRV_SOCKET_SLOT_FREE;
+}
+
+/* slot of the n-th active connection */
+int socket_connection_slot(drv_socket_t* pSocket, int nPosition)
+{
+    return pSocket->pRuntime->au8ConnectionSlot[nPosition];
+}
+
+drv_socket_connection_handle_t drv_socket_get_connection_handle(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    if ((pSocket->pRuntime == NULL) || (socket_connection_active(pSocket, nConnectionIndex) == false))
     {
-        while (pSocket->nSocketConnectionsCount)
-        {
-            socket_disconnect_connection(pSocket, 0);   /* Start Removing From Socket Client Connection Index 0 */
-            if (pSocket->onDisconnect != NULL)
-            {
-                pSocket->onDisconnect(0);
-            }
-        }
-        
-        if (pSocket->nSocketIndexServer >= 0)
-        {
-            ESP_LOGE(TAG, "Disconnecting unused socket %s %d", pSocket->cName, pSocket->nSocketIndexServer);
-            if(shutdown(pSocket->nSocketIndexServer, SHUT_RDWR) != 0)
-            {
-                err = errno;
-                ESP_LOGE(TAG, "Error shutdown unused socket %s %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));
-            }
-            if(close(pSocket->nSocketIndexServer) != 0)
-            {
-                err = errno;
-                ESP_LOGE(TAG, "Error close unused socket %s %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));     
-            }
-            pSocket->nSocketIndexServer = -1;
-        }
+        return DRV_SOCKET_CONNECTION_HANDLE_INVALID;
     }
-    pSocket->bConnected = false;
+    return ((uint32_t)pSocket->pRuntime->au16Generation[nConnectionIndex] << 16) | (uint32_t)nConnectionIndex;
 }
 
-void drv_socket_disconnect(drv_socket_t* pSocket)
+/* returns connection index or -1 if the handle is stale (connection closed) */
+int drv_socket_get_connection_index(drv_socket_t* pSocket, drv_socket_connection_handle_t hConnection)
 {
-    pSocket->bDisconnectRequest = true;
+    int nConnectionIndex = hConnection & 0xFFFF;
+    uint16_t u16Generation = hConnection >> 16;
+
+    if ((pSocket->pRuntime == NULL) || (socket_connection_active(pSocket, nConnectionIndex) == false))
+    {
+        return -1;
+    }
+    if (pSocket->pRuntime->au16Generation[nConnectionIndex] != u16Generation)
+    {
+        return -1;
+    }
+    return nConnectionIndex;
 }
 
-void socket_if_get_mac(drv_socket_t* pSocket, uint8_t mac_addr[6])
+drv_stream_t* drv_socket_get_send_stream(drv_socket_t* pSocket, int nConnectionIndex)
 {
-    if (pSocket->pRuntime->adapter_if == ESP_IF_WIFI_STA)
+    if ((pSocket->pRuntime == NULL) || (socket_connection_active(pSocket, nConnectionIndex) == false))
     {
-        esp_wifi_get_mac(ESP_IF_WIFI_STA, mac_addr);
-        ESP_LOGI(pSocket->cName, "Adapter Interface: %s", "Wifi Station");   
+        return NULL;
     }
-    else if (pSocket->pRuntime->adapter_if == ESP_IF_WIFI_AP)
+    return socket_connection_get(pSocket, nConnectionIndex)->pSendStream;
+}
+
+drv_stream_t* drv_socket_get_recv_stream(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    if ((pSocket->pRuntime == NULL) || (socket_connection_active(pSocket, nConnectionIndex) == false))
     {
-        esp_wifi_get_mac(ESP_IF_WIFI_AP, mac_addr);
-        ESP_LOGI(pSocket->cName, "Adapter Interface: %s", "Wifi Soft-AP");   
+        return NULL;
     }
-    else if (pSocket->pRuntime->adapter_if >= ESP_IF_ETH)
+    return socket_connection_get(pSocket, nConnectionIndex)->pRecvStream;
+}
+
+bool drv_socket_get_connection_peer(drv_socket_t* pSocket, int nConnectionIndex, drv_socket_peer_t* pPeer)
+{
+    if ((pSocket->pRuntime == NULL) || (socket_connection_active(pSocket, nConnectionIndex) == false))
     {
-        #if CONFIG_USE_ETHERNET
-        int eth_index = pSocket->pRuntime->adapter_if - ESP_IF_ETH;
-        if (drv_eth_get_netif_count() > eth_index)
-        {
-            drv_eth_get_mac(eth_index, mac_addr);
-            ESP_LOGI(pSocket->cName, "Adapter Interface: %s", "EthernetLAN");    
-        }
-        else
-        #endif
-        {
-            ESP_LOGE(pSocket->cName, "Adapter Interface: %s", "Unimplemented");    //to do fix for default if needed
-        } 
+        return false;
     }
+    *pPeer = socket_connection_get(pSocket, nConnectionIndex)->peer;
+    return true;
 }
 
-bool send_identification_answer(drv_socket_t* pSocket, int nConnectionIndex)
-{   
-    bool bResult = false;
-
-    /* Get MAC */
-    uint8_t mac_addr[6] = {0};
-    socket_if_get_mac(pSocket, mac_addr);
+/* connection identified (or identification not used) - send stream is transmitted */
+bool drv_socket_get_send_enable(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    if ((pSocket->pRuntime == NULL) || (socket_connection_active(pSocket, nConnectionIndex) == false))
+    {
+        return false;
+    }
+    return socket_connection_get(pSocket, nConnectionIndex)->bSendEnable;
+}
 
-    //ESP_LOGI(TAG, "!!!!!!!!!!!!!!!: %s", "?????????????");  
+/* weight 1..255 - CONFIG_SOCKET_SERVICE_QUANTUM bytes per round each (reset to 1 on connect, set it from onConnect) */
+bool drv_socket_set_connection_weight(drv_socket_t* pSocket, int nConnectionIndex, uint8_t u8Weight)
+{
+    if ((pSocket->pRuntime == NULL) || (socket_connection_active(pSocket, nConnectionIndex) == false) || (u8Weight == 0))
+    {
+        return false;
+    }
+    socket_connection_get(pSocket, nConnectionIndex)->u8Weight = u8Weight;
+    return true;
+}
 
-    #define MACSTR_U_r "%02X:%02X:%02X:%02X:%02X:%02X\r"
-    ESP_LOGI(TAG, "MAC Address "MACSTR_U_r, MAC2STR(mac_addr));
-    
-    char cTemp[64];
+/* rate 0 - no limit; also used as the initial limit on the next task start */
+void drv_socket_set_rate(drv_socket_t* pSocket, uint32_t u32RateBps, uint32_t u32BurstBytes)
+{
+    portENTER_CRITICAL(&rate_mux);
+    pSocket->u32RateLimitBps = u32RateBps;
+    pSocket->u32RateBurstBytes = u32BurstBytes;
+    if (pSocket->pRuntime != NULL)
+    {
+        drv_socket_rate_init(&pSocket->pRuntime->rate, u32RateBps, u32BurstBytes, esp_timer_get_time());
+    }
+    portEXIT_CRITICAL(&rate_mux);
+}
 
-    sprintf(cTemp, MACSTR_U_r "MAC:" MACSTR_U_r "Version:%d.%d.%05d\r", 
-                MAC2STR(mac_addr), MAC2STR(mac_addr), 
-                DRV_VERSION_MAJOR, DRV_VERSION_MINOR, DRV_VERSION_BUILD);
+bool drv_socket_set_connection_rate(drv_socket_t* pSocket, int nConnectionIndex, uint32_t u32RateBps, uint32_t u32BurstBytes)
+{
+    if ((pSocket->pRuntime == NULL) || (socket_connection_active(pSocket, nConnectionIndex) == false))
+    {
+        return false;
+    }
+    portENTER_CRITICAL(&rate_mux);
+    drv_socket_rate_init(&socket_connection_get(pSocket, nConnectionIndex)->rate, u32RateBps, u32BurstBytes, esp_timer_get_time());
+    portEXIT_CRITICAL(&rate_mux);
+    return true;
+}
 
-    int err;
-    int nSocketClient = pSocket->nSocketIndexPrimer[nConnectionIndex];
-    int nLength = strlen(cTemp);  
-    int nLengthSent = send(nSocketClient, (uint8_t*)cTemp, nLength, 0);
-    
-    if (nLengthSent > 0)
+/* shared by all sockets on the interface */
+bool drv_socket_set_interface_rate(esp_interface_t adapter_if, uint32_t u32RateBps, uint32_t u32BurstBytes)
+{
+    if ((adapter_if < 0) || (adapter_if >= DRV_SOCKET_INTERFACE_COUNT_MAX))
     {
-        if (nLengthSent != nLength)
-        {
-            ESP_LOGE(TAG, "Error during send id to socket %s[%d] %d: send %d/%d bytes", pSocket->cName, nConnectionIndex, nSocketClient, nLengthSent, nLength);
-            //socket_disconnect(pSocket);
-            socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
-        }
-        else
-        {
-            ESP_LOGI(TAG, "Success send id to socket %s[%d] %d: sent %d bytes", pSocket->cName, nConnectionIndex, nSocketClient, nLengthSent);
-            bResult = true;
-        }
+        return false;
     }
-    else
+    portENTER_CRITICAL(&rate_mux);
+    drv_socket_rate_init(&asInterfaceRate[adapter_if], u32RateBps, u32BurstBytes, esp_timer_get_time());
+    portEXIT_CRITICAL(&rate_mux);
+    return true;
+}
+
+void drv_socket_interface_rate_print(void)
+{
+    for (int index = 0; index < DRV_SOCKET_INTERFACE_COUNT_MAX; index++)
     {
-        err = errno;
-        //if (err != EAGAIN)
+        drv_socket_rate_t sRate;
+        portENTER_CRITICAL(&rate_mux);
+        sRate = asInterfaceRate[index];
+        portEXIT_CRITICAL(&rate_mux);
+        if (sRate.u32RateBps || sRate.u64Bytes)
         {
-            ESP_LOGE(TAG, "Error during send id to socket %s[%d] %d: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocketClient, err, strerror(err));
-            //socket_disconnect(pSocket);
-            socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+            ESP_LOGI(TAG, "Rate IF %d Limit:%" PRIu32 " B/s Burst:%" PRIu32 " bytes Sent:%llu bytes Throttled:%" PRIu32, 
+                index, sRate.u32RateBps, sRate.u32BurstBytes, sRate.u64Bytes, sRate.u32Throttled);
         }
     }
-
-    return bResult;
 }
 
-bool socket_identification_answer(drv_socket_t* pSocket, int nConnectionIndex, char* pData, int size)
+/* socket, connection and interface buckets of a send */
+int socket_rate_buckets(drv_socket_t* pSocket, drv_socket_connection_t* pConnection, drv_socket_rate_t** apRate)
 {
-    bool bResult = false;
+    int nCount = 0;
 
-    if(memcmp(pData,"man mac", strlen("man mac")) == 0)
+    apRate[nCount++] = &pSocket->pRuntime->rate;
+    apRate[nCount++] = &pConnection->rate;
+    if ((pSocket->pRuntime->adapter_if >= 0) && (pSocket->pRuntime->adapter_if < DRV_SOCKET_INTERFACE_COUNT_MAX))
     {
-        bResult = send_identification_answer(pSocket, nConnectionIndex);
-        bResult = false; //indicate here that the identification answer is not complete, because after that version ask is expected
+        apRate[nCount++] = &asInterfaceRate[pSocket->pRuntime->adapter_if];
     }
-    else
-    if(memcmp(pData,"man ver", strlen("man ver")) == 0)
+    return nCount;
+}
+
+/* 
+ * bytes allowed now by all limits, -1 - throttled: less than DRV_SOCKET_RATE_CHUNK_MIN tokens 
+ * (or the pending bytes if fewer) - the send waits instead of splitting the data in tiny segments
+ */
+int socket_rate_allowed(drv_socket_t* pSocket, drv_socket_connection_t* pConnection, int nPending)
+{
+    drv_socket_rate_t* apRate[3];
+    int nCount = socket_rate_buckets(pSocket, pConnection, apRate);
+    int nNeed = (nPending < DRV_SOCKET_RATE_CHUNK_MIN) ? nPending : DRV_SOCKET_RATE_CHUNK_MIN;
+    int nAllowed = DRV_SOCKET_RATE_UNLIMITED;
+    int64_t s64NowUs = esp_timer_get_time();
+
+    portENTER_CRITICAL(&rate_mux);
+    for (int index = 0; index < nCount; index++)
     {
-        bResult = send_identification_answer(pSocket, nConnectionIndex);
+        int nAvailable = drv_socket_rate_available(apRate[index], s64NowUs);
+        if (nAvailable < nNeed) apRate[index]->u32Throttled++;
+        if (nAvailable < nAllowed) nAllowed = nAvailable;
     }
-    else
+    portEXIT_CRITICAL(&rate_mux);
+
+    if (nAllowed < nNeed)
     {
-        ESP_LOGI(TAG, "stdio_auto_answer skip %d bytes", size);
-        ESP_LOG_BUFFER_CHAR(TAG, pData, size);
+        pConnection->stats.u32Throttled++;
+        return -1;
     }
-
-    return bResult;
+    return nAllowed;
 }
 
+void socket_rate_consume(drv_socket_t* pSocket, drv_socket_connection_t* pConnection, int nBytes)
+{
+    drv_socket_rate_t* apRate[3];
+    int nCount = socket_rate_buckets(pSocket, pConnection, apRate);
 
+    portENTER_CRITICAL(&rate_mux);
+    for (int index = 0; index < nCount; index++)
+    {
+        drv_socket_rate_consume(apRate[index], nBytes);
+    }
+    portEXIT_CRITICAL(&rate_mux);
+}
 
+/* ticks until the throttled connection can send (0 - now) */
+TickType_t socket_rate_wait_ticks(drv_socket_t* pSocket, drv_socket_connection_t* pConnection, int nPending)
+{
+    drv_socket_rate_t* apRate[3];
+    int nCount = socket_rate_buckets(pSocket, pConnection, apRate);
+    int nNeed = (nPending < DRV_SOCKET_RATE_CHUNK_MIN) ? nPending : DRV_SOCKET_RATE_CHUNK_MIN;
+    int64_t s64NowUs = esp_timer_get_time();
+    uint32_t u32WaitUs = 0;
+
+    portENTER_CRITICAL(&rate_mux);
+    for (int index = 0; index < nCount; index++)
+    {
+        drv_socket_rate_available(apRate[index], s64NowUs);
+        uint32_t u32BucketWaitUs = drv_socket_rate_wait_us(apRate[index], nNeed);
+        if (u32BucketWaitUs > u32WaitUs) u32WaitUs = u32BucketWaitUs;
+    }
+    portEXIT_CRITICAL(&rate_mux);
 
-void socket_recv(drv_socket_t* pSocket, int nConnectionIndex)
+    if (u32WaitUs == 0)
+    {
+        return 0;
+    }
+    TickType_t nWaitTicks = pdMS_TO_TICKS((u32WaitUs + 999) / 1000);
+    return (nWaitTicks > 0) ? nWaitTicks : 1;
+}
+
+void socket_stats_io_add(drv_socket_io_stats_t* pTotal, drv_socket_io_stats_t* pStats)
 {
-    int err;
-    int nSocketClient;
-    char sockTypeString[10];
+    pTotal->u64BytesIn += pStats->u64BytesIn;
+    pTotal->u64BytesOut += pStats->u64BytesOut;
+    pTotal->u32PacketsIn += pStats->u32PacketsIn;
+    pTotal->u32PacketsOut += pStats->u32PacketsOut;
+    pTotal->u32RecvCalls += pStats->u32RecvCalls;
+    pTotal->u32SendCalls += pStats->u32SendCalls;
+    pTotal->u32ShortWrites += pStats->u32ShortWrites;
+    pTotal->u32Again += pStats->u32Again;
+    pTotal->u32Throttled += pStats->u32Throttled;
+}
 
-    nSocketClient = pSocket->nSocketIndexPrimer[nConnectionIndex];
-    if (pSocket->bServerType)
+/* closed connections plus all active connections */
+void socket_stats_io_total(drv_socket_t* pSocket, drv_socket_io_stats_t* pTotal)
+{
+    *pTotal = pSocket->pRuntime->stats.ioClosed;
+    for (int nPosition = 0; nPosition < pSocket->nSocketConnectionsCount; nPosition++)
     {
-        strcpy(sockTypeString, "client");
+        socket_stats_io_add(pTotal, &socket_connection_get(pSocket, socket_connection_slot(pSocket, nPosition))->stats);
     }
-    else
+}
+
+void socket_stats_reset(drv_socket_t* pSocket)
+{
+    drv_socket_stats_t* pStats = &pSocket->pRuntime->stats;
+
+    memset(pStats, 0, sizeof(drv_socket_stats_t));
+    pStats->u32LoopTimeMinUs = UINT32_MAX;
+    pStats->s64RateWindowStartUs = esp_timer_get_time();
+    pSocket->pRuntime->rate.u64Bytes = 0;
+    pSocket->pRuntime->rate.u32Throttled = 0;
+    for (int nPosition = 0; nPosition < pSocket->nSocketConnectionsCount; nPosition++)
     {
-        strcpy(sockTypeString, "");
+        drv_socket_connection_t* pConnection = socket_connection_get(pSocket, socket_connection_slot(pSocket, nPosition));
+        memset(&pConnection->stats, 0, sizeof(drv_socket_io_stats_t));
+        pConnection->rate.u64Bytes = 0;
+        pConnection->rate.u32Throttled = 0;
+        pConnection->heartbeat.u32Sent = 0;
+        pConnection->heartbeat.u32Echoes = 0;
+        pConnection->heartbeat.u32MissesTotal = 0;
+        pConnection->heartbeat.u32RttMaxUs = 0;
     }
-    #define MAX_TCP_READ_SIZE 2048
+}
 
-    int nLength = MAX_TCP_READ_SIZE;
-    uint8_t* au8Temp;
+/* loop duration and rolling throughput - called once per socket task loop */
+void socket_stats_loop(drv_socket_t* pSocket, int64_t s64LoopStartUs)
+{
+    drv_socket_stats_t* pStats = &pSocket->pRuntime->stats;
+    int64_t s64TimeNowUs = esp_timer_get_time();
+    uint32_t u32LoopTimeUs = (uint32_t)(s64TimeNowUs - s64LoopStartUs);
+
+    pStats->u32LoopCount++;
+    pStats->u64LoopTimeSumUs += u32LoopTimeUs;
+    if (u32LoopTimeUs < pStats->u32LoopTimeMinUs) pStats->u32LoopTimeMinUs = u32LoopTimeUs;
+    if (u32LoopTimeUs > pStats->u32LoopTimeMaxUs) pStats->u32LoopTimeMaxUs = u32LoopTimeUs;
 
-    if (pSocket->bPreventOverflowReceivedData)
+    int64_t s64WindowUs = s64TimeNowUs - pStats->s64RateWindowStartUs;
+    if (s64WindowUs >= (DRV_SOCKET_STATS_RATE_WINDOW_MS * 1000))
     {
-        int nLengthPushSize = drv_stream_get_size(pSocket->pRecvStream[nConnectionIndex]);
-        int nLengthPushFree = drv_stream_get_free(pSocket->pRecvStream[nConnectionIndex]);
-        if (nLengthPushSize)
-        {
-            ESP_LOGW(TAG, "%s socket %s[%d] %d read buffer free %d bytes", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthPushFree);
-        }
-        
+        drv_socket_io_stats_t ioTotal;
+        socket_stats_io_total(pSocket, &ioTotal);
+        pStats->u32RateInBps = (uint32_t)(((ioTotal.u64BytesIn - pStats->u64RateBytesInMark) * 1000000) / s64WindowUs);
+        pStats->u32RateOutBps = (uint32_t)(((ioTotal.u64BytesOut - pStats->u64RateBytesOutMark) * 1000000) / s64WindowUs);
+        pStats->u64RateBytesInMark = ioTotal.u64BytesIn;
+        pStats->u64RateBytesOutMark = ioTotal.u64BytesOut;
+        pStats->s64RateWindowStartUs = s64TimeNowUs;
+    }
+}
 
-        if (nLengthPushFree >= 0)
+void socket_stats_print(drv_socket_t* pSocket)
+{
+    drv_socket_stats_t* pStats = &pSocket->pRuntime->stats;
+    drv_socket_io_stats_t ioTotal;
+
+    socket_stats_io_total(pSocket, &ioTotal);
+
+    ESP_LOGI(TAG, "Socket %s Connections:%d Accepts:%" PRIu32 " Rejects:%" PRIu32 " Connects:%" PRIu32 " Reconnects:%" PRIu32 " IfSwitches:%" PRIu32 " Pool:%d/%d", 
+        pSocket->cName, pSocket->nSocketConnectionsCount, pStats->u32Accepts, pStats->u32Rejects, pStats->u32Connects, pStats->u32Reconnects, pStats->u32InterfaceSwitches, 
+        nConnectionPoolUsed, DRV_SOCKET_CONNECTION_POOL_SIZE);
+    ESP_LOGI(TAG, "Socket %s In:%llu bytes %" PRIu32 " packets %" PRIu32 " recv|Out:%llu bytes %" PRIu32 " packets %" PRIu32 " send|Short:%" PRIu32 "|Again:%" PRIu32 "|Throttled:%" PRIu32 "|Rate In:%" PRIu32 " Out:%" PRIu32 " B/s", 
+        pSocket->cName, ioTotal.u64BytesIn, ioTotal.u32PacketsIn, ioTotal.u32RecvCalls, 
+        ioTotal.u64BytesOut, ioTotal.u32PacketsOut, ioTotal.u32SendCalls, 
+        ioTotal.u32ShortWrites, ioTotal.u32Again, ioTotal.u32Throttled, pStats->u32RateInBps, pStats->u32RateOutBps);
+    if (pSocket->pRuntime->rate.u32RateBps)
+    {
+        ESP_LOGI(TAG, "Socket %s Limit:%" PRIu32 " B/s Burst:%" PRIu32 " bytes Throttled:%" PRIu32, 
+            pSocket->cName, pSocket->pRuntime->rate.u32RateBps, pSocket->pRuntime->rate.u32BurstBytes, pSocket->pRuntime->rate.u32Throttled);
+    }
+    ESP_LOGI(TAG, "Socket %s Failover:%" PRIu32 "/%" PRIu32 " ms (last/max) Migrations:%" PRIu32 " StandbySwitches:%" PRIu32 " Standby:%s", 
+        pSocket->cName, pStats->u32FailoverTimeLastMs, pStats->u32FailoverTimeMaxMs, pStats->u32Migrations, pStats->u32StandbySwitches,
+        (pSocket->pRuntime->nStandbySocket < 0) ? "none" : (pSocket->pRuntime->bStandbyConnecting ? "connecting" : "ready"));
+    if (pSocket->bHeartbeatUse)
+    {
+        ESP_LOGI(TAG, "Socket %s Heartbeat dead peers:%" PRIu32, pSocket->cName, pStats->u32HeartbeatDeadPeers);
+        for (int nPosition = 0; nPosition < pSocket->nSocketConnectionsCount; nPosition++)
         {
-            if(nLength > nLengthPushFree)
-            {
-                if (nLengthPushSize)
-                {
-                    ESP_LOGW(TAG, "Limit Read from %s socket %s[%d] %d because of issuficient read buffer (%d/%d bytes)", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthPushFree, nLength);
-                }
-                nLength = nLengthPushFree;
-            }
+            int nConnectionIndex = socket_connection_slot(pSocket, nPosition);
+            drv_socket_heartbeat_t* pHeartbeat = &socket_connection_get(pSocket, nConnectionIndex)->heartbeat;
+            ESP_LOGI(TAG, "Socket %s[%d] Heartbeat Sent:%" PRIu32 " Echoes:%" PRIu32 " Misses:%" PRIu32 " RTT:%" PRIu32 "/%" PRIu32 "/%" PRIu32 " us (last/smooth/max) Jitter:%" PRIu32 " us", 
+                pSocket->cName, nConnectionIndex, pHeartbeat->u32Sent, pHeartbeat->u32Echoes, pHeartbeat->u32MissesTotal, 
+                pHeartbeat->u32RttLastUs, pHeartbeat->u32RttSmoothUs, pHeartbeat->u32RttMaxUs, pHeartbeat->u32JitterUs);
         }
-        
+    }
+    if (pSocket->bDualPath)
+    {
+        for (int nPath = 0; nPath < 2; nPath++)
+        {
+            drv_socket_path_stats_t* pPath = &pStats->asPath[nPath];
+            ESP_LOGI(TAG, "Socket %s Path %d (IF %d) Sent:%" PRIu32 " Errors:%" PRIu32 " Received:%" PRIu32 " First:%" PRIu32 " Late:%" PRIu32 " Lag:%" PRIu32 "/%" PRIu32 "/%" PRIu32 " us (last/avg/max)", 
+                pSocket->cName, nPath, (nPath == 0) ? pSocket->pRuntime->adapter_if : pSocket->pRuntime->path_if, 
+                pPath->u32Sent, pPath->u32SendErrors, pPath->u32Received, pPath->u32First, pPath->u32Late, 
+                pPath->u32LagLastUs, (pPath->u32Late > 0) ? (uint32_t)(pPath->u64LagSumUs / pPath->u32Late) : 0, pPath->u32LagMaxUs);
+        }
+    }
+    ESP_LOGI(TAG, "Socket %s DNS:%" PRIu32 "/%" PRIu32 " ms|Connect:%" PRIu32 "/%" PRIu32 " ms (last/max)|Loop:%" PRIu32 "/%" PRIu32 "/%" PRIu32 " us (min/avg/max) %" PRIu32 " loops|BudgetCuts:%" PRIu32 "|SendNotReady:%" PRIu32, 
+        pSocket->cName, pStats->u32DnsTimeLastMs, pStats->u32DnsTimeMaxMs, pStats->u32ConnectTimeLastMs, pStats->u32ConnectTimeMaxMs, 
+        (pStats->u32LoopCount > 0) ? pStats->u32LoopTimeMinUs : 0, 
+        (pStats->u32LoopCount > 0) ? (uint32_t)(pStats->u64LoopTimeSumUs / pStats->u32LoopCount) : 0, 
+        pStats->u32LoopTimeMaxUs, pStats->u32LoopCount, pStats->u32ServiceBudgetCuts, pStats->u32SendNotReady);
+    ESP_LOGI(TAG, "Socket %s Segments <64:%" PRIu32 " <128:%" PRIu32 " <256:%" PRIu32 " <512:%" PRIu32 " <1k:%" PRIu32 " 1k+:%" PRIu32 "|Flush Size:%" PRIu32 " Deadline:%" PRIu32 " Request:%" PRIu32, 
+        pSocket->cName, pStats->au32SegmentCount[0], pStats->au32SegmentCount[1], pStats->au32SegmentCount[2], 
+        pStats->au32SegmentCount[3], pStats->au32SegmentCount[4], pStats->au32SegmentCount[5], 
+        pStats->u32FlushSize, pStats->u32FlushDeadline, pStats->u32FlushRequest);
+    if (pSocket->pRuntime->bPeerDemux)
+    {
+        ESP_LOGI(TAG, "Socket %s Peers:%d IdleClosed:%" PRIu32 " Replaced:%" PRIu32 " Dropped:%" PRIu32, 
+            pSocket->cName, pSocket->nSocketConnectionsCount, pStats->u32PeerIdleClosed, pStats->u32PeerReplaced, pStats->u32PeerDropped);
+    }
+    if (pSocket->pRuntime->bDatagramMode)
+    {
+        drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+        ESP_LOGI(TAG, "Socket %s Datagrams Recv batches:%" PRIu32 " max:%" PRIu32 " queued:%" PRIu32 " dropped:%" PRIu32 "|Send batches:%" PRIu32 " max:%" PRIu32 " queued:%" PRIu32 " dropped:%" PRIu32 " errors:%" PRIu32, 
+            pSocket->cName, pStats->u32DgramRecvBatches, pStats->u32DgramRecvBatchMax, 
+            drv_socket_dgram_count(&pRuntime->dgramRecv), pRuntime->dgramRecv.u32Dropped, 
+            pStats->u32DgramSendBatches, pStats->u32DgramSendBatchMax, 
+            drv_socket_dgram_count(&pRuntime->dgramSend), pRuntime->dgramSend.u32Dropped, pStats->u32DgramSendErrors);
     }
 
-    if (nLength == 0)
+    for (int nPosition = 0; nPosition < pSocket->nSocketConnectionsCount; nPosition++)
     {
-        ESP_LOGE(TAG, "Skip Read from %s socket %s[%d] %d because of full read buffer (%d bytes)", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, drv_stream_get_size(pSocket->pRecvStream[nConnectionIndex]));
-        return;
+        int nConnectionIndex = socket_connection_slot(pSocket, nPosition);
+        drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+        ESP_LOGI(TAG, "Socket %s[%d] %d Up:%u s|In:%llu bytes %" PRIu32 " packets %" PRIu32 " recv|Out:%llu bytes %" PRIu32 " packets %" PRIu32 " send|Short:%" PRIu32 "|Again:%" PRIu32 "|Throttled:%" PRIu32 "|Weight:%u|Limit:%" PRIu32 " B/s",
+            pSocket->cName, nConnectionIndex, pConnection->nSocket, 
+            (unsigned)((xTaskGetTickCount() - pConnection->nConnectTicks) * portTICK_PERIOD_MS / 1000), 
+            pConnection->stats.u64BytesIn, pConnection->stats.u32PacketsIn, pConnection->stats.u32RecvCalls, 
+            pConnection->stats.u64BytesOut, pConnection->stats.u32PacketsOut, pConnection->stats.u32SendCalls, 
+            pConnection->stats.u32ShortWrites, pConnection->stats.u32Again, pConnection->stats.u32Throttled, pConnection->u8Weight, pConnection->rate.u32RateBps);
     }
-    
-    au8Temp = malloc(nLength);
+}
 
-    if (au8Temp)
+/* the statistics are owned by the socket task - the request is handed over and served on the next loop */
+void socket_stats_request(drv_socket_t* pSocket, bool bPrint, bool bReset)
+{
+    for (int index = 0; index < nSocketListCount; index++)
     {
-        if (pSocket->pRuntime->bBroadcastRxTx)
-        {
-            socklen_t socklen = sizeof(pSocket->pRuntime->host_addr_recv);
-            nLength = recvfrom(nSocketClient, au8Temp, nLength, MSG_PEEK | MSG_DONTWAIT, (struct sockaddr *)&pSocket->pRuntime->host_addr_recv, &socklen);
+        drv_socket_t* pListSocket = pSocketList[index];
+        bool bRequested = false;
 
+        if ((pListSocket == NULL) || ((pSocket != NULL) && (pSocket != pListSocket)))
+        {
+            continue;
         }
-        else
+        portENTER_CRITICAL(&wake_mux);
+        if (pListSocket->pRuntime != NULL)
         {
-            nLength = recv(nSocketClient, au8Temp, nLength, MSG_PEEK | MSG_DONTWAIT);
+            if (bPrint) pListSocket->pRuntime->bStatsPrintRequest = true;
+            if (bReset) pListSocket->pRuntime->bStatsResetRequest = true;
+            bRequested = true;
         }
-        free(au8Temp);
-        
-        
-
-        if (nLength > 0)
+        portEXIT_CRITICAL(&wake_mux);
+        if (bRequested)
         {
-            int nLengthPeek = nLength;
-
-            ESP_LOGD(TAG, "01 %d bytes Peek on %s socket", nLengthPeek, pSocket->cName);
-
-            au8Temp = malloc(nLength);
-
-            if (au8Temp)
-            {
-
-
-                if (pSocket->pRuntime->bBroadcastRxTx)
-                {
-                    socklen_t socklen = sizeof(pSocket->pRuntime->host_addr_recv);
-                    nLength = recvfrom(nSocketClient, au8Temp, nLength, MSG_DONTWAIT, (struct sockaddr *)&pSocket->pRuntime->host_addr_recv, &socklen);
-
-                    #define IP2STR_4(u32addr) ((uint8_t*)(&u32addr))[0],((uint8_t*)(&u32addr))[1],((uint8_t*)(&u32addr))[2],((uint8_t*)(&u32addr))[3]
-                    struct sockaddr_in *host_addr_recv_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->host_addr_recv;
-                    char* adapter_interface_address = inet_ntoa(host_addr_recv_ip4->sin_addr.s_addr);
-                    ESP_LOGW(TAG, "Recv %s socket %s[%d] %d (host_addr_recv %s:%d)", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, adapter_interface_address, htons(host_addr_recv_ip4->sin_port));
-                    //ESP_LOGW(TAG, "host_addr_recv " IPSTR ":%d", IP2STR_4(host_addr_recv_ip4->sin_addr.s_addr), htons(host_addr_recv_ip4->sin_port));
-                    //ESP_LOGW(TAG, "host_addr_recv 0x%08X:%d", (int)(host_addr_recv_ip4->sin_addr.s_addr), htons(host_addr_recv_ip4->sin_port));
-
-                    uint32_t u32RecvFromIP;
-                    uint16_t u16RecvFromPort;
+            drv_socket_wake(pListSocket);
+        }
+    }
+}
 
-                    u32RecvFromIP = host_addr_recv_ip4->sin_addr.s_addr;
-                    u16RecvFromPort = htons(host_addr_recv_ip4->sin_port);
+/* task side of drv_socket_stats_print / drv_socket_stats_reset */
+void socket_stats_service(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
 
-                    if (pSocket->onReceiveFrom != NULL)
-                    {
-                        pSocket->onReceiveFrom(u32RecvFromIP, u16RecvFromPort);
-                    }
+    if (pRuntime->bStatsPrintRequest)
+    {
+        pRuntime->bStatsPrintRequest = false;
+        socket_stats_print(pSocket);
+    }
+    if (pRuntime->bStatsResetRequest)
+    {
+        pRuntime->bStatsResetRequest = false;
+        socket_stats_reset(pSocket);
+    }
+}
 
-                }
-                else
-                {
-                    nLength = recv(nSocketClient, au8Temp, nLengthPeek, MSG_DONTWAIT);
-                }
-            
-                
+/* NULL - all sockets (printed by the socket tasks) */
+void drv_socket_stats_print(drv_socket_t* pSocket)
+{
+    socket_stats_request(pSocket, true, false);
+}
 
-                if (nLength > 0)
-                {
-                    if (nLength == nLengthPeek)
-                    {
-                        ESP_LOG_BUFFER_CHAR_LEVEL(pSocket->cName, au8Temp, nLength, ESP_LOG_DEBUG);
+/* NULL - all sockets (reset by the socket tasks) */
+void drv_socket_stats_reset(drv_socket_t* pSocket)
+{
+    socket_stats_request(pSocket, false, true);
+}
 
-                        if (pSocket->bIndentifyForced)
-                        {
-                            if(memcmp((char*)au8Temp,"man mac", strlen("man mac")) == 0)
-                            {
-                                socket_if_get_mac(pSocket, last_mac_addr_on_identification_request);
-                                ESP_LOGI(TAG, "Last MAC On Identification Request %02X:%02X:%02X:%02X:%02X:%02X", MAC2STR(last_mac_addr_on_identification_request));
-                                //drv_system_set_last_mac_identification_request(last_mac_addr_on_identification_request); To Do change to use this module instead drv_system
-                            }
-                        }
+void socket_connection_remove_from_list(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    int nPosition = pRuntime->au8ConnectionPosition[nConnectionIndex];
+    int nPositionLast = pSocket->nSocketConnectionsCount - 1;
 
-                        if (pSocket->bIndentifyNeeded)
-                        {
-                            //ESP_LOG_BUFFER_CHAR(TAG "!!!!!!!!!!!!!!!!001", au8Temp, nLength);
-                            if (socket_identification_answer(pSocket, nConnectionIndex, (char*)au8Temp, nLength))
-                            {
-                                //ESP_LOG_BUFFER_CHAR(TAG "!!!!!!!!!!!!!!!!002", au8Temp, nLength);
-                                pSocket->bIndentifyNeeded = false;
-                                pSocket->bSendEnable = true;
-                            }
-                        }
+    /* move the last active slot in place of the removed one */
+    int nSlotLast = pRuntime->au8ConnectionSlot[nPositionLast];
+    pRuntime->au8ConnectionSlot[nPosition] = nSlotLast;
+    pRuntime->au8ConnectionPosition[nSlotLast] = nPosition;
 
-                        if (pSocket->bLineEndingFixCRLFToCR)
-                        {
-                            for (int i = 0; i < nLength; i++)
-                            {
-                                if (i > 0)
-                                {
-                                    if((au8Temp[i-1] == '\r') && (au8Temp[i] == '\n'))
-                                    {
-                                        nLength--;
-                                        for (int j = i; j < nLength; j++)
-                                        {
-                                            au8Temp[j] = au8Temp[j+1];
-                                        }
-                                    }
-                                    else
-                                    if((au8Temp[i-1] == '\n') && (au8Temp[i] == '\r'))
-                                    {
-                                        nLength--;
-                                        for (int j = i; j < nLength; j++)
-                                        {
-                                            au8Temp[j] = au8Temp[j+1];
-                                        }
-                                    }
-                                }
-                                
-                            }
-                        }
+    if (pRuntime->bPeerDemux)
+    {
+        socket_peer_unlink(pSocket, nConnectionIndex);
+    }
+    pRuntime->au8ConnectionPosition[nConnectionIndex] = DRV_SOCKET_SLOT_FREE;
+    pRuntime->au8FreeSlot[pRuntime->nFreeSlotCount++] = nConnectionIndex;
 
-                        if (pSocket->onReceive != NULL)
-                        {
-                            int nLengthAfterProcess = pSocket->onReceive(nConnectionIndex, (char*)au8Temp, nLength);
+    socket_stats_io_add(&pRuntime->stats.ioClosed, &pRuntime->apConnection[nConnectionIndex]->stats);
+    socket_connection_timers_stop(pSocket, pRuntime->apConnection[nConnectionIndex]);
+    socket_connection_pool_free(pRuntime->apConnection[nConnectionIndex]);
+    pRuntime->apConnection[nConnectionIndex] = NULL;
 
-                            if (nLengthAfterProcess != nLength)
-                            {
-                                ESP_LOGI(TAG, "OnReceive event %s socket %s[%d] %d: returns %d/%d bytes", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthAfterProcess, nLength);
-                                nLength = nLengthAfterProcess;
-                            }
-                        }
-                        
-                        int nLengthPush = drv_stream_push(pSocket->pRecvStream[nConnectionIndex], au8Temp, nLength);
-                        int nFillStreamTCP = drv_stream_get_size(pSocket->pRecvStream[nConnectionIndex]);
-                        if(nLengthPush != nLength)
-                        {
-                            ESP_LOGE(TAG, "Error during read from %s socket %s[%d] %d: push |%d/%d->%d|bytes", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthPush, nLength, nFillStreamTCP);
-                            //socket_disconnect(pSocket);
-                            socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
-                        }
-                        else
-                        {
-                            
-                            ESP_LOGI(TAG, "%s socket %s[%d] %d: push |%d/%d->%d|bytes", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthPush, nLength, nFillStreamTCP);
-                            //ESP_LOG_BUFFER_CHAR(TAG "03", au8Temp, nLength);
-                        }
-                    }
-                    else
-                    {
-                        ESP_LOGE(TAG, "Error during read from %s socket %s[%d] %d: peek/recv %d/%d bytes", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthPeek, nLength);
-                        //socket_disconnect(pSocket);
-                        socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
-                    }
-                }
-                else
-                {
-                    err = errno;
-                    ESP_LOGE(TAG, "Error during read data from %s socket %s[%d] %d: errno %d (%s)", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, err, strerror(err));
-                    //socket_disconnect(pSocket);
-                    socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
-                }
-                free(au8Temp);
-            }
-            else
-            {
-                ESP_LOGE(TAG, "Error during allocate %d bytes for read pull from %s socket %s[%d] %d", nLength, sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient);
-            }
+    pSocket->nSocketConnectionsCount--;
+    if (pSocket->nSocketConnectionsCount == 0)
+    {
+        if (pSocket->bServerType)
+        {
+            /* closed server socket and 0 client connections available - do nothing (periodic client connect will be used) */
         }
         else
         {
-            err = errno;
-            if (err != EAGAIN)
-            {
-                ESP_LOGE(TAG, "Error during read peek from %s socket %s[%d] %d: errno %d (%s)", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, err, strerror(err));
-                //socket_disconnect(pSocket);
-                socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
-            }
-
+            pSocket->bConnected = false;    /* disconnect the client socket */
+            pRuntime->s64ConnectionLostUs = esp_timer_get_time();
         }
     }
-    else
-    {
-        ESP_LOGE(TAG, "Error during allocate %d bytes for read peek from %s socket %s[%d] %d", nLength, sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient);
-    }
 }
 
-void socket_send(drv_socket_t* pSocket, int nConnectionIndex)
+/* returns the connection slot or -1 if no free slot */
+int socket_connection_add_to_list(drv_socket_t* pSocket, int nSocketIndex, struct sockaddr_storage* pSourceAddr)
 {
-    int err;
-    int nSocketClient;
-    char sockTypeString[10];
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    drv_socket_connection_t* pConnection = NULL;
 
-    nSocketClient = pSocket->nSocketIndexPrimer[nConnectionIndex];
-    if (pSocket->bServerType)
+    if (pRuntime->nFreeSlotCount > 0)
     {
-        strcpy(sockTypeString, "client");
+        pConnection = socket_connection_pool_alloc();
+        if (pConnection == NULL)
+        {
+            ESP_LOGE(TAG, "Connecting Failure (Connection Pool Empty %d used) client to socket %s %d", nConnectionPoolUsed, pSocket->cName, nSocketIndex);
+        }
     }
     else
     {
-        strcpy(sockTypeString, "");
+        ESP_LOGE(TAG, "Connecting Failure (Max Clients Reached) client to socket %s %d", pSocket->cName, nSocketIndex);
     }
-    #define MAX_TCP_SEND_SIZE 1024
-
-    int nLength = MAX_TCP_SEND_SIZE;
-    uint8_t* au8Temp;
 
-
-
-    if (pSocket->bSendEnable)
+    if (pConnection != NULL)
     {
-        au8Temp = malloc(nLength);
-
-        if (au8Temp)
+        int nConnectionIndex = pRuntime->au8FreeSlot[--pRuntime->nFreeSlotCount];
+        pRuntime->apConnection[nConnectionIndex] = pConnection;
+
+        pRuntime->au8ConnectionSlot[pSocket->nSocketConnectionsCount] = nConnectionIndex;
+        pRuntime->au8ConnectionPosition[nConnectionIndex] = pSocket->nSocketConnectionsCount;
+        portENTER_CRITICAL(&connection_pool_mux);
+        u16ConnectionGeneration++;
+        if (u16ConnectionGeneration == 0)
         {
-            nLength = drv_stream_pull(pSocket->pSendStream[nConnectionIndex], au8Temp, nLength);
-
-            if(pSocket->bPingUse)
-            {
-                if(nLength <= 0)
-                {
-                    pSocket->nPingTicks += pdMS_TO_TICKS(DRV_SOCKET_TASK_REST_TIME_MS);
-                    if(pSocket->nPingTicks > pdMS_TO_TICKS(DRV_SOCKET_PING_SEND_TIME_MS))
-                    {
-                        pSocket->nPingTicks = 0;
-
-                    
-                        pSocket->nPingCount++;
-                        sprintf((char*)au8Temp, "ping_count %d \r\n", pSocket->nPingCount);
-                        nLength = strlen((char*)au8Temp);
-                    }
-                }
-                else
-                {
-                    pSocket->nPingTicks = 0;
-                }
-            }
-
-            if(nLength > 0)
-            {
-                int nLengthSent;
-                if (pSocket->pRuntime->bBroadcastRxTx)
-                {
-
-                    bool bUseSendToIPPort = false;
-
-                    uint32_t u32SendToIP = 0xFFFFFFFF;
-                    uint16_t u16SendToPort = 0xFFFF;
-
-                    if (pSocket->onSendTo != NULL)
-                    {
-                        pSocket->onSendTo(&u32SendToIP, &u16SendToPort);
-                        u32SendToIP = htonl(u32SendToIP);
-                        if (u16SendToPort != 0) bUseSendToIPPort = true;
-                    }
-
-                    if (bUseSendToIPPort)
-                    {
-                        struct sockaddr_in *host_addr_send_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->host_addr_send;
-                        host_addr_send_ip4->sin_port = htons(u16SendToPort);
-                        host_addr_send_ip4->sin_addr.s_addr = htonl(u32SendToIP);
-                        ESP_LOGW(TAG, "host_addr_send " IPSTR ":%d", IP2STR_4(host_addr_send_ip4->sin_addr.s_addr), htons(host_addr_send_ip4->sin_port));
-                        ESP_LOGW(TAG, "host_addr_send 0x%08X:%d", (int)(host_addr_send_ip4->sin_addr.s_addr), htons(host_addr_send_ip4->sin_port));
-                    }
+            u16ConnectionGeneration = 1;    /* keep handle != DRV_SOCKET_CONNECTION_HANDLE_INVALID */
+        }
+        pRuntime->au16Generation[nConnectionIndex] = u16ConnectionGeneration;
+        portEXIT_CRITICAL(&connection_pool_mux);
+        pSocket->nSocketConnectionsCount++;
 
-                    socklen_t socklen = sizeof(pSocket->pRuntime->host_addr_send);
-                    nLengthSent = sendto(nSocketClient, au8Temp, nLength, 0, (struct sockaddr *)&pSocket->pRuntime->host_addr_send, socklen);
-                    
-                }
-                else
-                {
-                    nLengthSent =   send(nSocketClient, au8Temp, nLength, 0);
-                }
-                
-                if (nLengthSent > 0)
-                {
-                    if (nLengthSent != nLength)
-                    {
-                        ESP_LOGE(TAG, "Error during send to %s socket %s[%d] %d: send %d/%d bytes", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthSent, nLength);
-                        //socket_disconnect(pSocket);
-                        socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
-                    }
-                    else
-                    {
-                        if (pSocket->onSend != NULL)
-                        {
-                            pSocket->onSend(nConnectionIndex, (char*)au8Temp, nLengthSent);
-                        }
-                        
-                    }
-                }
-                else
-                {
-                    err = errno;
-                    //if (err != EAGAIN)
-                    {
-                        ESP_LOGE(TAG, "Error during send to %s socket %s[%d] %d: errno %d (%s)", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, err, strerror(err));
-                        //socket_disconnect(pSocket);
-                        socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
-                    }
-                }
-            }
-            free(au8Temp);
+        pConnection->nSocket = nSocketIndex;
+        if (pSocket->pSendStream[nConnectionIndex] != NULL)
+        {
+            pConnection->pSendStream = pSocket->pSendStream[nConnectionIndex];
         }
         else
         {
-            ESP_LOGE(TAG, "Error during allocate %d bytes for send from %s socket %s[%d] %d", nLength, sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient);
+            snprintf(pConnection->sSendStream.cName, sizeof(pConnection->sSendStream.cName), "%s_tx%d", pSocket->cName, nConnectionIndex);
+            pConnection->pSendStream = &pConnection->sSendStream;
+            drv_stream_init(pConnection->pSendStream, NULL, 0);
         }
-    }
-    else
-    {
-        if (pSocket->bIndentifyNeeded)
+        if (pSocket->pRecvStream[nConnectionIndex] != NULL)
         {
-            pSocket->nTimeoutSendEnable += nTaskRestTimeTicks;
-            if (pSocket->nTimeoutSendEnable >= pdMS_TO_TICKS(10000))
-            {
-                ESP_LOGE(TAG, "Send Enable and Identify disable on Timeout socket %s[%d] %d", pSocket->cName, nConnectionIndex, nSocketClient);
-                if (pSocket->bIndentifyForced)
-                {
-                    send_identification_answer(pSocket, nConnectionIndex);    //forced send identification
-                }
-
-                pSocket->bSendEnable = true;
-                pSocket->bIndentifyNeeded = false;
-            }
+            pConnection->pRecvStream = pSocket->pRecvStream[nConnectionIndex];
         }
         else
         {
-            pSocket->bSendEnable = true;
+            snprintf(pConnection->sRecvStream.cName, sizeof(pConnection->sRecvStream.cName), "%s_rx%d", pSocket->cName, nConnectionIndex);
+            pConnection->pRecvStream = &pConnection->sRecvStream;
         }
+        socket_peer_from_sockaddr(&pConnection->peer, pSourceAddr);
+        memset(&pConnection->stats, 0, sizeof(pConnection->stats));
+        pConnection->nConnectTicks = xTaskGetTickCount();
+        socket_set_options(pSocket, nConnectionIndex);
+        socket_on_connect(pSocket, nConnectionIndex);
+        return nConnectionIndex;
     }
+    return -1;
 }
 
-void socket_get_adapter_interface_ip(drv_socket_t* pSocket)
-{
-    /* Get IP Address of the selected adapter interface (new selected ip address stored as string in pSocket->pRuntime->cAdapterInterfaceIP) */
-    esp_netif_ip_info_t ip_info;
-    struct sockaddr_in adapter_interface_addr;
 
-    adapter_interface_addr.sin_addr.s_addr = htonl(INADDR_NONE);
+void socket_disconnect_connection(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    int err;
 
-    if(pSocket->pRuntime->adapter_if == ESP_IF_WIFI_STA)
-    {
-        #if CONFIG_USE_WIFI
-        esp_netif_t* esp_netif = drv_wifi_get_netif_sta();
-        if (esp_netif != NULL)
-        {
-            esp_netif_get_ip_info(esp_netif, &ip_info);
-            inet_addr_from_ip4addr(&adapter_interface_addr.sin_addr,&ip_info.ip);
-        }
-        #else
-        adapter_interface_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-        #endif
-    }
-    else 
-    if(pSocket->pRuntime->adapter_if == ESP_IF_WIFI_AP)
+    if (socket_connection_active(pSocket, nConnectionIndex))
     {
-        #if CONFIG_USE_WIFI
-        esp_netif_t* esp_netif = drv_wifi_get_netif_ap();
-        if (esp_netif != NULL)
+        ESP_LOGE(TAG, "Disconnecting client %d socket %s %d", nConnectionIndex, pSocket->cName, pConnection->nSocket);
+        if (pSocket->pRuntime->bPeerDemux)
         {
-            esp_netif_get_ip_info(esp_netif, &ip_info);
-            inet_addr_from_ip4addr(&adapter_interface_addr.sin_addr,&ip_info.ip);
+            /* UDP server peer - the server socket is shared, only the connection is removed */
         }
-        #else
-        adapter_interface_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-        #endif
-    }
-    else //if(pSocket->adapter_if >= ESP_IF_ETH)
-    {
-        #if CONFIG_USE_ETHERNET
-        int eth_index = pSocket->pRuntime->adapter_if - ESP_IF_ETH;
-        if (drv_eth_get_netif_count() > eth_index)
+        else
         {
-            esp_netif_t* esp_netif = drv_eth_get_netif(eth_index);
-            if (esp_netif != NULL)
+            if(shutdown(pConnection->nSocket, SHUT_RDWR) != 0)
             {
-                esp_netif_get_ip_info(esp_netif, &ip_info);
-                inet_addr_from_ip4addr(&adapter_interface_addr.sin_addr,&ip_info.ip);
+                err = errno;
+                ESP_LOGE(TAG, "Error shutdown client %d socket %s %d: errno %d (%s)", nConnectionIndex, pSocket->cName, pConnection->nSocket, err, strerror(err));
+            }
+            if(close(pConnection->nSocket) != 0)
+            {
+                err = errno;
+                ESP_LOGE(TAG, "Error close client %d socket %s %d: errno %d (%s)", nConnectionIndex, pSocket->cName, pConnection->nSocket, err, strerror(err));     
             }
         }
-        else    /* use default */
-        #endif
-        {
-            adapter_interface_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-        }
+        pConnection->nSocket = -1;
+        socket_connection_remove_from_list(pSocket, nConnectionIndex);
     }
+}
 
-    in_addr_t interface_address = adapter_interface_addr.sin_addr.s_addr;
-    char *adapter_interface_ip = ip4addr_ntoa_r((ip4_addr_t*)&adapter_interface_addr.sin_addr.s_addr, pSocket->pRuntime->cAdapterInterfaceIP, sizeof(pSocket->pRuntime->cAdapterInterfaceIP));
+
+void socket_disconnect(drv_socket_t* pSocket)
+{
+    int err;
+
+    if (pSocket->bServerType)
+    {
+        while (pSocket->nSocketConnectionsCount)
+        {
+            socket_disconnect_connection(pSocket, socket_connection_slot(pSocket, 0));
+        }
+        if (pSocket->nSocketIndexServer >= 0)
+        {
+            ESP_LOGE(TAG, "Disconnecting server socket %s %d", pSocket->cName, pSocket->nSocketIndexServer);
+            if(shutdown(pSocket->nSocketIndexServer, SHUT_RDWR) != 0)
+            {
+                err = errno;
+                ESP_LOGE(TAG, "Error shutdown server socket %s %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));
+            }
+            if(close(pSocket->nSocketIndexServer) != 0)
+            {
+                err = errno;
+                ESP_LOGE(TAG, "Error close server socket %s %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));     
+            }
+            pSocket->nSocketIndexServer = -1;
+        }
+    }
+    else
+    {
+        while (pSocket->nSocketConnectionsCount)
+        {
+            int nConnectionIndex = socket_connection_slot(pSocket, 0);
+            socket_disconnect_connection(pSocket, nConnectionIndex);
+            if (pSocket->onDisconnect != NULL)
+            {
+                pSocket->onDisconnect(nConnectionIndex);
+            }
+        }
+        
+        if (pSocket->nSocketIndexServer >= 0)
+        {
+            ESP_LOGE(TAG, "Disconnecting unused socket %s %d", pSocket->cName, pSocket->nSocketIndexServer);
+            if(shutdown(pSocket->nSocketIndexServer, SHUT_RDWR) != 0)
+            {
+                err = errno;
+                ESP_LOGE(TAG, "Error shutdown unused socket %s %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));
+            }
+            if(close(pSocket->nSocketIndexServer) != 0)
+            {
+                err = errno;
+                ESP_LOGE(TAG, "Error close unused socket %s %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));     
+            }
+            pSocket->nSocketIndexServer = -1;
+        }
+        socket_dual_path_close(pSocket);
+        socket_migrate_close(pSocket);
+    }
+    pSocket->bConnected = false;
+}
+
+void drv_socket_disconnect(drv_socket_t* pSocket)
+{
+    pSocket->bDisconnectRequest = true;
+    drv_socket_wake(pSocket);
+}
+
+void drv_socket_wake(drv_socket_t* pSocket)
+{
+    #if CONFIG_SOCKET_EVENT_WAKEUP
+    drv_socket_runtime_t* pRuntime;
+    int nWakeEventFd = -1;
+
+    portENTER_CRITICAL(&wake_mux);
+    pRuntime = pSocket->pRuntime;
+    if ((pRuntime != NULL) && (pRuntime->nWakeEventFd >= 0))
+    {
+        nWakeEventFd = pRuntime->nWakeEventFd;
+        pRuntime->nWakeUsers++;     /* socket_wake_deinit() waits before the close */
+    }
+    portEXIT_CRITICAL(&wake_mux);
+
+    if (nWakeEventFd >= 0)
+    {
+        uint64_t u64Signal = 1;
+        write(nWakeEventFd, &u64Signal, sizeof(u64Signal));
+        portENTER_CRITICAL(&wake_mux);
+        pRuntime->nWakeUsers--;
+        portEXIT_CRITICAL(&wake_mux);
+    }
+    #endif
+}
+
+void socket_on_send_stream_push(void* pArg)
+{
+    drv_socket_wake((drv_socket_t*)pArg);
+}
+
+void socket_if_get_mac(drv_socket_t* pSocket, uint8_t mac_addr[6])
+{
+    if (pSocket->pRuntime->adapter_if == ESP_IF_WIFI_STA)
+    {
+        esp_wifi_get_mac(ESP_IF_WIFI_STA, mac_addr);
+        ESP_LOGI(pSocket->cName, "Adapter Interface: %s", "Wifi Station");   
+    }
+    else if (pSocket->pRuntime->adapter_if == ESP_IF_WIFI_AP)
+    {
+        esp_wifi_get_mac(ESP_IF_WIFI_AP, mac_addr);
+        ESP_LOGI(pSocket->cName, "Adapter Interface: %s", "Wifi Soft-AP");   
+    }
+    else if (pSocket->pRuntime->adapter_if >= ESP_IF_ETH)
+    {
+        #if CONFIG_USE_ETHERNET
+        int eth_index = pSocket->pRuntime->adapter_if - ESP_IF_ETH;
+        if (drv_eth_get_netif_count() > eth_index)
+        {
+            drv_eth_get_mac(eth_index, mac_addr);
+            ESP_LOGI(pSocket->cName, "Adapter Interface: %s", "EthernetLAN");    
+        }
+        else
+        #endif
+        {
+            ESP_LOGE(pSocket->cName, "Adapter Interface: %s", "Unimplemented");    //to do fix for default if needed
+        } 
+    }
+}
+
+#if CONFIG_SOCKET_FEATURE_IDENTIFY
+/* banner and binary answer of the selected interface - rebuilt only when the interface changes */
+void socket_identify_build(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    uint8_t* pAnswer = pRuntime->au8IdentifyAnswer;
+    uint8_t* mac_addr = pRuntime->au8IdentifyMac;
+    uint32_t u32Build = DRV_VERSION_BUILD;
+    uint32_t u32Capabilities = 0;
+
+    if (pRuntime->bIdentifyValid && (pRuntime->identify_if == pRuntime->adapter_if))
+    {
+        return;
+    }
+
+    /* Get MAC */
+    memset(mac_addr, 0, 6);
+    socket_if_get_mac(pSocket, mac_addr);
+
+    #define MACSTR_U_r "%02X:%02X:%02X:%02X:%02X:%02X\r"
+    ESP_LOGI(TAG, "MAC Address "MACSTR_U_r, MAC2STR(mac_addr));
+
+    pRuntime->nIdentifyBannerLength = snprintf(pRuntime->cIdentifyBanner, sizeof(pRuntime->cIdentifyBanner), 
+                MACSTR_U_r "MAC:" MACSTR_U_r "Version:%d.%d.%05d\r", 
+                MAC2STR(mac_addr), MAC2STR(mac_addr), 
+                DRV_VERSION_MAJOR, DRV_VERSION_MINOR, DRV_VERSION_BUILD);
+
+    if (SOCKET_PING_USE(pSocket)) u32Capabilities |= DRV_SOCKET_CAPABILITY_PING;
+    if (pSocket->bHeartbeatUse) u32Capabilities |= DRV_SOCKET_CAPABILITY_HEARTBEAT;
+    if (pSocket->bDualPath) u32Capabilities |= DRV_SOCKET_CAPABILITY_DUAL_PATH;
+    if (SOCKET_LINE_ENDING_FIX(pSocket)) u32Capabilities |= DRV_SOCKET_CAPABILITY_LINE_ENDING_CR;
+
+    pAnswer[0] = DRV_SOCKET_IDENTIFY_MAGIC_0;
+    pAnswer[1] = DRV_SOCKET_IDENTIFY_MAGIC_1;
+    pAnswer[2] = DRV_SOCKET_IDENTIFY_MAGIC_2;
+    pAnswer[3] = DRV_SOCKET_IDENTIFY_ANSWER;
+    memcpy(&pAnswer[4], mac_addr, 6);
+    pAnswer[10] = DRV_VERSION_MAJOR;
+    pAnswer[11] = DRV_VERSION_MINOR;
+    pAnswer[12] = (uint8_t)(u32Build >> 24);
+    pAnswer[13] = (uint8_t)(u32Build >> 16);
+    pAnswer[14] = (uint8_t)(u32Build >> 8);
+    pAnswer[15] = (uint8_t)(u32Build >> 0);
+    pAnswer[16] = (uint8_t)(u32Capabilities >> 24);
+    pAnswer[17] = (uint8_t)(u32Capabilities >> 16);
+    pAnswer[18] = (uint8_t)(u32Capabilities >> 8);
+    pAnswer[19] = (uint8_t)(u32Capabilities >> 0);
+
+    pRuntime->identify_if = pRuntime->adapter_if;
+    pRuntime->bIdentifyValid = true;
+}
+
+bool socket_identify_send(drv_socket_t* pSocket, int nConnectionIndex, const uint8_t* pData, int nLength)
+{   
+    bool bResult = false;
+
+    int err;
+    int nSocketClient = socket_connection_get(pSocket, nConnectionIndex)->nSocket;
+    drv_socket_io_stats_t* pStats = &socket_connection_get(pSocket, nConnectionIndex)->stats;
+    int nRecordSize = socket_heartbeat_record_size(pSocket);
+    uint8_t* pRecord = NULL;
+
+    if (nRecordSize)
+    {
+        /* one data record (heartbeat frames only between records) */
+        pRecord = malloc(nRecordSize + nLength);
+        if (pRecord == NULL)
+        {
+            ESP_LOGE(TAG, "Error during allocate %d bytes for send id to socket %s[%d] %d", nRecordSize + nLength, pSocket->cName, nConnectionIndex, nSocketClient);
+            return false;
+        }
+        socket_heartbeat_record(pRecord, nLength);
+        memcpy(pRecord + nRecordSize, pData, nLength);
+        pData = pRecord;
+        nLength += nRecordSize;
+    }
+    int nLengthSent = pSocket->pRuntime->pSendIo(pSocket, nConnectionIndex, (uint8_t*)pData, nLength);
+    pStats->u32SendCalls++;
+    if (nLengthSent > 0)
+    {
+        pStats->u64BytesOut += nLengthSent;
+        pStats->u32PacketsOut++;
+    }
     
-    if (interface_address == htonl(INADDR_NONE))
+    if (nLengthSent > 0)
     {
-        ESP_LOGE(TAG, "Socket %s bad or unimplemented adapter interface selected: %d", pSocket->cName, pSocket->pRuntime->adapter_if);
+        if (nLengthSent != nLength)
+        {
+            ESP_LOGE(TAG, "Error during send id to socket %s[%d] %d: send %d/%d bytes", pSocket->cName, nConnectionIndex, nSocketClient, nLengthSent, nLength);
+            //socket_disconnect(pSocket);
+            socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+        }
+        else
+        {
+            ESP_LOGI(TAG, "Success send id to socket %s[%d] %d: sent %d bytes", pSocket->cName, nConnectionIndex, nSocketClient, nLengthSent);
+            bResult = true;
+        }
+    }
+    else
+    {
+        err = errno;
+        //if (err != EAGAIN)
+        {
+            ESP_LOGE(TAG, "Error during send id to socket %s[%d] %d: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocketClient, err, strerror(err));
+            //socket_disconnect(pSocket);
+            socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+        }
+    }
+    free(pRecord);
+
+    return bResult;
+}
+
+bool send_identification_answer(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    socket_identify_build(pSocket);
+    return socket_identify_send(pSocket, nConnectionIndex, (uint8_t*)pSocket->pRuntime->cIdentifyBanner, pSocket->pRuntime->nIdentifyBannerLength);
+}
+
+bool send_identification_answer_binary(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    socket_identify_build(pSocket);
+    return socket_identify_send(pSocket, nConnectionIndex, pSocket->pRuntime->au8IdentifyAnswer, DRV_SOCKET_IDENTIFY_ANSWER_SIZE);
+}
+
+/* the first caller builds the matcher, concurrent callers wait until it is built */
+void socket_identify_match_init(void)
+{
+    socket_identify_match_state_t eState;
+
+    portENTER_CRITICAL(&identify_match_mux);
+    eState = eIdentifyMatchState;
+    if (eState == SOCKET_IDENTIFY_MATCH_NONE)
+    {
+        eIdentifyMatchState = SOCKET_IDENTIFY_MATCH_BUILDING;
+    }
+    portEXIT_CRITICAL(&identify_match_mux);
+
+    if (eState == SOCKET_IDENTIFY_MATCH_NONE)
+    {
+        bool bBuilt = drv_socket_match_build(&identifyMatch, asIdentifyPattern, SOCKET_IDENTIFY_PATTERN_COUNT);
+        if (bBuilt == false)
+        {
+            ESP_LOGE(TAG, "Identify matcher build failed");
+        }
+        portENTER_CRITICAL(&identify_match_mux);
+        eIdentifyMatchState = bBuilt ? SOCKET_IDENTIFY_MATCH_BUILT : SOCKET_IDENTIFY_MATCH_FAILED;
+        portEXIT_CRITICAL(&identify_match_mux);
+        return;
+    }
+    while (eState == SOCKET_IDENTIFY_MATCH_BUILDING)
+    {
+        vTaskDelay(1);
+        portENTER_CRITICAL(&identify_match_mux);
+        eState = eIdentifyMatchState;
+        portEXIT_CRITICAL(&identify_match_mux);
+    }
+}
+
+/* 
+ * identify requests anywhere in the received data - the matcher state is kept per connection, 
+ * so requests split over reads or following other bytes are answered without waiting for the timeout
+ */
+void socket_identification_detect(drv_socket_t* pSocket, int nConnectionIndex, uint8_t* pData, int nLength)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    int nOffset = 0;
+    int nPattern;
+    bool bMatched = false;
+
+    if (eIdentifyMatchState != SOCKET_IDENTIFY_MATCH_BUILT)
+    {
+        return;
+    }
+
+    while ((nPattern = drv_socket_match_run(&identifyMatch, &pConnection->u8IdentifyMatchState, pData, nLength, &nOffset)) >= 0)
+    {
+        bool bComplete = false;
+
+        bMatched = true;
+        if ((nPattern == SOCKET_IDENTIFY_PATTERN_MAN_MAC) && pSocket->bIndentifyForced)
+        {
+            socket_identify_build(pSocket);
+            memcpy(last_mac_addr_on_identification_request, pSocket->pRuntime->au8IdentifyMac, sizeof(last_mac_addr_on_identification_request));
+            ESP_LOGI(TAG, "Last MAC On Identification Request %02X:%02X:%02X:%02X:%02X:%02X", MAC2STR(last_mac_addr_on_identification_request));
+            //drv_system_set_last_mac_identification_request(last_mac_addr_on_identification_request); To Do change to use this module instead drv_system
+        }
+
+        if (pConnection->bIndentifyNeeded == false)
+        {
+            continue;
+        }
+        if (nPattern == SOCKET_IDENTIFY_PATTERN_MAN_MAC)
+        {
+            send_identification_answer(pSocket, nConnectionIndex);  //the identification answer is not complete, because after that version ask is expected
+        }
+        else if (nPattern == SOCKET_IDENTIFY_PATTERN_MAN_VER)
+        {
+            bComplete = send_identification_answer(pSocket, nConnectionIndex);
+        }
+        else if (pSocket->bIdentifyBinary)
+        {
+            bComplete = send_identification_answer_binary(pSocket, nConnectionIndex);    /* MAC, version and capabilities in one answer */
+        }
+
+        if (socket_connection_active(pSocket, nConnectionIndex) == false)
+        {
+            return;     /* disconnected on send error */
+        }
+        if (bComplete)
+        {
+            pConnection->bIndentifyNeeded = false;
+            pConnection->bSendEnable = true;
+            drv_socket_timer_stop(&pSocket->pRuntime->timerWheel, &pConnection->timerIdentify);
+        }
+    }
+
+    if ((bMatched == false) && pConnection->bIndentifyNeeded)
+    {
+        ESP_LOGI(TAG, "stdio_auto_answer skip %d bytes", nLength);
+        ESP_LOG_BUFFER_CHAR(TAG, pData, nLength);
+    }
+}
+#endif
+
+
+
+
+/* 
+ * read data of the connection (socket_recv and the dual-path socket): heartbeat frames removed, receive stages and 
+ * push to the receive stream. pData holds nSize bytes (the receive stage headroom included).
+ */
+void socket_recv_deliver(drv_socket_t* pSocket, int nConnectionIndex, uint8_t* pData, int nLength, int nSize)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    const char* sockTypeString = pSocket->bServerType ? "client" : "";
+    int nSocketClient = pConnection->nSocket;
+
+    if (pSocket->bHeartbeatUse)
+    {
+        nLength = socket_heartbeat_filter(pSocket, nConnectionIndex, pData, nLength);
+        if (nLength < 0)
+        {
+            ESP_LOGE(TAG, "Error during read from %s socket %s[%d] %d: heartbeat record framing", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient);
+            socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+            return;
+        }
+    }
+    if (nLength == 0)
+    {
+        return;     /* heartbeat frames only */
+    }
+
+    ESP_LOG_BUFFER_CHAR_LEVEL(pSocket->cName, pData, nLength, ESP_LOG_DEBUG);
+
+    nLength = socket_pipeline_run(pSocket, DRV_SOCKET_STAGE_RECV, nConnectionIndex, pData, nLength, nSize);
+    if ((nLength <= 0) || (socket_connection_active(pSocket, nConnectionIndex) == false))
+    {
+        return;     /* consumed by a stage or disconnected */
+    }
+
+    int nLengthPush = drv_stream_push(pConnection->pRecvStream, pData, nLength);
+    int nFillStreamTCP = drv_stream_get_size(pConnection->pRecvStream);
+    if(nLengthPush != nLength)
+    {
+        ESP_LOGE(TAG, "Error during read from %s socket %s[%d] %d: push |%d/%d->%d|bytes", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthPush, nLength, nFillStreamTCP);
+        //socket_disconnect(pSocket);
+        socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+    }
+    else
+    {
+        SOCKET_TRACE(DRV_TRACE_LEVEL_INFO, DRV_SOCKET_TRACE_RECV_PUSH, pSocket, nConnectionIndex, nSocketClient, nLengthPush, nFillStreamTCP);
+    }
+}
+
+void socket_recv(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    int err;
+    int nSocketClient;
+    char sockTypeString[10];
+
+    nSocketClient = pConnection->nSocket;
+    if (pSocket->bServerType)
+    {
+        strcpy(sockTypeString, "client");
+    }
+    else
+    {
+        strcpy(sockTypeString, "");
+    }
+    #define MAX_TCP_READ_SIZE 2048
+
+    int nLength = MAX_TCP_READ_SIZE;
+    uint8_t* au8Temp;
+
+    if (pSocket->pRuntime->bDatagramMode)
+    {
+        socket_dgram_recv(pSocket, nConnectionIndex);
+        return;
+    }
+    if (pSocket->pRuntime->bPeerDemux)
+    {
+        return;     /* socket_peer_recv reads the shared server socket */
+    }
+
+    if (SOCKET_PREVENT_OVERFLOW(pSocket))
+    {
+        int nLengthPushSize = drv_stream_get_size(pConnection->pRecvStream);
+        int nLengthPushFree = drv_stream_get_free(pConnection->pRecvStream);
+        if (nLengthPushSize)
+        {
+            ESP_LOGW(TAG, "%s socket %s[%d] %d read buffer free %d bytes", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthPushFree);
+        }
+        
+
+        if (nLengthPushFree >= 0)
+        {
+            if(nLength > nLengthPushFree)
+            {
+                if (nLengthPushSize)
+                {
+                    ESP_LOGW(TAG, "Limit Read from %s socket %s[%d] %d because of issuficient read buffer (%d/%d bytes)", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthPushFree, nLength);
+                }
+                nLength = nLengthPushFree;
+            }
+        }
+        
+    }
+
+    if (nLength == 0)
+    {
+        ESP_LOGE(TAG, "Skip Read from %s socket %s[%d] %d because of full read buffer (%d bytes)", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, drv_stream_get_size(pConnection->pRecvStream));
+        return;
+    }
+    
+    au8Temp = malloc(nLength);
+
+    if (au8Temp)
+    {
+        nLength = pSocket->pRuntime->pRecvIo(pSocket, nConnectionIndex, au8Temp, nLength, MSG_PEEK | MSG_DONTWAIT);
+        pConnection->stats.u32RecvCalls++;
+        free(au8Temp);
+        
+        
+
+        if (nLength > 0)
+        {
+            int nLengthPeek = nLength;
+
+            SOCKET_TRACE(DRV_TRACE_LEVEL_DEBUG, DRV_SOCKET_TRACE_RECV_PEEK, pSocket, nConnectionIndex, nSocketClient, nLengthPeek, 0);
+
+            au8Temp = malloc(nLength + pSocket->pRuntime->au16PipelineHeadroom[DRV_SOCKET_STAGE_RECV]);
+
+            if (au8Temp)
+            {
+
+
+                nLength = pSocket->pRuntime->pRecvIo(pSocket, nConnectionIndex, au8Temp, nLengthPeek, MSG_DONTWAIT);
+                pConnection->stats.u32RecvCalls++;
+                if (nLength > 0)
+                {
+                    pConnection->stats.u64BytesIn += nLength;
+                    pConnection->stats.u32PacketsIn++;
+                }
+            
+                if (nLength > 0)
+                {
+                    if (nLength == nLengthPeek)
+                    {
+                        if (socket_dual_path_active(pSocket) && (socket_dual_path_receive(pSocket, 0, au8Temp, &nLength) == false))
+                        {
+                            /* already delivered from the alternate path */
+                        }
+                        else
+                        {
+                            socket_recv_deliver(pSocket, nConnectionIndex, au8Temp, nLength, nLengthPeek + pSocket->pRuntime->au16PipelineHeadroom[DRV_SOCKET_STAGE_RECV]);
+                        }
+                    }
+                    else
+                    {
+                        ESP_LOGE(TAG, "Error during read from %s socket %s[%d] %d: peek/recv %d/%d bytes", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthPeek, nLength);
+                        //socket_disconnect(pSocket);
+                        socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+                    }
+                }
+                else
+                {
+                    err = errno;
+                    ESP_LOGE(TAG, "Error during read data from %s socket %s[%d] %d: errno %d (%s)", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, err, strerror(err));
+                    //socket_disconnect(pSocket);
+                    socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+                }
+                free(au8Temp);
+            }
+            else
+            {
+                ESP_LOGE(TAG, "Error during allocate %d bytes for read pull from %s socket %s[%d] %d", nLength, sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient);
+            }
+        }
+        else
+        if ((nLength == 0) && (pSocket->protocol_type == DRV_SOCKET_SOCK_STREAM))
+        {
+            /* orderly shutdown by the peer - the socket stays readable so it must be closed (otherwise select() never sleeps) */
+            ESP_LOGW(TAG, "Closed by peer %s socket %s[%d] %d", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient);
+            socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+        }
+        else
+        {
+            err = errno;
+            if ((err == EAGAIN) || (err == EWOULDBLOCK))
+            {
+                pConnection->stats.u32Again++;
+            }
+            else
+            {
+                ESP_LOGE(TAG, "Error during read peek from %s socket %s[%d] %d: errno %d (%s)", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, err, strerror(err));
+                drv_socket_link_report_loss(pSocket->pRuntime->adapter_if);     /* keepalive timeout / reset */
+                //socket_disconnect(pSocket);
+                socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+            }
+
+        }
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Error during allocate %d bytes for read peek from %s socket %s[%d] %d", nLength, sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient);
+    }
+}
+
+int socket_io_recv(drv_socket_t* pSocket, int nConnectionIndex, uint8_t* pData, int nLength, int nFlags)
+{
+    return recv(socket_connection_get(pSocket, nConnectionIndex)->nSocket, pData, nLength, nFlags);
+}
+
+int socket_io_send(drv_socket_t* pSocket, int nConnectionIndex, uint8_t* pData, int nLength)
+{
+    return send(socket_connection_get(pSocket, nConnectionIndex)->nSocket, pData, nLength, 0);
+}
+
+#if CONFIG_SOCKET_FEATURE_BROADCAST
+/* UDP broadcast - source reported to onReceiveFrom (not on peek) */
+int socket_io_recv_from(drv_socket_t* pSocket, int nConnectionIndex, uint8_t* pData, int nLength, int nFlags)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    int nSocketClient = socket_connection_get(pSocket, nConnectionIndex)->nSocket;
+    socklen_t socklen = sizeof(pRuntime->host_addr_recv);
+
+    nLength = recvfrom(nSocketClient, pData, nLength, nFlags, (struct sockaddr *)&pRuntime->host_addr_recv, &socklen);
+    if ((nFlags & MSG_PEEK) == 0)
+    {
+        struct sockaddr_in *host_addr_recv_ip4 = (struct sockaddr_in *)&pRuntime->host_addr_recv;
+        SOCKET_TRACE(DRV_TRACE_LEVEL_INFO, DRV_SOCKET_TRACE_RECV_FROM, pSocket, nConnectionIndex, nSocketClient, host_addr_recv_ip4->sin_addr.s_addr, htons(host_addr_recv_ip4->sin_port));
+
+        if (pSocket->onReceiveFrom != NULL)
+        {
+            pSocket->onReceiveFrom(host_addr_recv_ip4->sin_addr.s_addr, htons(host_addr_recv_ip4->sin_port));
+        }
+    }
+    return nLength;
+}
+
+/* UDP broadcast - destination from onSendTo (broadcast address if not given) */
+int socket_io_send_to(drv_socket_t* pSocket, int nConnectionIndex, uint8_t* pData, int nLength)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    int nSocketClient = socket_connection_get(pSocket, nConnectionIndex)->nSocket;
+    bool bUseSendToIPPort = false;
+
+    uint32_t u32SendToIP = 0xFFFFFFFF;
+    uint16_t u16SendToPort = 0xFFFF;
+
+    if (pSocket->onSendTo != NULL)
+    {
+        pSocket->onSendTo(&u32SendToIP, &u16SendToPort);
+        u32SendToIP = htonl(u32SendToIP);
+        if (u16SendToPort != 0) bUseSendToIPPort = true;
+    }
+
+    if (bUseSendToIPPort)
+    {
+        struct sockaddr_in *host_addr_send_ip4 = (struct sockaddr_in *)&pRuntime->host_addr_send;
+        host_addr_send_ip4->sin_port = htons(u16SendToPort);
+        host_addr_send_ip4->sin_addr.s_addr = htonl(u32SendToIP);
+        SOCKET_TRACE(DRV_TRACE_LEVEL_INFO, DRV_SOCKET_TRACE_SEND_TO, pSocket, nConnectionIndex, nSocketClient, host_addr_send_ip4->sin_addr.s_addr, u16SendToPort);
+    }
+
+    socklen_t socklen = sizeof(pRuntime->host_addr_send);
+    return sendto(nSocketClient, pData, nLength, 0, (struct sockaddr *)&pRuntime->host_addr_send, socklen);
+}
+#endif
+
+/* UDP server peer - to the connection peer address from the shared server socket (no onSendTo) */
+int socket_io_send_peer(drv_socket_t* pSocket, int nConnectionIndex, uint8_t* pData, int nLength)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    struct sockaddr_storage dest_addr;
+    socklen_t socklen;
+
+    if (socket_peer_to_sockaddr(&pConnection->peer, &dest_addr, &socklen) == false)
+    {
+        errno = EDESTADDRREQ;
+        return -1;
+    }
+    return sendto(pConnection->nSocket, pData, nLength, 0, (struct sockaddr *)&dest_addr, socklen);
+}
+
+/* selected when the host address is prepared - no per packet broadcast test in socket_recv/socket_send */
+void socket_io_select(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    pRuntime->pRecvIo = socket_io_recv;
+    pRuntime->pSendIo = socket_io_send;
+    #if CONFIG_SOCKET_FEATURE_BROADCAST
+    if (pRuntime->bBroadcastRxTx)
+    {
+        pRuntime->pRecvIo = socket_io_recv_from;
+        pRuntime->pSendIo = socket_io_send_to;
+    }
+    #endif
+    if (pRuntime->bPeerDemux)
+    {
+        pRuntime->pSendIo = socket_io_send_peer;    /* receive - socket_peer_recv */
+    }
+}
+
+/* datagram mode applies to UDP sockets - queues allocated at the task start */
+void socket_dgram_init(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    pRuntime->bDatagramMode = false;
+    pRuntime->bDgramSendBlocked = false;
+    if (pSocket->bDatagramMode == false)
+    {
+        return;
+    }
+    if ((pSocket->protocol_type != DRV_SOCKET_SOCK_DGRAM) || pSocket->bServerType)
+    {
+        ESP_LOGW(TAG, "Socket %s datagram mode ignored (UDP client only - UDP server peers are connections)", pSocket->cName);
+        return;
+    }
+    if ((drv_socket_dgram_init(&pRuntime->dgramRecv, CONFIG_SOCKET_DGRAM_QUEUE_SIZE, sizeof(drv_socket_peer_t)) == false)
+     || (drv_socket_dgram_init(&pRuntime->dgramSend, CONFIG_SOCKET_DGRAM_QUEUE_SIZE, sizeof(drv_socket_peer_t)) == false))
+    {
+        ESP_LOGE(TAG, "Socket %s unable to allocate datagram queues (stream mode used)", pSocket->cName);
+        drv_socket_dgram_deinit(&pRuntime->dgramRecv);
+        drv_socket_dgram_deinit(&pRuntime->dgramSend);
+        return;
+    }
+    drv_socket_dgram_set_on_push(&pRuntime->dgramSend, socket_on_send_stream_push, pSocket);
+    if (pSocket->bDualPath)
+    {
+        ESP_LOGW(TAG, "Socket %s dual-path not used in datagram mode", pSocket->cName);
+    }
+    pRuntime->bDatagramMode = true;
+}
+
+void socket_dgram_deinit(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    if (pRuntime->bDatagramMode)
+    {
+        pRuntime->bDatagramMode = false;
+        drv_socket_dgram_deinit(&pRuntime->dgramRecv);
+        drv_socket_dgram_deinit(&pRuntime->dgramSend);
+    }
+}
+
+/* all pending datagrams (up to DRV_SOCKET_DGRAM_BATCH_MAX) queued with the source address - one recvfrom each, no peek */
+void socket_dgram_recv(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    int nSocketClient = pConnection->nSocket;
+    uint8_t* au8Temp = malloc(DRV_SOCKET_DGRAM_SIZE_MAX);
+    uint32_t u32Count = 0;
+
+    if (au8Temp == NULL)
+    {
+        ESP_LOGE(TAG, "Error during allocate %d bytes for datagram read from socket %s[%d] %d", DRV_SOCKET_DGRAM_SIZE_MAX, pSocket->cName, nConnectionIndex, nSocketClient);
+        return;
+    }
+    while (u32Count < DRV_SOCKET_DGRAM_BATCH_MAX)
+    {
+        struct sockaddr_storage source_addr;
+        socklen_t socklen = sizeof(source_addr);
+        drv_socket_peer_t peer;
+
+        int nLength = recvfrom(nSocketClient, au8Temp, DRV_SOCKET_DGRAM_SIZE_MAX, MSG_DONTWAIT, (struct sockaddr *)&source_addr, &socklen);
+        pConnection->stats.u32RecvCalls++;
+        if (nLength < 0)
+        {
+            int err = errno;
+            if ((err == EAGAIN) || (err == EWOULDBLOCK))
+            {
+                if (u32Count == 0)
+                {
+                    pConnection->stats.u32Again++;
+                }
+            }
+            else
+            {
+                ESP_LOGE(TAG, "Error during datagram read from socket %s[%d] %d: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocketClient, err, strerror(err));
+                drv_socket_link_report_loss(pRuntime->adapter_if);
+                socket_disconnect_connection(pSocket, nConnectionIndex);
+            }
+            break;
+        }
+        u32Count++;
+        pConnection->stats.u64BytesIn += nLength;
+        pConnection->stats.u32PacketsIn++;
+        if (pSocket->bHeartbeatUse && (socket_heartbeat_filter(pSocket, nConnectionIndex, au8Temp, nLength) == 0))
+        {
+            continue;   /* heartbeat frame - not queued to the application */
+        }
+        socket_peer_from_sockaddr(&peer, &source_addr);
+        drv_socket_dgram_push(&pRuntime->dgramRecv, &peer, au8Temp, nLength);     /* full - dropped and counted (datagram semantics) */
+        SOCKET_TRACE(DRV_TRACE_LEVEL_DEBUG, DRV_SOCKET_TRACE_DGRAM_RECV, pSocket, nConnectionIndex, nSocketClient, nLength, drv_socket_dgram_count(&pRuntime->dgramRecv));
+    }
+    free(au8Temp);
+
+    if (u32Count)
+    {
+        pRuntime->stats.u32DgramRecvBatches++;
+        if (u32Count > pRuntime->stats.u32DgramRecvBatchMax) pRuntime->stats.u32DgramRecvBatchMax = u32Count;
+    }
+}
+
+/* queued datagrams (up to DRV_SOCKET_DGRAM_BATCH_MAX) each to its own destination - port 0: the socket host address */
+void socket_dgram_send(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    int nSocketClient = pConnection->nSocket;
+    uint32_t u32Count = 0;
+    uint8_t* au8Temp;
+
+    pRuntime->bDgramSendBlocked = false;
+    if (drv_socket_dgram_count(&pRuntime->dgramSend) == 0)
+    {
+        return;
+    }
+    au8Temp = malloc(DRV_SOCKET_DGRAM_SIZE_MAX);
+    if (au8Temp == NULL)
+    {
+        ESP_LOGE(TAG, "Error during allocate %d bytes for datagram send to socket %s[%d] %d", DRV_SOCKET_DGRAM_SIZE_MAX, pSocket->cName, nConnectionIndex, nSocketClient);
+        return;
+    }
+    while (u32Count < DRV_SOCKET_DGRAM_BATCH_MAX)
+    {
+        drv_socket_peer_t peer;
+        struct sockaddr_storage dest_addr;
+        socklen_t socklen;
+        int nLengthSent;
+
+        /* kept in the queue until sent (or failed) - a datagram is never split by the rate limit */
+        int nLength = drv_socket_dgram_peek(&pRuntime->dgramSend, &peer, au8Temp, DRV_SOCKET_DGRAM_SIZE_MAX);
+        if (nLength < 0)
+        {
+            break;
+        }
+        if (socket_rate_allowed(pSocket, pConnection, nLength) < 0)
+        {
+            break;      /* socket_get_wait_ticks wakes the task when the tokens are available (overrun repaid before the next send) */
+        }
+
+        if ((peer.u16Port != 0) && socket_peer_to_sockaddr(&peer, &dest_addr, &socklen))
+        {
+            nLengthSent = sendto(nSocketClient, au8Temp, nLength, 0, (struct sockaddr *)&dest_addr, socklen);
+        }
+        else
+        if (SOCKET_BROADCAST(pRuntime))
+        {
+            nLengthSent = sendto(nSocketClient, au8Temp, nLength, 0, (struct sockaddr *)&pRuntime->host_addr_send, sizeof(pRuntime->host_addr_send));
+        }
+        else
+        {
+            nLengthSent = send(nSocketClient, au8Temp, nLength, 0);
+        }
+        pConnection->stats.u32SendCalls++;
+        SOCKET_TRACE(DRV_TRACE_LEVEL_DEBUG, DRV_SOCKET_TRACE_SEND, pSocket, nConnectionIndex, nSocketClient, nLengthSent, nLength);
+
+        if (nLengthSent < 0)
+        {
+            int err = errno;
+            if ((err == EAGAIN) || (err == EWOULDBLOCK) || (err == ENOMEM))
+            {
+                pConnection->stats.u32Again++;
+                pRuntime->bDgramSendBlocked = true;     /* no buffers - retried later, datagram kept */
+                break;
+            }
+            pRuntime->stats.u32DgramSendErrors++;
+            ESP_LOGE(TAG, "Error during datagram send to socket %s[%d] %d: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocketClient, err, strerror(err));
+        }
+        else
+        {
+            pConnection->stats.u64BytesOut += nLengthSent;
+            pConnection->stats.u32PacketsOut++;
+            socket_rate_consume(pSocket, pConnection, nLengthSent);
+            socket_segment_count(pSocket, nLengthSent);
+            if (pSocket->onSend != NULL)
+            {
+                pSocket->onSend(nConnectionIndex, (char*)au8Temp, nLengthSent);
+            }
+        }
+        drv_socket_dgram_pull(&pRuntime->dgramSend, NULL, NULL, 0);
+        u32Count++;
+    }
+    free(au8Temp);
+
+    if (u32Count)
+    {
+        pRuntime->stats.u32DgramSendBatches++;
+        if (u32Count > pRuntime->stats.u32DgramSendBatchMax) pRuntime->stats.u32DgramSendBatchMax = u32Count;
+    }
+}
+
+/* datagram mode: queue one datagram - pPeer NULL (or port 0) to the socket host address, false - queue full or not running */
+bool drv_socket_send_datagram(drv_socket_t* pSocket, const drv_socket_peer_t* pPeer, const uint8_t* pData, int nLength)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    if ((pRuntime == NULL) || (pRuntime->bDatagramMode == false) || (nLength > DRV_SOCKET_DGRAM_SIZE_MAX))
+    {
+        return false;
+    }
+    return drv_socket_dgram_push(&pRuntime->dgramSend, pPeer, pData, nLength);     /* wakes the task */
+}
+
+/* datagram mode: oldest received datagram and its source (pPeer may be NULL), data beyond nSize discarded, -1 - none */
+int drv_socket_recv_datagram(drv_socket_t* pSocket, drv_socket_peer_t* pPeer, uint8_t* pData, int nSize)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    if ((pRuntime == NULL) || (pRuntime->bDatagramMode == false))
+    {
+        return -1;
+    }
+    return drv_socket_dgram_pull(&pRuntime->dgramRecv, pPeer, pData, nSize);
+}
+
+/* UDP server peer table - address and port hashed to a bucket, buckets chained through au8PeerNext by slot */
+uint32_t socket_peer_hash(const drv_socket_peer_t* pPeer)
+{
+    uint32_t u32Key = pPeer->u16Port;
+
+    if (pPeer->u8Family == AF_INET6)
+    {
+        uint32_t au32Address[4];
+        memcpy(au32Address, pPeer->au8IPv6, sizeof(au32Address));
+        u32Key ^= au32Address[0] ^ au32Address[1] ^ au32Address[2] ^ au32Address[3];
+    }
+    else
+    {
+        u32Key ^= pPeer->u32IPv4;
+    }
+    return (u32Key * 2654435761u) >> (32 - DRV_SOCKET_PEER_HASH_BITS);     /* multiplicative hash - top bits */
+}
+
+bool socket_peer_equal(const drv_socket_peer_t* pPeerA, const drv_socket_peer_t* pPeerB)
+{
+    if ((pPeerA->u8Family != pPeerB->u8Family) || (pPeerA->u16Port != pPeerB->u16Port))
+    {
+        return false;
+    }
+    if (pPeerA->u8Family == AF_INET6)
+    {
+        return memcmp(pPeerA->au8IPv6, pPeerB->au8IPv6, sizeof(pPeerA->au8IPv6)) == 0;
+    }
+    return pPeerA->u32IPv4 == pPeerB->u32IPv4;
+}
+
+/* connection slot of the peer, -1 - not in the table */
+int socket_peer_find(drv_socket_t* pSocket, const drv_socket_peer_t* pPeer)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    for (int nSlot = pRuntime->au8PeerHash[socket_peer_hash(pPeer)]; nSlot != DRV_SOCKET_SLOT_FREE; nSlot = pRuntime->au8PeerNext[nSlot])
+    {
+        if (socket_peer_equal(&pRuntime->apConnection[nSlot]->peer, pPeer))
+        {
+            return nSlot;
+        }
+    }
+    return -1;
+}
+
+void socket_peer_link(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    uint32_t u32Bucket = socket_peer_hash(&pRuntime->apConnection[nConnectionIndex]->peer);
+
+    pRuntime->au8PeerNext[nConnectionIndex] = pRuntime->au8PeerHash[u32Bucket];
+    pRuntime->au8PeerHash[u32Bucket] = nConnectionIndex;
+}
+
+/* called on connection remove (before the slot is freed) */
+void socket_peer_unlink(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    uint8_t* pLink = &pRuntime->au8PeerHash[socket_peer_hash(&pRuntime->apConnection[nConnectionIndex]->peer)];
+
+    while (*pLink != DRV_SOCKET_SLOT_FREE)
+    {
+        if (*pLink == nConnectionIndex)
+        {
+            *pLink = pRuntime->au8PeerNext[nConnectionIndex];
+            break;
+        }
+        pLink = &pRuntime->au8PeerNext[*pLink];
+    }
+}
+
+void socket_peer_close(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    socket_disconnect_connection(pSocket, nConnectionIndex);
+    if (pSocket->onDisconnect != NULL)
+    {
+        pSocket->onDisconnect(nConnectionIndex);
+    }
+}
+
+/* table full - the peer idle longest is closed if idle for DRV_SOCKET_PEER_REPLACE_MS at least (active peers are kept) */
+bool socket_peer_replace(drv_socket_t* pSocket)
+{
+    TickType_t nNowTicks = xTaskGetTickCount();
+    TickType_t nIdleMaxTicks = 0;
+    int nIdleMaxIndex = -1;
+
+    for (int nPosition = 0; nPosition < pSocket->nSocketConnectionsCount; nPosition++)
+    {
+        int nConnectionIndex = socket_connection_slot(pSocket, nPosition);
+        TickType_t nIdleTicks = nNowTicks - socket_connection_get(pSocket, nConnectionIndex)->nPeerActivityTicks;
+        if (nIdleTicks >= nIdleMaxTicks)
+        {
+            nIdleMaxTicks = nIdleTicks;
+            nIdleMaxIndex = nConnectionIndex;
+        }
+    }
+    if ((nIdleMaxIndex < 0) || (nIdleMaxTicks < pdMS_TO_TICKS(DRV_SOCKET_PEER_REPLACE_MS)))
+    {
+        return false;
+    }
+    ESP_LOGW(TAG, "Socket %s[%d] peer replaced (idle %u ms, table full)", pSocket->cName, nIdleMaxIndex, (unsigned)(nIdleMaxTicks * portTICK_PERIOD_MS));
+    pSocket->pRuntime->stats.u32PeerReplaced++;
+    socket_peer_close(pSocket, nIdleMaxIndex);
+    return true;
+}
+
+/* connection of the datagram source - a new peer gets a connection (onConnect), -1 - no free connection */
+int socket_peer_connection(drv_socket_t* pSocket, const drv_socket_peer_t* pPeer, struct sockaddr_storage* pSourceAddr)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    int nConnectionIndex = socket_peer_find(pSocket, pPeer);
+
+    if (nConnectionIndex >= 0)
+    {
+        return nConnectionIndex;
+    }
+    if ((pRuntime->nFreeSlotCount == 0) || (nConnectionPoolUsed >= DRV_SOCKET_CONNECTION_POOL_SIZE))
+    {
+        /* all peers active - one replace scan per DRV_SOCKET_PEER_REPLACE_MS, new peers rejected silently (counted) */
+        TickType_t nNowTicks = xTaskGetTickCount();
+        if ((nNowTicks - pRuntime->nPeerReplaceTicks) < pdMS_TO_TICKS(DRV_SOCKET_PEER_REPLACE_MS))
+        {
+            pRuntime->stats.u32Rejects++;
+            return -1;
+        }
+        if (socket_peer_replace(pSocket) == false)
+        {
+            pRuntime->nPeerReplaceTicks = nNowTicks;
+            pRuntime->stats.u32Rejects++;
+            return -1;
+        }
+        if (nConnectionPoolUsed >= DRV_SOCKET_CONNECTION_POOL_SIZE)
+        {
+            pRuntime->stats.u32Rejects++;   /* replaced connection taken by another socket */
+            return -1;
+        }
+    }
+    nConnectionIndex = socket_connection_add_to_list(pSocket, pSocket->nSocketIndexServer, pSourceAddr);
+    if (nConnectionIndex < 0)
+    {
+        pRuntime->stats.u32Rejects++;
+        return -1;
+    }
+    socket_peer_link(pSocket, nConnectionIndex);
+    pRuntime->stats.u32Accepts++;
+
+    char addr_str[48] = "";
+    if (pSourceAddr->ss_family == PF_INET)
+    {
+        inet_ntoa_r(((struct sockaddr_in *)pSourceAddr)->sin_addr, addr_str, sizeof(addr_str) - 1);
+    }
+    #if LWIP_IPV6
+    else if (pSourceAddr->ss_family == PF_INET6)
+    {
+        inet6_ntoa_r(((struct sockaddr_in6 *)pSourceAddr)->sin6_addr, addr_str, sizeof(addr_str) - 1);
+    }
+    #endif
+    ESP_LOGI(TAG, "Socket %s[%d] %d new peer %s:%d", pSocket->cName, nConnectionIndex, pSocket->nSocketIndexServer, addr_str, pPeer->u16Port);
+    return nConnectionIndex;
+}
+
+/* heartbeat, receive stages and push to the peer receive stream - a datagram not fitting is dropped whole */
+void socket_peer_deliver(drv_socket_t* pSocket, int nConnectionIndex, uint8_t* pData, int nLength, int nSize)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+
+    if (pSocket->bDualPath && (socket_dual_path_receive_peer(pSocket, pData, &nLength) == false))
+    {
+        return;     /* copy of the other path */
+    }
+    if (pSocket->bHeartbeatUse)
+    {
+        nLength = socket_heartbeat_filter(pSocket, nConnectionIndex, pData, nLength);
+    }
+    if (nLength > 0)
+    {
+        nLength = socket_pipeline_run(pSocket, DRV_SOCKET_STAGE_RECV, nConnectionIndex, pData, nLength, nSize);
+    }
+    if ((nLength <= 0) || (socket_connection_active(pSocket, nConnectionIndex) == false))
+    {
+        return;     /* consumed by heartbeat or a stage, or disconnected */
+    }
+
+    int nLengthFree = drv_stream_get_free(pConnection->pRecvStream);
+    if (SOCKET_PREVENT_OVERFLOW(pSocket) && (nLengthFree >= 0) && (nLengthFree < nLength))
+    {
+        pSocket->pRuntime->stats.u32PeerDropped++;
+        return;
+    }
+    int nLengthPush = drv_stream_push(pConnection->pRecvStream, pData, nLength);
+    int nFillStream = drv_stream_get_size(pConnection->pRecvStream);
+    if (nLengthPush != nLength)
+    {
+        ESP_LOGE(TAG, "Error during read from peer socket %s[%d] %d: push |%d/%d->%d|bytes", pSocket->cName, nConnectionIndex, pConnection->nSocket, nLengthPush, nLength, nFillStream);
+    }
+    else
+    {
+        SOCKET_TRACE(DRV_TRACE_LEVEL_INFO, DRV_SOCKET_TRACE_RECV_PUSH, pSocket, nConnectionIndex, pConnection->nSocket, nLengthPush, nFillStream);
+    }
+}
+
+/* UDP server: pending datagrams (up to DRV_SOCKET_DGRAM_BATCH_MAX) read from the server socket, each to the connection of its source */
+void socket_peer_recv(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    int nSize = DRV_SOCKET_DGRAM_SIZE_MAX + pRuntime->au16PipelineHeadroom[DRV_SOCKET_STAGE_RECV];
+    uint8_t* au8Temp = malloc(nSize);
+
+    if (au8Temp == NULL)
+    {
+        ESP_LOGE(TAG, "Error during allocate %d bytes for read from server socket %s %d", nSize, pSocket->cName, pSocket->nSocketIndexServer);
+        return;
+    }
+    for (int nCount = 0; (nCount < DRV_SOCKET_DGRAM_BATCH_MAX) && (pSocket->nSocketIndexServer >= 0); nCount++)
+    {
+        struct sockaddr_storage source_addr;
+        socklen_t socklen = sizeof(source_addr);
+        drv_socket_peer_t peer;
+
+        int nLength = recvfrom(pSocket->nSocketIndexServer, au8Temp, DRV_SOCKET_DGRAM_SIZE_MAX, MSG_DONTWAIT, (struct sockaddr *)&source_addr, &socklen);
+        if (nLength < 0)
+        {
+            int err = errno;
+            if ((err != EAGAIN) && (err != EWOULDBLOCK))
+            {
+                ESP_LOGE(TAG, "Error during read from server socket %s %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));
+                socket_disconnect(pSocket);
+            }
+            break;
+        }
+        socket_peer_from_sockaddr(&peer, &source_addr);
+        SOCKET_TRACE(DRV_TRACE_LEVEL_DEBUG, DRV_SOCKET_TRACE_RECV_FROM, pSocket, 0, pSocket->nSocketIndexServer, peer.u32IPv4, peer.u16Port);
+
+        int nConnectionIndex = socket_peer_connection(pSocket, &peer, &source_addr);
+        if (nConnectionIndex < 0)
+        {
+            pRuntime->stats.u32PeerDropped++;
+            continue;
+        }
+        drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+        pConnection->nPeerActivityTicks = xTaskGetTickCount();
+        pConnection->stats.u32RecvCalls++;
+        pConnection->stats.u64BytesIn += nLength;
+        pConnection->stats.u32PacketsIn++;
+        socket_peer_deliver(pSocket, nConnectionIndex, au8Temp, nLength, nSize);
+    }
+    free(au8Temp);
+}
+
+/* period DRV_SOCKET_PEER_IDLE_CHECK_MS - peers without datagrams for the idle time are closed (onDisconnect) */
+void socket_peer_idle(void* pArg, int nArg)
+{
+    drv_socket_t* pSocket = (drv_socket_t*)pArg;
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    uint32_t u32IdleS = pSocket->u16PeerIdleS ? pSocket->u16PeerIdleS : DRV_SOCKET_PEER_IDLE_DEFAULT_S;
+    TickType_t nNowTicks = xTaskGetTickCount();
+
+    drv_socket_timer_start(&pRuntime->timerWheel, &pRuntime->timerPeerIdle, pdMS_TO_TICKS(DRV_SOCKET_PEER_IDLE_CHECK_MS));
+
+    /* from the end - a removed position is filled by the last (already checked) one */
+    for (int nPosition = pSocket->nSocketConnectionsCount - 1; nPosition >= 0; nPosition--)
+    {
+        int nConnectionIndex = socket_connection_slot(pSocket, nPosition);
+        TickType_t nIdleTicks = nNowTicks - socket_connection_get(pSocket, nConnectionIndex)->nPeerActivityTicks;
+        if (nIdleTicks >= pdMS_TO_TICKS(u32IdleS * 1000))
+        {
+            ESP_LOGI(TAG, "Socket %s[%d] peer idle %u s - closed", pSocket->cName, nConnectionIndex, (unsigned)u32IdleS);
+            pRuntime->stats.u32PeerIdleClosed++;
+            socket_peer_close(pSocket, nConnectionIndex);
+        }
+    }
+}
+
+#if CONFIG_SOCKET_FEATURE_IDENTIFY
+/* identify requests - the data is passed on unchanged */
+int socket_stage_identify(void* pArg, int nConnectionIndex, uint8_t* pData, int nLength, int nSize)
+{
+    drv_socket_t* pSocket = (drv_socket_t*)pArg;
+
+    if (pSocket->bIndentifyForced || socket_connection_get(pSocket, nConnectionIndex)->bIndentifyNeeded)
+    {
+        socket_identification_detect(pSocket, nConnectionIndex, pData, nLength);
+    }
+    return nLength;
+}
+#endif
+
+#if CONFIG_SOCKET_FEATURE_LINE_ENDING
+int socket_stage_line_ending(void* pArg, int nConnectionIndex, uint8_t* pData, int nLength, int nSize)
+{
+    drv_socket_t* pSocket = (drv_socket_t*)pArg;
+
+    return drv_socket_line_crlf_to_cr(pData, nLength, &socket_connection_get(pSocket, nConnectionIndex)->u8LineEndingPrev);
+}
+#endif
+
+int socket_stage_on_receive(void* pArg, int nConnectionIndex, uint8_t* pData, int nLength, int nSize)
+{
+    drv_socket_t* pSocket = (drv_socket_t*)pArg;
+    int nLengthAfterProcess = pSocket->onReceive(nConnectionIndex, (char*)pData, nLength);
+
+    if (nLengthAfterProcess != nLength)
+    {
+        SOCKET_TRACE(DRV_TRACE_LEVEL_INFO, DRV_SOCKET_TRACE_RECV_PROCESS, pSocket, nConnectionIndex, socket_connection_get(pSocket, nConnectionIndex)->nSocket, nLengthAfterProcess, nLength);
+    }
+    return nLengthAfterProcess;
+}
+
+#if CONFIG_SOCKET_FEATURE_PING
+/* ping text when there was no send activity for DRV_SOCKET_PING_SEND_TIME_MS (idle stage) */
+int socket_stage_ping(void* pArg, int nConnectionIndex, uint8_t* pData, int nLength, int nSize)
+{
+    drv_socket_t* pSocket = (drv_socket_t*)pArg;
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+
+    if (nLength <= 0)
+    {
+        if (pConnection->bPingDue == false)
+        {
+            return nLength;
+        }
+        pConnection->nPingCount++;
+        nLength = snprintf((char*)pData, nSize, "ping_count %d \r\n", pConnection->nPingCount);
+    }
+    pConnection->bPingDue = false;
+    drv_socket_timer_start(&pSocket->pRuntime->timerWheel, &pConnection->timerPing, pdMS_TO_TICKS(DRV_SOCKET_PING_SEND_TIME_MS));
+    return nLength;
+}
+#endif
+
+bool drv_socket_add_stage(drv_socket_t* pSocket, drv_socket_stage_direction_t eDirection, drv_socket_stage_process_t pProcess, void* pArg, uint16_t u16Headroom)
+{
+    if ((eDirection >= DRV_SOCKET_STAGE_DIRECTION_COUNT) || (pSocket->au8StageCount[eDirection] >= DRV_SOCKET_STAGE_COUNT_MAX))
+    {
+        ESP_LOGE(TAG, "Socket %s stage not added (direction %d, %d stages max)", pSocket->cName, eDirection, DRV_SOCKET_STAGE_COUNT_MAX);
+        return false;
+    }
+    if (eDirection == DRV_SOCKET_STAGE_SEND)
+    {
+        int nHeadroom = u16Headroom;
+        for (int index = 0; index < pSocket->au8StageCount[eDirection]; index++)
+        {
+            nHeadroom += pSocket->asStage[eDirection][index].u16Headroom;
+        }
+        if (nHeadroom > DRV_SOCKET_STAGE_SEND_HEADROOM_MAX)
+        {
+            ESP_LOGE(TAG, "Socket %s send stage not added (headroom %d, %d max)", pSocket->cName, nHeadroom, DRV_SOCKET_STAGE_SEND_HEADROOM_MAX);
+            return false;
+        }
+    }
+    drv_socket_stage_t* pStage = &pSocket->asStage[eDirection][pSocket->au8StageCount[eDirection]];
+    pStage->pProcess = pProcess;
+    pStage->pArg = pArg;
+    pStage->u16Headroom = u16Headroom;
+    pStage->bIdle = false;
+    pSocket->au8StageCount[eDirection]++;
+    return true;
+}
+
+void socket_pipeline_add(drv_socket_t* pSocket, drv_socket_stage_direction_t eDirection, drv_socket_stage_process_t pProcess, void* pArg, uint16_t u16Headroom, bool bIdle)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    drv_socket_stage_t* pStage = &pRuntime->asPipeline[eDirection][pRuntime->au8PipelineCount[eDirection]++];
+
+    pStage->pProcess = pProcess;
+    pStage->pArg = pArg;
+    pStage->u16Headroom = u16Headroom;
+    pStage->bIdle = bIdle;
+    pRuntime->au16PipelineHeadroom[eDirection] += u16Headroom;
+}
+
+/* 
+ * compose the pipelines from the socket options and the application stages (read once at the task start):
+ * receive - identify, line ending, application stages, onReceive; send - ping, application stages
+ */
+void socket_pipeline_init(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    memset(pRuntime->au8PipelineCount, 0, sizeof(pRuntime->au8PipelineCount));
+    memset(pRuntime->au16PipelineHeadroom, 0, sizeof(pRuntime->au16PipelineHeadroom));
+
+    #if CONFIG_SOCKET_FEATURE_IDENTIFY
+    if (pSocket->bIndentifyForced)
+    {
+        socket_pipeline_add(pSocket, DRV_SOCKET_STAGE_RECV, socket_stage_identify, pSocket, 0, false);
+    }
+    #else
+    if (pSocket->bIndentifyForced)
+    {
+        ESP_LOGW(TAG, "Socket %s identification not available (CONFIG_SOCKET_FEATURE_IDENTIFY)", pSocket->cName);
+    }
+    #endif
+    #if CONFIG_SOCKET_FEATURE_LINE_ENDING
+    if (pSocket->bLineEndingFixCRLFToCR)
+    {
+        socket_pipeline_add(pSocket, DRV_SOCKET_STAGE_RECV, socket_stage_line_ending, pSocket, 0, false);
+    }
+    #else
+    if (pSocket->bLineEndingFixCRLFToCR)
+    {
+        ESP_LOGW(TAG, "Socket %s line ending fix not available (CONFIG_SOCKET_FEATURE_LINE_ENDING)", pSocket->cName);
+    }
+    #endif
+    #if CONFIG_SOCKET_FEATURE_PING
+    if (pSocket->bPingUse)
+    {
+        socket_pipeline_add(pSocket, DRV_SOCKET_STAGE_SEND, socket_stage_ping, pSocket, 0, true);
+    }
+    #else
+    if (pSocket->bPingUse)
+    {
+        ESP_LOGW(TAG, "Socket %s ping not available (CONFIG_SOCKET_FEATURE_PING)", pSocket->cName);
+    }
+    #endif
+    for (int eDirection = 0; eDirection < DRV_SOCKET_STAGE_DIRECTION_COUNT; eDirection++)
+    {
+        for (int index = 0; index < pSocket->au8StageCount[eDirection]; index++)
+        {
+            drv_socket_stage_t* pStage = &pSocket->asStage[eDirection][index];
+            socket_pipeline_add(pSocket, eDirection, pStage->pProcess, pStage->pArg, pStage->u16Headroom, pStage->bIdle);
+        }
+    }
+    if (pSocket->onReceive != NULL)
+    {
+        socket_pipeline_add(pSocket, DRV_SOCKET_STAGE_RECV, socket_stage_on_receive, pSocket, 0, false);
+    }
+}
+
+/* run the stages in order on the buffer - stops when the data is consumed or the connection is closed by a stage */
+int socket_pipeline_run(drv_socket_t* pSocket, drv_socket_stage_direction_t eDirection, int nConnectionIndex, uint8_t* pData, int nLength, int nSize)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    drv_socket_stage_t* pStage = pRuntime->asPipeline[eDirection];
+
+    for (int index = 0; index < pRuntime->au8PipelineCount[eDirection]; index++, pStage++)
+    {
+        if ((nLength <= 0) && (pStage->bIdle == false))
+        {
+            break;
+        }
+        nLength = pStage->pProcess(pStage->pArg, nConnectionIndex, pData, nLength, nSize);
+        if (socket_connection_active(pSocket, nConnectionIndex) == false)
+        {
+            return 0;
+        }
+    }
+    return nLength;
+}
+
+/* -1 - all connections */
+void drv_socket_flush(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    if (pSocket->pRuntime == NULL)
+    {
+        return;
+    }
+    for (int nSlot = 0; nSlot < pSocket->pRuntime->nSlotCount; nSlot++)
+    {
+        if (((nConnectionIndex < 0) || (nConnectionIndex == nSlot)) && socket_connection_active(pSocket, nSlot))
+        {
+            socket_connection_get(pSocket, nSlot)->bFlushRequest = true;
+        }
+    }
+    drv_socket_wake(pSocket);
+}
+
+typedef enum
+{
+    SOCKET_COALESCE_SEND,               /* coalescing off, nothing buffered or flush in progress */
+    SOCKET_COALESCE_HOLD,
+    SOCKET_COALESCE_FLUSH_REQUEST,      /* drv_socket_flush or a due ping */
+    SOCKET_COALESCE_FLUSH_SIZE,         /* u16CoalesceBytes buffered or the send stream full */
+    SOCKET_COALESCE_FLUSH_DEADLINE,
+} socket_coalesce_t;
+
+/* deadline since the first unsent byte - a size only setting gets the default (data below the size is not held forever) */
+uint32_t socket_coalesce_deadline_us(drv_socket_t* pSocket)
+{
+    return pSocket->u32CoalesceUs ? pSocket->u32CoalesceUs : DRV_SOCKET_COALESCE_DEFAULT_US;
+}
+
+/* send coalescing (u16CoalesceBytes/u32CoalesceUs) decision for the buffered data - no state change */
+socket_coalesce_t socket_coalesce_state(drv_socket_t* pSocket, drv_socket_connection_t* pConnection, int nPending)
+{
+    if (((pSocket->u16CoalesceBytes == 0) && (pSocket->u32CoalesceUs == 0)) || (nPending <= 0) || (pConnection->s64UnsentUs < 0))
+    {
+        return SOCKET_COALESCE_SEND;
+    }
+    if (pConnection->bFlushRequest || pConnection->bPingDue)
+    {
+        return SOCKET_COALESCE_FLUSH_REQUEST;
+    }
+    if ((pSocket->u16CoalesceBytes && (nPending >= pSocket->u16CoalesceBytes)) || (drv_stream_get_free(pConnection->pSendStream) == 0))
+    {
+        return SOCKET_COALESCE_FLUSH_SIZE;
+    }
+    if ((pConnection->s64UnsentUs > 0) && ((esp_timer_get_time() - pConnection->s64UnsentUs) >= socket_coalesce_deadline_us(pSocket)))
+    {
+        return SOCKET_COALESCE_FLUSH_DEADLINE;
+    }
+    return SOCKET_COALESCE_HOLD;
+}
+
+/* true - the buffered data is held (query only - socket_get_wait_ticks) */
+bool socket_coalesce_hold(drv_socket_t* pSocket, drv_socket_connection_t* pConnection, int nPending)
+{
+    return socket_coalesce_state(pSocket, pConnection, nPending) == SOCKET_COALESCE_HOLD;
+}
+
+/* 
+ * send coalescing state on send (socket_send): true - hold the buffered data. The deadline starts with the first 
+ * unsent byte, a flush (size, deadline, drv_socket_flush or a due ping) lasts until the send stream is empty.
+ */
+bool socket_coalesce_update(drv_socket_t* pSocket, drv_socket_connection_t* pConnection, int nPending)
+{
+    drv_socket_stats_t* pStats = &pSocket->pRuntime->stats;
+
+    if ((pSocket->u16CoalesceBytes == 0) && (pSocket->u32CoalesceUs == 0))
+    {
+        return false;
+    }
+    if (nPending <= 0)
+    {
+        pConnection->s64UnsentUs = 0;
+        pConnection->bFlushRequest = false;
+        drv_socket_timer_stop(&pSocket->pRuntime->timerWheel, &pConnection->timerCoalesce);
+        return false;
+    }
+    if (pConnection->s64UnsentUs == 0)
+    {
+        /* task wakeup only - the deadline is checked in us */
+        TickType_t nTicks = pdMS_TO_TICKS((socket_coalesce_deadline_us(pSocket) + 999) / 1000);
+        pConnection->s64UnsentUs = esp_timer_get_time();
+        drv_socket_timer_start(&pSocket->pRuntime->timerWheel, &pConnection->timerCoalesce, (nTicks > 0) ? nTicks : 1);
+    }
+
+    switch (socket_coalesce_state(pSocket, pConnection, nPending))
+    {
+        case SOCKET_COALESCE_HOLD:
+            return true;
+        case SOCKET_COALESCE_SEND:
+            return false;
+        case SOCKET_COALESCE_FLUSH_REQUEST:
+            pStats->u32FlushRequest++;
+            break;
+        case SOCKET_COALESCE_FLUSH_SIZE:
+            pStats->u32FlushSize++;
+            break;
+        case SOCKET_COALESCE_FLUSH_DEADLINE:
+            pStats->u32FlushDeadline++;
+            break;
+    }
+    pConnection->s64UnsentUs = -1;
+    pConnection->bFlushRequest = false;
+    drv_socket_timer_stop(&pSocket->pRuntime->timerWheel, &pConnection->timerCoalesce);
+    return false;
+}
+
+void socket_segment_count(drv_socket_t* pSocket, int nLength)
+{
+    int nBucket = 0;
+
+    for (int nSize = 64; (nSize <= nLength) && (nBucket < DRV_SOCKET_SEGMENT_BUCKETS - 1); nSize <<= 1)
+    {
+        nBucket++;
+    }
+    pSocket->pRuntime->stats.au32SegmentCount[nBucket]++;
+}
+
+void socket_send(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    int err;
+    int nSocketClient;
+    char sockTypeString[10];
+
+    nSocketClient = pConnection->nSocket;
+    if (pSocket->bServerType)
+    {
+        strcpy(sockTypeString, "client");
+    }
+    else
+    {
+        strcpy(sockTypeString, "");
+    }
+    #define MAX_TCP_SEND_SIZE 1024
+    #if (MAX_TCP_SEND_SIZE - DRV_SOCKET_DUAL_PATH_HEADER_SIZE - DRV_SOCKET_STAGE_SEND_HEADROOM_MAX) <= 0
+    #error "DRV_SOCKET_STAGE_SEND_HEADROOM_MAX leaves no send data space"
+    #endif
+
+    int nLength = MAX_TCP_SEND_SIZE;
+    uint8_t* au8Temp;
+
+
+
+    if (pConnection->bSendEnable)
+    {
+        if (pSocket->pRuntime->bDatagramMode)
+        {
+            socket_dgram_send(pSocket, nConnectionIndex);
+            return;
+        }
+        bool bDualPath;
+        bool bHeldRetry = (pConnection->pSendHeld != NULL);
+        int nHeaderSize;
+        uint8_t* pPayload;
+
+        if (bHeldRetry)
+        {
+            /* frame postponed by EAGAIN/ENOMEM - sent as it is before any new data (rate checked at the pull) */
+            au8Temp = pConnection->pSendHeld;
+            pConnection->pSendHeld = NULL;
+            bDualPath = pConnection->bSendHeldDualPath;
+            nHeaderSize = pConnection->u8SendHeldHeader;
+            pPayload = au8Temp + nHeaderSize;
+            nLength = pConnection->u16SendHeldLength;
+        }
+        else
+        {
+            int nPending = drv_stream_get_size(pConnection->pSendStream);
+            if (socket_coalesce_update(pSocket, pConnection, nPending))
+            {
+                return;     /* timerCoalesce, a push or drv_socket_flush wakes the task */
+            }
+            int nAllowed = socket_rate_allowed(pSocket, pConnection, nPending);
+            if (nAllowed < 0)
+            {
+                return;     /* socket_get_wait_ticks wakes the task when the tokens are available */
+            }
+            au8Temp = malloc(nLength);
+            if (au8Temp == NULL)
+            {
+                ESP_LOGE(TAG, "Error during allocate %d bytes for send from %s socket %s[%d] %d", nLength, sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient);
+                return;
+            }
+            bDualPath = socket_dual_path_active(pSocket);
+            nHeaderSize = bDualPath ? DRV_SOCKET_DUAL_PATH_HEADER_SIZE : socket_heartbeat_record_size(pSocket);
+            pPayload = au8Temp + nHeaderSize;
+
+            nLength -= nHeaderSize + pSocket->pRuntime->au16PipelineHeadroom[DRV_SOCKET_STAGE_SEND];
+            if (nLength > nAllowed)
+            {
+                nLength = nAllowed;
+            }
+            nLength = drv_stream_pull(pConnection->pSendStream, pPayload, nLength);
+            nLength = socket_pipeline_run(pSocket, DRV_SOCKET_STAGE_SEND, nConnectionIndex, pPayload, nLength, MAX_TCP_SEND_SIZE - nHeaderSize);
+            if (nLength > 0)
+            {
+                if (bDualPath)
+                {
+                    socket_dual_path_header(pSocket, au8Temp, 0);
+                }
+                else if (nHeaderSize)
+                {
+                    socket_heartbeat_record(au8Temp, nLength);
+                }
+                nLength += nHeaderSize;
+            }
+        }
+
+        if(nLength > 0)
+        {
+            int nLengthSent;
+            nLengthSent = pSocket->pRuntime->pSendIo(pSocket, nConnectionIndex, au8Temp, nLength);
+            pConnection->stats.u32SendCalls++;
+            if (nLengthSent > 0)
+            {
+                pConnection->stats.u64BytesOut += nLengthSent;
+                pConnection->stats.u32PacketsOut++;
+                socket_rate_consume(pSocket, pConnection, nLengthSent);
+                socket_segment_count(pSocket, nLengthSent);
+            }
+            SOCKET_TRACE(DRV_TRACE_LEVEL_DEBUG, DRV_SOCKET_TRACE_SEND, pSocket, nConnectionIndex, nSocketClient, nLengthSent, nLength);
+            if (bDualPath && (bHeldRetry == false))
+            {
+                /* same datagram (same sequence) on the alternate interface - regardless of the active path result */
+                socket_dual_path_send(pSocket, au8Temp, nLength, nLengthSent == nLength);
+            }
+            
+            if (nLengthSent > 0)
+            {
+                if (nLengthSent != nLength)
+                {
+                    pConnection->stats.u32ShortWrites++;
+                    ESP_LOGE(TAG, "Error during send to %s socket %s[%d] %d: send %d/%d bytes", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, nLengthSent, nLength);
+                    //socket_disconnect(pSocket);
+                    socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+                }
+                else
+                {
+                    if (pSocket->onSend != NULL)
+                    {
+                        pSocket->onSend(nConnectionIndex, (char*)pPayload, nLengthSent - nHeaderSize);
+                    }
+                    
+                }
+            }
+            else
+            {
+                err = errno;
+                if ((err == EAGAIN) || (err == EWOULDBLOCK) || (err == ENOMEM))
+                {
+                    /* socket buffer full (non-blocking socket) or no buffers - frame kept, connection kept */
+                    pConnection->pSendHeld = au8Temp;
+                    pConnection->u16SendHeldLength = nLength;
+                    pConnection->u8SendHeldHeader = nHeaderSize;
+                    pConnection->bSendHeldDualPath = bDualPath;
+                    au8Temp = NULL;
+                    if (err != ENOMEM)
+                    {
+                        pConnection->stats.u32Again++;
+                        pConnection->bSendNotReady = true;  /* socket_wait_events waits until writable */
+                    }
+                }
+                else
+                {
+                    ESP_LOGE(TAG, "Error during send to %s socket %s[%d] %d: errno %d (%s)", sockTypeString, pSocket->cName, nConnectionIndex, nSocketClient, err, strerror(err));
+                    drv_socket_link_report_loss(pSocket->pRuntime->adapter_if);
+                    //socket_disconnect(pSocket);
+                    socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+                }
+            }
+        }
+        free(au8Temp);
+    }
+    else
+    {
+        if (pConnection->bIndentifyNeeded)
+        {
+            /* socket_timer_identify enables the send on timeout */
+        }
+        else
+        {
+            pConnection->bSendEnable = true;
+        }
+    }
+}
+
+void socket_timer_ping(void* pArg, int nConnectionIndex)
+{
+    drv_socket_t* pSocket = (drv_socket_t*)pArg;
+
+    socket_connection_get(pSocket, nConnectionIndex)->bPingDue = true;
+}
+
+void socket_timer_identify(void* pArg, int nConnectionIndex)
+{
+    drv_socket_t* pSocket = (drv_socket_t*)pArg;
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+
+    if (pConnection->bIndentifyNeeded)
+    {
+        ESP_LOGE(TAG, "Send Enable and Identify disable on Timeout socket %s[%d] %d", pSocket->cName, nConnectionIndex, pConnection->nSocket);
+        #if CONFIG_SOCKET_FEATURE_IDENTIFY
+        if (pSocket->bIndentifyForced)
+        {
+            send_identification_answer(pSocket, nConnectionIndex);    //forced send identification
+        }
+        #endif
+
+        pConnection->bSendEnable = true;
+        pConnection->bIndentifyNeeded = false;
+    }
+}
+
+/* connection timers are linked in the runtime wheel - stop before the connection returns to the pool */
+void socket_connection_timers_stop(drv_socket_t* pSocket, drv_socket_connection_t* pConnection)
+{
+    drv_socket_timer_wheel_t* pWheel = &pSocket->pRuntime->timerWheel;
+
+    drv_socket_timer_stop(pWheel, &pConnection->timerPing);
+    drv_socket_timer_stop(pWheel, &pConnection->timerIdentify);
+    drv_socket_timer_stop(pWheel, &pConnection->timerHeartbeat);
+    drv_socket_timer_stop(pWheel, &pConnection->timerCoalesce);
+}
+
+/* (re)start of the send enable deadlines on a new or migrated connection */
+void socket_connection_timers_start(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    drv_socket_timer_wheel_t* pWheel = &pSocket->pRuntime->timerWheel;
+
+    pConnection->bPingDue = false;
+    if (SOCKET_PING_USE(pSocket))
+    {
+        drv_socket_timer_start(pWheel, &pConnection->timerPing, pdMS_TO_TICKS(DRV_SOCKET_PING_SEND_TIME_MS));
+    }
+    if (pConnection->bIndentifyNeeded)
+    {
+        drv_socket_timer_start(pWheel, &pConnection->timerIdentify, pdMS_TO_TICKS(DRV_SOCKET_IDENTIFY_TIMEOUT_MS));
+    }
+    else
+    {
+        drv_socket_timer_stop(pWheel, &pConnection->timerIdentify);
+    }
+}
+
+/* IPv4 address of an adapter interface (INADDR_ANY - default interface, INADDR_NONE - not available) */
+in_addr_t socket_get_interface_address(esp_interface_t adapter_if)
+{
+    esp_netif_ip_info_t ip_info;
+    struct sockaddr_in adapter_interface_addr;
+
+    adapter_interface_addr.sin_addr.s_addr = htonl(INADDR_NONE);
+
+    if(adapter_if == ESP_IF_WIFI_STA)
+    {
+        #if CONFIG_USE_WIFI
+        esp_netif_t* esp_netif = drv_wifi_get_netif_sta();
+        if (esp_netif != NULL)
+        {
+            esp_netif_get_ip_info(esp_netif, &ip_info);
+            inet_addr_from_ip4addr(&adapter_interface_addr.sin_addr,&ip_info.ip);
+        }
+        #else
+        adapter_interface_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        #endif
+    }
+    else 
+    if(adapter_if == ESP_IF_WIFI_AP)
+    {
+        #if CONFIG_USE_WIFI
+        esp_netif_t* esp_netif = drv_wifi_get_netif_ap();
+        if (esp_netif != NULL)
+        {
+            esp_netif_get_ip_info(esp_netif, &ip_info);
+            inet_addr_from_ip4addr(&adapter_interface_addr.sin_addr,&ip_info.ip);
+        }
+        #else
+        adapter_interface_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        #endif
+    }
+    else //if(adapter_if >= ESP_IF_ETH)
+    {
+        #if CONFIG_USE_ETHERNET
+        int eth_index = adapter_if - ESP_IF_ETH;
+        if (drv_eth_get_netif_count() > eth_index)
+        {
+            esp_netif_t* esp_netif = drv_eth_get_netif(eth_index);
+            if (esp_netif != NULL)
+            {
+                esp_netif_get_ip_info(esp_netif, &ip_info);
+                inet_addr_from_ip4addr(&adapter_interface_addr.sin_addr,&ip_info.ip);
+            }
+        }
+        else    /* use default */
+        #endif
+        {
+            adapter_interface_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        }
+    }
+    return adapter_interface_addr.sin_addr.s_addr;
+}
+
+void socket_get_adapter_interface_ip(drv_socket_t* pSocket)
+{
+    /* Get IP Address of the selected adapter interface (new selected ip address stored as string in pSocket->pRuntime->cAdapterInterfaceIP) */
+    struct sockaddr_in adapter_interface_addr;
+
+    adapter_interface_addr.sin_addr.s_addr = socket_get_interface_address(pSocket->pRuntime->adapter_if);
+
+    in_addr_t interface_address = adapter_interface_addr.sin_addr.s_addr;
+    char *adapter_interface_ip = ip4addr_ntoa_r((ip4_addr_t*)&adapter_interface_addr.sin_addr.s_addr, pSocket->pRuntime->cAdapterInterfaceIP, sizeof(pSocket->pRuntime->cAdapterInterfaceIP));
+    
+    if (interface_address == htonl(INADDR_NONE))
+    {
+        ESP_LOGE(TAG, "Socket %s bad or unimplemented adapter interface selected: %d", pSocket->cName, pSocket->pRuntime->adapter_if);
+    }
+    else if (interface_address == htonl(INADDR_ANY))
+    {
+        ESP_LOGW(TAG, "Socket %s default adapter interface selected IP: %s", pSocket->cName, adapter_interface_ip);
+    }
+    else
+    {
+        ESP_LOGI(TAG, "Socket %s adapter interface selected IP: %s", pSocket->cName, adapter_interface_ip);
+    }
+
+    //pSocket->pRuntime->adapter_interface_ip_address = interface_address;
+}
+
+void socket_prepare_adapter_interface_ip_info(drv_socket_t* pSocket)
+{
+    /* Configure Bind to IP Info (Adapter interface Info) */
+    #ifdef CONFIG_EXAMPLE_IPV6
+    // Note that by default IPV6 binds to both protocols, it is must be disabled
+    // if both protocols used at the same time (used in CI)
+    if (pSocket->bIPV6)setsockopt(pSocket->nSocketIndex, IPPROTO_IPV6, IPV6_V6ONLY, &opt, sizeof(opt));
+    #endif
+
+    #ifdef CONFIG_EXAMPLE_IPV6
+    if (pSocket->bIPV6)
+    {
+        struct sockaddr_in6 *dest_addr_ip6 = (struct sockaddr_in6 *)&pSocket->pRuntime->adapterif_addr;
+        bzero(&dest_addr_ip6->sin6_addr.un, sizeof(dest_addr_ip6->sin6_addr.un));
+        dest_addr_ip6->sin6_family = pSocket->address_family;
+        dest_addr_ip6->sin6_port = htons(pSocket->u16Port);
+    }
+    else
+    #endif
+    {
+        struct sockaddr_in *dest_addr_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->adapterif_addr;
+        //dest_addr_ip4->sin_addr.s_addr = pSocket->pRuntime->adapter_interface_ip_address;
+        dest_addr_ip4->sin_addr.s_addr = inet_addr(pSocket->pRuntime->cAdapterInterfaceIP);
+        dest_addr_ip4->sin_family = pSocket->address_family;
+        dest_addr_ip4->sin_port = htons(pSocket->u16Port);
+    }
+}
+
+
+
+void clear_dns_cache() 
+{
+    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    if (netif == NULL) {
+        printf("Failed to get netif handle\n");
+        return;
+    }
+    esp_netif_dns_info_t dns_info = {0};
+    dns_info.ip.u_addr.ip4.addr = 0;
+    esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns_info);
+    esp_netif_set_dns_info(netif, ESP_NETIF_DNS_BACKUP, &dns_info);
+}
+
+uint32_t drv_socket_caller_id;
+
+/* try resolve cURL to IP Address. If not resolved - use cHostIP */
+char* socket_get_host_ip_address(drv_socket_t* pSocket)
+{
+    char* pLastUsedHostIP = NULL;
+    bool bURLResolved;
+
+    /* Try Resolve URL */
+    bURLResolved = false;
+    if ((pSocket->cURL != NULL) && (strlen(pSocket->cURL) > 0))
+    {
+        drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+        drv_dns_request_t* pDnsRefresh = pRuntime->pDnsRefresh;
+
+        /* take the completed background resolve (used from this connect on) */
+        if ((pDnsRefresh != NULL) && (pDnsRefresh->bBusy == false) && pDnsRefresh->bResolved)
+        {
+            pDnsRefresh->bResolved = false;
+            if (strcmp(pDnsRefresh->cResolveIP, pSocket->cHostIPResolved) != 0)
+            {
+                ESP_LOGW(TAG, "Socket %s URL %s address changed %s -> %s", pSocket->cName, pSocket->cURL, pSocket->cHostIPResolved, pDnsRefresh->cResolveIP);
+                strncpy(pSocket->cHostIPResolved, pDnsRefresh->cResolveIP, sizeof(pSocket->cHostIPResolved) - 1);
+            }
+        }
+
+        if (pRuntime->bEndpointCached && (pRuntime->u16ReconnectAttempt < DRV_SOCKET_ENDPOINT_CACHE_TRIES))
+        {
+            /* fast reconnect to the last good endpoint - refresh in background for the next connect */
+            ESP_LOGI(TAG, "Socket %s reuse URL %s ip address: %s", pSocket->cName, pSocket->cURL, pSocket->cHostIPResolved);
+            if (pDnsRefresh == NULL)
+            {
+                pDnsRefresh = drv_dns_request_create();
+                pRuntime->pDnsRefresh = pDnsRefresh;
+            }
+            if (pDnsRefresh != NULL)
+            {
+                drv_dns_resolve_async(pDnsRefresh, pSocket->cURL);
+            }
+            return pSocket->cHostIPResolved;
+        }
+        pRuntime->bEndpointCached = false;
+
+        ESP_LOGI(TAG, "Socket %s Start resolve URL %s", pSocket->cName, pSocket->cURL);
+
+        drv_socket_stats_t* pStats = &pRuntime->stats;
+        int64_t s64TimeStartUs = esp_timer_get_time();
+        bURLResolved = drv_dns_resolve(pSocket->cURL, pSocket->cHostIPResolved, sizeof(pSocket->cHostIPResolved), &pSocket->bActiveTask);
+        pStats->u32DnsTimeLastMs = (uint32_t)((esp_timer_get_time() - s64TimeStartUs) / 1000);
+        if (pStats->u32DnsTimeLastMs > pStats->u32DnsTimeMaxMs) pStats->u32DnsTimeMaxMs = pStats->u32DnsTimeLastMs;
+        if (bURLResolved)
+        {
+            ESP_LOGI(TAG, "Socket %s resolved URL %s to ip address: %s", pSocket->cName, pSocket->cURL, pSocket->cHostIPResolved);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Socket %s Fail resolve URL %s - use default IP: %s", pSocket->cName,pSocket->cURL, pSocket->cHostIP);
+        }
+
+        ESP_LOGI(TAG, "Socket %s Final resolve URL %s", pSocket->cName, pSocket->cURL); 
+    }
+
+    if(bURLResolved)  
+    {
+        pLastUsedHostIP = pSocket->cHostIPResolved;
+    } 
+    else
+    {
+        pLastUsedHostIP = pSocket->cHostIP;
+    }
+
+    return pLastUsedHostIP;
+}
+
+void socket_prepare_host_ip_info(drv_socket_t* pSocket)
+{
+    char cRecvFromIP[16] = "255.255.255.255";
+    char* pRecvFromIP = cRecvFromIP;
+
+    //char cSendToIP[16] = "192.168.3.118";
+    char cSendToIP[16] = "255.255.255.255";
+    char* pSendToIP = cSendToIP;
+
+
+    /* Host IP Address Preparation - host_addr_main */
+    pSocket->pRuntime->bBroadcastRxTx = false;
+    #ifdef CONFIG_EXAMPLE_IPV6
+    if (pSocket->bIPV6)
+    {
+        struct sockaddr_in6 *host_addr_ip6 = (struct sockaddr_in6 *)&pSocket->pRuntime->host_addr_main;
+        host_addr_ip6->sin6_addr.un = inet_addr(pSocket->pRuntime->pLastUsedHostIP);
+        host_addr_ip6->sin6_family = pSocket->address_family;
+        host_addr_ip6->sin6_port = htons(pSocket->u16Port);
+
+        struct sockaddr_in6 *host_addr_recv_ip6 = (struct sockaddr_in6 *)&pSocket->pRuntime->host_addr_recv;
+        host_addr_recv_ip6->sin6_addr.un = inet_addr(pRecvFromIP);
+        host_addr_recv_ip6->sin6_family = pSocket->address_family;
+        host_addr_recv_ip6->sin6_port = htons(pSocket->u16Port);
+
+        struct sockaddr_in6 *host_addr_send_ip6 = (struct sockaddr_in6 *)&pSocket->pRuntime->host_addr_send;
+        host_addr_send_ip6->sin6_addr.un = inet_addr(pSendToIP);
+        host_addr_send_ip6->sin6_family = pSocket->address_family;
+        host_addr_send_ip6->sin6_port = htons(pSocket->u16Port);
+    }
+    else
+    #endif
+    {
+        struct sockaddr_in *host_addr_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->host_addr_main;
+        host_addr_ip4->sin_addr.s_addr = inet_addr(pSocket->pRuntime->pLastUsedHostIP);
+        host_addr_ip4->sin_family = pSocket->address_family;
+        host_addr_ip4->sin_port = htons(pSocket->u16Port);
+
+        struct sockaddr_in *host_addr_recv_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->host_addr_recv;
+        host_addr_recv_ip4->sin_addr.s_addr = inet_addr(pRecvFromIP);
+        host_addr_recv_ip4->sin_family = pSocket->address_family;
+        host_addr_recv_ip4->sin_port = htons(pSocket->u16Port);
+
+        struct sockaddr_in *host_addr_send_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->host_addr_send;
+        host_addr_send_ip4->sin_addr.s_addr = inet_addr(pSendToIP);
+        host_addr_send_ip4->sin_family = pSocket->address_family;
+        host_addr_send_ip4->sin_port = htons(pSocket->u16Port);
+
+        #if CONFIG_SOCKET_FEATURE_BROADCAST
+        if (((host_addr_ip4->sin_addr.s_addr >> 0) & 0xFF) == 0xFF)pSocket->pRuntime->bBroadcastRxTx = true;
+        if (((host_addr_ip4->sin_addr.s_addr >> 8) & 0xFF) == 0xFF)pSocket->pRuntime->bBroadcastRxTx = true;
+        if (((host_addr_ip4->sin_addr.s_addr >>16) & 0xFF) == 0xFF)pSocket->pRuntime->bBroadcastRxTx = true;
+        if (((host_addr_ip4->sin_addr.s_addr >>24) & 0xFF) == 0xFF)pSocket->pRuntime->bBroadcastRxTx = true;
+        #endif
+    }
+    socket_io_select(pSocket);
+
+    ESP_LOGI(TAG, "Socket %s Bind/Connect: %s", pSocket->cName, pSocket->pRuntime->pLastUsedHostIP); 
+    ESP_LOGI(TAG, "Socket %s RecvFrom:     %s", pSocket->cName, pRecvFromIP); 
+    ESP_LOGI(TAG, "Socket %s SendTo:       %s", pSocket->cName, pSendToIP); 
+
+
+}
+
+void socket_strt(drv_socket_t* pSocket)
+{
+    int err;
+    int nSocketIndex = socket(pSocket->address_family, pSocket->protocol_type, pSocket->protocol);
+
+    if (nSocketIndex < 0) 
+    {
+        err = errno;
+        ESP_LOGE(TAG, "Unable to create socket %s %d: errno %d (%s)", pSocket->cName, nSocketIndex, err, strerror(err));
+    }
+    else
+    {
+        ESP_LOGI(TAG, "Created socket %s %d: AdapterIF: %d Address Family: %d", pSocket->cName, nSocketIndex, pSocket->pRuntime->adapter_if, pSocket->address_family);
+    }
+    if (pSocket->bServerType)
+    {
+        pSocket->nSocketIndexServer = nSocketIndex;
+    }
+    else
+    if (nSocketIndex < 0)
+    {
+        socket_reconnect_schedule(pSocket);
+    }
+    else
+    {
+        if (socket_connection_add_to_list(pSocket, nSocketIndex, NULL) < 0)
+        {
+            /* connection pool exhausted - the descriptor is not kept, next attempt after the backoff */
+            close(nSocketIndex);
+            socket_reconnect_schedule(pSocket);
+        }
+        //pSocket->nSocketIndexPrimer = nSocketIndex;
+    }
+}
+
+void socket_connect_server_periodic(drv_socket_t* pSocket)
+{
+    int err;
+
+
+    ESP_LOGD(TAG, "Socket %s %d periodic check incoming connections", pSocket->cName, pSocket->nSocketIndexServer);
+
+    struct sockaddr_storage source_addr; // Large enough for both IPv4 or IPv6
+    socklen_t addr_len = sizeof(source_addr);
+
+    // Set a timeout of 0 ms
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+
+    // Set the socket to non-blocking mode
+    fcntl(pSocket->nSocketIndexServer, F_SETFL, O_NONBLOCK);
+
+    // Use select() to wait for the socket to become readable or for the timeout to expire
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(pSocket->nSocketIndexServer, &rfds);
+    int ready = select(pSocket->nSocketIndexServer + 1, &rfds, NULL, NULL, &timeout);
+
+    if (ready < 0) 
+    {
+        ESP_LOGE(TAG, "Socket %s %d Error in select() function: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, errno, strerror(errno));
+        socket_disconnect(pSocket);
+        //close(pSocket->nSocketIndexServer);
+        //pSocket->nSocketIndexServer = -1;
+    } 
+    else if (ready == 0) 
+    {
+        if (pSocket->pRuntime->timerAcceptLog.bActive == false)
+        {
+            drv_socket_timer_start(&pSocket->pRuntime->timerWheel, &pSocket->pRuntime->timerAcceptLog, pdMS_TO_TICKS(DRV_SOCKET_ACCEPT_LOG_TIME_MS));
+            ESP_LOGW(TAG, "Socket %s %d Timeout waiting for client to connect", pSocket->cName, pSocket->nSocketIndexServer);
+        }
+        //socket_disconnect(pSocket);
+        //close(pSocket->nSocketIndexServer);
+        //pSocket->nSocketIndexServer = -1;
+    } 
+    else 
+    {
+        int nNewSocketClientIndex = accept(pSocket->nSocketIndexServer, (struct sockaddr *)&source_addr, &addr_len);
+        if (nNewSocketClientIndex < 0) 
+        {
+            err = errno;
+            ESP_LOGE(TAG, "Socket %s %d Unable to accept connection %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, nNewSocketClientIndex, err, strerror(err));
+            //socket_disconnect(pSocket); //To Do check not to disconnect socket if no more connections available
+            //close(pSocket->nSocketIndexServer);
+            //pSocket->nSocketIndexServer = -1;
+        }
+        else
+        {
+            char addr_str[128];
+            if (source_addr.ss_family == PF_INET) 
+            {
+                inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str) - 1);
+            }
+            else if (source_addr.ss_family == PF_INET6) 
+            {
+                #if LWIP_IPV6
+                inet6_ntoa_r(((struct sockaddr_in6 *)&source_addr)->sin6_addr, addr_str, sizeof(addr_str) - 1);
+                #else
+                ESP_LOGE(TAG, "Socket %s %d IPv6 Need LWIP_IPV6 defined", pSocket->cName, pSocket->nSocketIndexServer);
+                #endif
+            }
+            ESP_LOGI(TAG, "Socket %s %d accepted ip address: %s", pSocket->cName, pSocket->nSocketIndexServer, addr_str);
+
+            if (socket_connection_add_to_list(pSocket, nNewSocketClientIndex, &source_addr) < 0)
+            {
+                pSocket->pRuntime->stats.u32Rejects++;
+                shutdown(nNewSocketClientIndex, SHUT_RDWR);
+                close(nNewSocketClientIndex);
+            }
+            else
+            {
+                pSocket->pRuntime->stats.u32Accepts++;
+            }
+            
+            //pSocket->nSocketIndexPrimer = nNewSocketClientIndex;
+        }
+    }
+    // Set the socket back to blocking mode
+    fcntl(pSocket->nSocketIndexServer, F_SETFL, 0);
+
+}
+
+void socket_connect_server(drv_socket_t* pSocket)
+{
+    int err = 0;
+
+    int opt = 1;
+    socklen_t optlen = sizeof(opt);
+
+    int ret_so;
+
+    ret_so = getsockopt( pSocket->nSocketIndexServer , SOL_SOCKET, SO_REUSEADDR,(void*)&opt, &optlen);
+    if (ret_so < 0)
+    {
+        err = errno;
+        ESP_LOGE(TAG, LOG_COLOR(LOG_COLOR_CYAN)"Socket %s %d getsockopt  SO_REUSEADDR=%d retv = %d. errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, opt, ret_so, err, strerror(errno));
+    }
+
+    opt = 1;
+    ret_so = setsockopt( pSocket->nSocketIndexServer , SOL_SOCKET, SO_REUSEADDR,(void*)&opt, sizeof(opt));
+    if (ret_so < 0)
+    {
+        err = errno;
+        ESP_LOGE(TAG, LOG_COLOR(LOG_COLOR_CYAN)"Socket %s %d setsockopt  SO_REUSEADDR=%d retv = %d. errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, opt, ret_so, err, strerror(errno));
+    }
+
+    //vTaskDelay(pdMS_TO_TICKS(100));
+
+
+
+    int eError = bind(pSocket->nSocketIndexServer, (struct sockaddr *)&pSocket->pRuntime->adapterif_addr, sizeof(pSocket->pRuntime->adapterif_addr));
+    if (eError != 0) 
+    {
+        err = errno;
+        ESP_LOGE(TAG, "Socket %s %d unable to bind: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));
+
+        struct sockaddr_in *test_addr_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->adapterif_addr;
+        //dest_addr_ip4->sin_addr.s_addr = pSocket->pRuntime->adapter_interface_ip_address;
+
+        in_addr_t interfaceAddress = test_addr_ip4->sin_addr.s_addr;
+        const ip4_addr_t* pInterfaceAddress = (const ip4_addr_t*)&interfaceAddress;
+        char cAdapterInterfaceIP[16];
+        char *adapter_interface_ip = ip4addr_ntoa_r(pInterfaceAddress, cAdapterInterfaceIP, sizeof(cAdapterInterfaceIP));
+        ESP_LOGW(TAG, "Socket %s %d adapterif addr:%s port:%d family:%d", pSocket->cName, pSocket->nSocketIndexServer, adapter_interface_ip, htons(test_addr_ip4->sin_port), test_addr_ip4->sin_family);
+        
+        socket_disconnect(pSocket);
+        //close(pSocket->nSocketIndexServer);
+        //pSocket->nSocketIndexServer = -1;
+    }
+    else
+    if (pSocket->pRuntime->bPeerDemux)
+    {
+        /* UDP server - no listen/accept, a peer becomes a connection with its first datagram (socket_peer_recv) */
+        socket_set_fd_options(pSocket, -1, pSocket->nSocketIndexServer);
+        fcntl(pSocket->nSocketIndexServer, F_SETFL, O_NONBLOCK);
+        ESP_LOGI(TAG, "Socket %s %d bound to IF %s:%d (UDP peers)", pSocket->cName, pSocket->nSocketIndexServer, pSocket->pRuntime->cAdapterInterfaceIP, pSocket->u16Port);
+    }
+    else
+    {
+        ESP_LOGI(TAG, "Socket %s %d bound to IF %s:%d", pSocket->cName, pSocket->nSocketIndexServer, pSocket->pRuntime->cAdapterInterfaceIP, pSocket->u16Port);
+
+        eError = listen(pSocket->nSocketIndexServer, 1);
+        if (eError != 0) 
+        {
+            err = errno;
+            ESP_LOGE(TAG, "Error occurred during listen socket %s %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));
+            socket_disconnect(pSocket);
+            //close(pSocket->nSocketIndexServer);
+            //pSocket->nSocketIndexServer = -1;
+        }
+        else
+        {
+            ESP_LOGI(TAG, "Socket %s %d listening", pSocket->cName, pSocket->nSocketIndexServer);
+
+            struct sockaddr_storage source_addr; // Large enough for both IPv4 or IPv6
+            socklen_t addr_len = sizeof(source_addr);
+
+            // Set a timeout of 30 seconds
+            struct timeval timeout;
+            timeout.tv_sec = 30;
+            timeout.tv_usec = 0;
+
+            // Set the socket to non-blocking mode
+            fcntl(pSocket->nSocketIndexServer, F_SETFL, O_NONBLOCK);
+
+            // Use select() to wait for the socket to become readable or for the timeout to expire
+            fd_set rfds;
+            FD_ZERO(&rfds);
+            FD_SET(pSocket->nSocketIndexServer, &rfds);
+            int ready = select(pSocket->nSocketIndexServer + 1, &rfds, NULL, NULL, &timeout);
+
+            if (ready < 0) 
+            {
+                ESP_LOGE(TAG, "Socket %s %d Error in select() function: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, errno, strerror(errno));
+                socket_disconnect(pSocket);
+                //close(pSocket->nSocketIndexServer);
+                //pSocket->nSocketIndexServer = -1;
+            } 
+            else if (ready == 0) 
+            {
+                ESP_LOGW(TAG, "Socket %s %d Timeout waiting for client to connect", pSocket->cName, pSocket->nSocketIndexServer);
+                //socket_disconnect(pSocket);
+                //close(pSocket->nSocketIndexServer);
+                //pSocket->nSocketIndexServer = -1;
+            } 
+            else 
+            {
+                int nNewSocketClientIndex = accept(pSocket->nSocketIndexServer, (struct sockaddr *)&source_addr, &addr_len);
+                if (nNewSocketClientIndex < 0) 
+                {
+                    err = errno;
+                    ESP_LOGE(TAG, "Socket %s %d Unable to accept connection %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, nNewSocketClientIndex, err, strerror(err));
+                    socket_disconnect(pSocket);
+                    //close(pSocket->nSocketIndexServer);
+                    //pSocket->nSocketIndexServer = -1;
+                }
+                else
+                {
+                    char addr_str[128];
+                    if (source_addr.ss_family == PF_INET) 
+                    {
+                        inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str) - 1);
+                    }
+                    else if (source_addr.ss_family == PF_INET6) 
+                    {
+                        #if LWIP_IPV6
+                        inet6_ntoa_r(((struct sockaddr_in6 *)&source_addr)->sin6_addr, addr_str, sizeof(addr_str) - 1);
+                        #else
+                        ESP_LOGE(TAG, "Socket %s %d IPv6 Need LWIP_IPV6 defined", pSocket->cName, pSocket->nSocketIndexServer);
+                        #endif
+                    }
+                    ESP_LOGI(TAG, "Socket %s %d accepted ip address: %s", pSocket->cName, pSocket->nSocketIndexServer, addr_str);
+
+                    if (socket_connection_add_to_list(pSocket, nNewSocketClientIndex, &source_addr) < 0)
+                    {
+                        pSocket->pRuntime->stats.u32Rejects++;
+                        shutdown(nNewSocketClientIndex, SHUT_RDWR);
+                        close(nNewSocketClientIndex);
+                    }
+                    else
+                    {
+                        pSocket->pRuntime->stats.u32Accepts++;
+                    }
+                     //pSocket->nSocketIndexPrimer = nNewSocketClientIndex;
+                }
+            }
+            // Set the socket back to blocking mode
+            fcntl(pSocket->nSocketIndexServer, F_SETFL, 0);
+        }
+    }
+}
+
+void socket_connect_client(drv_socket_t* pSocket)
+{
+    int err;
+    
+    if (pSocket->nSocketConnectionsCount != 1)
+    {
+        ESP_LOGE(TAG, "Socket %s unexpected client type with %d connections ", pSocket->cName, pSocket->nSocketConnectionsCount);
+    }
+    else
+    {
+        drv_socket_connection_t* pConnection = socket_connection_get(pSocket, socket_connection_slot(pSocket, 0));
+
+        /* client bind should be not neccesairy because an auto bind will take place at first send/recv/sendto/recvfrom using a system assigned local port */
+        int eError = bind(pConnection->nSocket, (struct sockaddr *)&pSocket->pRuntime->adapterif_addr, sizeof(pSocket->pRuntime->adapterif_addr));
+        if (eError != 0) 
+        {
+            err = errno;
+            ESP_LOGE(TAG, "Socket %s %d unable to bind: errno %d (%s)", pSocket->cName, pConnection->nSocket, err, strerror(err));
+            socket_disconnect(pSocket);
+            //close(pSocket->nSocketIndexPrimer);
+            //pSocket->nSocketIndexPrimer = -1;
+        }
+        else
+        {
+            ESP_LOGI(TAG, "Socket %s %d bound to IF %s:%d", pSocket->cName, pConnection->nSocket, pSocket->pRuntime->cAdapterInterfaceIP, pSocket->u16Port);
+
+            /* Connect to the host by the network interface */
+            if (SOCKET_BROADCAST(pSocket->pRuntime) == false)
+            {
+                int eError = connect(pConnection->nSocket, (struct sockaddr *)&pSocket->pRuntime->host_addr_main, sizeof(pSocket->pRuntime->host_addr_main));
+                if (eError != 0) 
+                {
+                    err = errno;
+                    ESP_LOGE(TAG, "Socket %s %d unable to connect: errno %d (%s)", pSocket->cName, pConnection->nSocket, err, strerror(err));
+                    socket_disconnect(pSocket);
+                    //close(pSocket->nSocketIndexPrimer);
+                    //pSocket->nSocketIndexPrimer = -1; 
+                }
+                else
+                {
+                    ESP_LOGI(TAG, "Socket %s %d connected, port %d", pSocket->cName, pConnection->nSocket, pSocket->u16Port);
+                }
+            }
+            else
+            {
+                ESP_LOGI(TAG, "Socket %s %d connected only trough bind (broadcast host address detected), port %d", pSocket->cName, pConnection->nSocket, pSocket->u16Port);
+            }
+        }
+    }
+}
+
+void socket_prepare_ip_info(drv_socket_t* pSocket)
+{
+    socket_get_adapter_interface_ip(pSocket);
+    socket_prepare_adapter_interface_ip_info(pSocket);
+
+    pSocket->pRuntime->pLastUsedHostIP = socket_get_host_ip_address(pSocket);
+    socket_prepare_host_ip_info(pSocket);
+}
+
+/* nConnectionIndex is used for the log only (-1 standby socket) */
+void socket_set_fd_options(drv_socket_t* pSocket, int nConnectionIndex, int nSocket)
+{
+    int err;
+    drv_socket_options_t options;
+
+    drv_socket_get_options(pSocket, &options);
+
+    /* When changed with primer socket here was the main socket (nSocketIndex) */
+    if (pSocket->bPermitBroadcast)
+    {
+        int bc = 1;
+        if (setsockopt(nSocket, SOL_SOCKET, SO_BROADCAST, &bc, sizeof(bc)) < 0)
+        {
+            err = errno;
+            ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option permit broadcast: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocket, err, strerror(err));
+        }
+    }
+
+    int tos = (options.u8Dscp & 0x3F) << 2;
+    if (setsockopt(nSocket, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) < 0)
+    {
+        err = errno;
+        ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option tos 0x%02X: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocket, tos, err, strerror(err));
+    }
+
+    if (options.nSendBufferSize > 0)
+    {
+        if (setsockopt(nSocket, SOL_SOCKET, SO_SNDBUF, &options.nSendBufferSize, sizeof(int)) < 0)
+        {
+            err = errno;
+            ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option send buffer %d: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocket, options.nSendBufferSize, err, strerror(err));
+        }
+    }
+
+    if (options.nRecvBufferSize > 0)
+    {
+        if (setsockopt(nSocket, SOL_SOCKET, SO_RCVBUF, &options.nRecvBufferSize, sizeof(int)) < 0)
+        {
+            err = errno;
+            ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option receive buffer %d: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocket, options.nRecvBufferSize, err, strerror(err));
+        }
+    }
+
+    if (pSocket->protocol_type == SOCK_STREAM)   /* if TCP */
+    {
+        // Set tcp keepalive option
+        int keepAlive = options.bKeepAliveOff ? 0 : 1;
+        int keepIdle = options.u16KeepAliveIdleS ? options.u16KeepAliveIdleS : CONFIG_SOCKET_DEFAULT_KEEPALIVE_IDLE;
+        int keepInterval = options.u16KeepAliveIntervalS ? options.u16KeepAliveIntervalS : CONFIG_SOCKET_DEFAULT_KEEPALIVE_INTERVAL;
+        int keepCount = options.u8KeepAliveCount ? options.u8KeepAliveCount : CONFIG_SOCKET_DEFAULT_KEEPALIVE_COUNT;
+        int noDelay = options.bNoDelay ? 1 : 0;
+        
+        if(setsockopt(nSocket, SOL_SOCKET, SO_KEEPALIVE, &keepAlive, sizeof(int)) < 0)
+        {
+            err = errno;
+            ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option keep alive: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocket, err, strerror(err));
+        }
+
+        if (keepAlive)
+        {
+            if(setsockopt(nSocket, IPPROTO_TCP, TCP_KEEPIDLE, &keepIdle, sizeof(int)) < 0)
+            {
+                err = errno;
+                ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option keep idle: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocket, err, strerror(err));
+            }
+
+            if(setsockopt(nSocket, IPPROTO_TCP, TCP_KEEPINTVL, &keepInterval, sizeof(int)) < 0)
+            {
+                err = errno;
+                ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option keep intvl: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocket, err, strerror(err));
+            }
+
+            if(setsockopt(nSocket, IPPROTO_TCP, TCP_KEEPCNT, &keepCount, sizeof(int)) < 0)
+            {
+                err = errno;
+                ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option keen cnt: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocket, err, strerror(err));
+            }
+        }
+
+        if(setsockopt(nSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(int)) < 0)
+        {
+            err = errno;
+            ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option no delay: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocket, err, strerror(err));
+        }
+
+        if (options.bLinger)
+        {
+            struct linger sLinger;
+            sLinger.l_onoff = 1;
+            sLinger.l_linger = options.u16LingerS;
+            if(setsockopt(nSocket, SOL_SOCKET, SO_LINGER, &sLinger, sizeof(sLinger)) < 0)
+            {
+                err = errno;
+                ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option linger: errno %d (%s)", pSocket->cName, nConnectionIndex, nSocket, err, strerror(err));
+            }
+        }
+    }
+}
+
+void socket_set_options(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+
+    if (pSocket->pRuntime->bPeerDemux == false)      /* UDP server peers share the server socket (options set on bind) */
+    {
+        socket_set_fd_options(pSocket, nConnectionIndex, pConnection->nSocket);
+    }
+    pConnection->bufferTune.nSendBufferSize = 0;     /* read again by the auto-tune */
+    pConnection->bufferTune.nRecvBufferSize = 0;
+}
+
+/* the task applies the options to the open sockets (connections, hot standby, alternate path) */
+void drv_socket_set_options(drv_socket_t* pSocket, const drv_socket_options_t* pOptions)
+{
+    portENTER_CRITICAL(&options_mux);
+    pSocket->options = *pOptions;
+    if (pSocket->pRuntime != NULL)
+    {
+        pSocket->pRuntime->bOptionsChanged = true;
+    }
+    portEXIT_CRITICAL(&options_mux);
+    drv_socket_wake(pSocket);
+}
+
+void drv_socket_get_options(drv_socket_t* pSocket, drv_socket_options_t* pOptions)
+{
+    portENTER_CRITICAL(&options_mux);
+    *pOptions = pSocket->options;
+    portEXIT_CRITICAL(&options_mux);
+}
+
+void socket_options_apply(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    pRuntime->bOptionsChanged = false;
+    for (int nPosition = 0; nPosition < pSocket->nSocketConnectionsCount; nPosition++)
+    {
+        int nConnectionIndex = socket_connection_slot(pSocket, nPosition);
+        if (socket_connection_get(pSocket, nConnectionIndex)->nSocket >= 0)
+        {
+            socket_set_options(pSocket, nConnectionIndex);
+        }
+    }
+    if ((pRuntime->nStandbySocket >= 0) && (pRuntime->bStandbyConnecting == false))
+    {
+        socket_set_fd_options(pSocket, -1, pRuntime->nStandbySocket);
+    }
+    if (pRuntime->nPathSocket >= 0)
+    {
+        socket_set_fd_options(pSocket, -1, pRuntime->nPathSocket);
+    }
+    if (pRuntime->bPeerDemux && (pSocket->nSocketIndexServer >= 0))
+    {
+        socket_set_fd_options(pSocket, -1, pSocket->nSocketIndexServer);
+    }
+    ESP_LOGI(TAG, "Socket %s options applied", pSocket->cName);
+}
+
+/* new buffer size for the measured rate (bytes/s) and RTT - twice the bandwidth-delay product, 0 - no change needed */
+int socket_buffer_tune_size(int nCurrent, uint64_t u64RateBps, uint32_t u32RttUs)
+{
+    uint64_t u64Size = (u64RateBps * u32RttUs * 2) / 1000000;
+
+    if (u64Size < DRV_SOCKET_BUFFER_TUNE_MIN) u64Size = DRV_SOCKET_BUFFER_TUNE_MIN;
+    if (u64Size > CONFIG_SOCKET_BUFFER_TUNE_MAX) u64Size = CONFIG_SOCKET_BUFFER_TUNE_MAX;
+
+    /* hysteresis 25% */
+    if ((nCurrent > 0) && ((int)u64Size > (nCurrent - nCurrent / 4)) && ((int)u64Size < (nCurrent + nCurrent / 4)))
+    {
+        return 0;
+    }
+    return (int)u64Size;
+}
+
+/* 
+ * buffer auto-tune period (options.bBufferAutoTune): the rate of the last period and the RTT (heartbeat or 
+ * interface link quality) give the bandwidth-delay product - a window limited rate still doubles the buffer each period
+ */
+void socket_buffer_tune(void* pArg, int nArg)
+{
+    drv_socket_t* pSocket = (drv_socket_t*)pArg;
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    drv_socket_timer_start(&pRuntime->timerWheel, &pRuntime->timerBufferTune, pdMS_TO_TICKS(DRV_SOCKET_BUFFER_TUNE_MS));
+    if ((pSocket->options.bBufferAutoTune == false) || pRuntime->bPeerDemux)     /* UDP server peers share one socket buffer */
+    {
+        return;
+    }
+
+    uint32_t u32LinkRttUs = 0;
+    drv_socket_link_quality_t* pLink = socket_link_get(pRuntime->adapter_if);
+    if (pLink != NULL)
+    {
+        portENTER_CRITICAL(&link_quality_mux);
+        u32LinkRttUs = pLink->u32RttUs;
+        portEXIT_CRITICAL(&link_quality_mux);
+    }
+
+    for (int nPosition = 0; nPosition < pSocket->nSocketConnectionsCount; nPosition++)
+    {
+        int nConnectionIndex = socket_connection_slot(pSocket, nPosition);
+        drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+        drv_socket_buffer_tune_t* pTune = &pConnection->bufferTune;
+        uint32_t u32RttUs = (pConnection->heartbeat.u32RttSmoothUs > 0) ? pConnection->heartbeat.u32RttSmoothUs : u32LinkRttUs;
+        uint64_t u64RateOutBps = ((pConnection->stats.u64BytesOut - pTune->u64BytesOutMark) * 1000) / DRV_SOCKET_BUFFER_TUNE_MS;
+        uint64_t u64RateInBps = ((pConnection->stats.u64BytesIn - pTune->u64BytesInMark) * 1000) / DRV_SOCKET_BUFFER_TUNE_MS;
+        socklen_t nOptionSize = sizeof(int);
+        int nSize;
+
+        pTune->u64BytesOutMark = pConnection->stats.u64BytesOut;
+        pTune->u64BytesInMark = pConnection->stats.u64BytesIn;
+        if ((u32RttUs == 0) || (pConnection->nSocket < 0))
+        {
+            continue;   /* no RTT measured yet */
+        }
+
+        if ((pTune->bSendFailed == false) && (u64RateOutBps > 0))
+        {
+            if (pTune->nSendBufferSize == 0)
+            {
+                getsockopt(pConnection->nSocket, SOL_SOCKET, SO_SNDBUF, &pTune->nSendBufferSize, &nOptionSize);
+            }
+            nSize = socket_buffer_tune_size(pTune->nSendBufferSize, u64RateOutBps, u32RttUs);
+            if (nSize > 0)
+            {
+                if (setsockopt(pConnection->nSocket, SOL_SOCKET, SO_SNDBUF, &nSize, sizeof(int)) < 0)
+                {
+                    pTune->bSendFailed = true;
+                    ESP_LOGW(TAG, "Socket %s[%d] %d send buffer auto-tune not available: errno %d (%s)", pSocket->cName, nConnectionIndex, pConnection->nSocket, errno, strerror(errno));
+                }
+                else
+                {
+                    ESP_LOGD(TAG, "Socket %s[%d] %d send buffer %d -> %d bytes (%llu B/s, RTT %" PRIu32 " us)", pSocket->cName, nConnectionIndex, pConnection->nSocket, pTune->nSendBufferSize, nSize, u64RateOutBps, u32RttUs);
+                    pTune->nSendBufferSize = nSize;
+                }
+            }
+        }
+
+        if ((pTune->bRecvFailed == false) && (u64RateInBps > 0))
+        {
+            nOptionSize = sizeof(int);
+            if (pTune->nRecvBufferSize == 0)
+            {
+                getsockopt(pConnection->nSocket, SOL_SOCKET, SO_RCVBUF, &pTune->nRecvBufferSize, &nOptionSize);
+            }
+            nSize = socket_buffer_tune_size(pTune->nRecvBufferSize, u64RateInBps, u32RttUs);
+            if (nSize > 0)
+            {
+                if (setsockopt(pConnection->nSocket, SOL_SOCKET, SO_RCVBUF, &nSize, sizeof(int)) < 0)
+                {
+                    pTune->bRecvFailed = true;
+                    ESP_LOGW(TAG, "Socket %s[%d] %d receive buffer auto-tune not available: errno %d (%s)", pSocket->cName, nConnectionIndex, pConnection->nSocket, errno, strerror(errno));
+                }
+                else
+                {
+                    ESP_LOGD(TAG, "Socket %s[%d] %d receive buffer %d -> %d bytes (%llu B/s, RTT %" PRIu32 " us)", pSocket->cName, nConnectionIndex, pConnection->nSocket, pTune->nRecvBufferSize, nSize, u64RateInBps, u32RttUs);
+                    pTune->nRecvBufferSize = nSize;
+                }
+            }
+        }
+    }
+}
+
+void socket_on_connect(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    if (pSocket->bResetSendStreamOnConnect)
+    {
+        drv_stream_init(pConnection->pSendStream, NULL, 0);
+    }
+    #if CONFIG_SOCKET_EVENT_WAKEUP
+    drv_stream_set_on_push(pConnection->pSendStream, socket_on_send_stream_push, pSocket);
+    #endif
+
+    drv_stream_init(pConnection->pRecvStream, NULL, 0);
+    pConnection->u8Weight = 1;
+    pConnection->s32Deficit = 0;
+    memset(&pConnection->rate, 0, sizeof(drv_socket_rate_t));
+    drv_socket_rate_init(&pConnection->rate, pSocket->u32ConnectionRateLimitBps, pSocket->u32ConnectionRateBurstBytes, esp_timer_get_time());
+    memset(&pConnection->bufferTune, 0, sizeof(drv_socket_buffer_tune_t));
+
+    if (pSocket->onConnect != NULL)
+    {
+        pSocket->onConnect(nConnectionIndex);
+    }
+    
+
+    pConnection->bIndentifyNeeded = SOCKET_IDENTIFY_FORCED(pSocket);
+    if (pConnection->bIndentifyNeeded)
+    {
+        pConnection->bSendEnable = false;
+    }
+    else
+    {
+        pConnection->bSendEnable = pSocket->bAutoSendEnable;
+    }
+    
+    pConnection->nPingCount = 0;
+    pConnection->u8IdentifyMatchState = 0;
+    pConnection->u8LineEndingPrev = 0;
+    drv_socket_timer_init(&pConnection->timerPing, socket_timer_ping, pSocket, nConnectionIndex);
+    drv_socket_timer_init(&pConnection->timerIdentify, socket_timer_identify, pSocket, nConnectionIndex);
+    drv_socket_timer_init(&pConnection->timerCoalesce, NULL, pSocket, nConnectionIndex);
+    pConnection->s64UnsentUs = 0;
+    pConnection->bFlushRequest = false;
+    pConnection->bSendNotReady = false;
+    socket_connection_timers_start(pSocket, nConnectionIndex);
+    socket_heartbeat_init(pSocket, nConnectionIndex);
+}
+
+void socket_add_to_list(drv_socket_t* pSocket)
+{
+    nSocketCountTotal++;
+    if (nSocketListCount < DRV_SOCKET_COUNT_MAX)
+    {
+        pSocketList[nSocketListCount++] = pSocket;
+    }
+    
+}
+
+void socket_del_from_list(drv_socket_t* pSocket)
+{
+    nSocketCountTotal--;
+    for (int index = 0; index < nSocketListCount; index++)
+    {
+        if (pSocketList[index] == pSocket)
+        {
+            pSocketList[index] = NULL;
+            for (int pos = index+1; pos < nSocketListCount; pos++)
+            {
+                
+                pSocketList[pos-1] = pSocketList[pos];
+                pSocketList[pos] = NULL;
+            }
+            nSocketListCount--;
+        }
+    }
+}
+
+void socket_runtime_init(drv_socket_t* pSocket)
+{
+    /* Runtime Initialization */
+    strcpy(pSocket->pRuntime->cAdapterInterfaceIP,"0.0.0.0");
+    pSocket->pRuntime->pLastUsedHostIP = pSocket->cHostIP;
+    pSocket->pRuntime->bBroadcastRxTx = false;
+    pSocket->pRuntime->bPeerDemux = pSocket->bServerType && (pSocket->protocol_type == DRV_SOCKET_SOCK_DGRAM);
+    socket_io_select(pSocket);
+    drv_socket_rate_init(&pSocket->pRuntime->rate, pSocket->u32RateLimitBps, pSocket->u32RateBurstBytes, esp_timer_get_time());
+    bzero((void*)&pSocket->pRuntime->host_addr_main, sizeof(pSocket->pRuntime->host_addr_main));
+    bzero((void*)&pSocket->pRuntime->host_addr_recv, sizeof(pSocket->pRuntime->host_addr_recv));
+    bzero((void*)&pSocket->pRuntime->host_addr_send, sizeof(pSocket->pRuntime->host_addr_send));
+    bzero((void*)&pSocket->pRuntime->adapterif_addr, sizeof(pSocket->pRuntime->adapterif_addr));
+    pSocket->pRuntime->nWakeEventFd = -1;
+    pSocket->pRuntime->nWakeUsers = 0;
+    pSocket->pRuntime->nStandbySocket = -1;
+    pSocket->pRuntime->nMigrateSocket = -1;
+    pSocket->pRuntime->nPathSocket = -1;
+    pSocket->pRuntime->u16PathFlowTx = (uint16_t)esp_random();
+    pSocket->pRuntime->nPeerReplaceTicks = xTaskGetTickCount() - pdMS_TO_TICKS(DRV_SOCKET_PEER_REPLACE_MS);
+    drv_socket_timer_wheel_init(&pSocket->pRuntime->timerWheel, xTaskGetTickCount());
+    drv_socket_timer_init(&pSocket->pRuntime->timerReconnect, NULL, pSocket, 0);
+    drv_socket_timer_init(&pSocket->pRuntime->timerAcceptLog, NULL, pSocket, 0);
+    drv_socket_timer_start(&pSocket->pRuntime->timerWheel, &pSocket->pRuntime->timerAcceptLog, pdMS_TO_TICKS(DRV_SOCKET_ACCEPT_LOG_TIME_MS));
+    drv_socket_timer_init(&pSocket->pRuntime->timerBufferTune, socket_buffer_tune, pSocket, 0);
+    drv_socket_timer_start(&pSocket->pRuntime->timerWheel, &pSocket->pRuntime->timerBufferTune, pdMS_TO_TICKS(DRV_SOCKET_BUFFER_TUNE_MS));
+    if (pSocket->pRuntime->bPeerDemux)
+    {
+        drv_socket_timer_init(&pSocket->pRuntime->timerPeerIdle, socket_peer_idle, pSocket, 0);
+        drv_socket_timer_start(&pSocket->pRuntime->timerWheel, &pSocket->pRuntime->timerPeerIdle, pdMS_TO_TICKS(DRV_SOCKET_PEER_IDLE_CHECK_MS));
+    }
+    pSocket->pRuntime->bOptionsChanged = false;
+    socket_connection_table_init(pSocket);
+
+    #if CONFIG_USE_ETHERNET
+    pSocket->pRuntime->adapter_if = ESP_IF_ETH + drv_eth_get_netif_count(); //set as not selected if
+    #else
+    pSocket->pRuntime->adapter_if = ESP_IF_ETH; //set as not selected if
+    #endif
+}
+
+void socket_force_disconnect(drv_socket_t* pSocket)
+{
+    /* drv_socket_t Initialization */
+    if (pSocket->nSocketIndexServer >= 0)
+    {
+        shutdown(pSocket->nSocketIndexServer, SHUT_RDWR);
+        close(pSocket->nSocketIndexServer);
+        pSocket->nSocketIndexServer = -1;
+    }
+    for (int nIndex = 0; nIndex < pSocket->pRuntime->nSlotCount; nIndex++)
+    {
+        drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nIndex);
+        if (pConnection == NULL) continue;
+        if ((pConnection->nSocket >= 0) && (pSocket->pRuntime->bPeerDemux == false))   /* UDP server peers: server socket closed above */
+        {
+            shutdown(pConnection->nSocket, SHUT_RDWR);
+            //shutdown(pSocket->nSocketIndexClient, 0);
+            close(pConnection->nSocket);
+            pConnection->nSocket = -1;
+        }
+        socket_connection_timers_stop(pSocket, pConnection);
+        socket_connection_pool_free(pConnection);
+    }
+    socket_connection_table_init(pSocket);
+    socket_standby_close(pSocket);
+    socket_dual_path_close(pSocket);
+    socket_migrate_close(pSocket);
+}
+
+bool socket_query_interface_connected(esp_interface_t interface)
+{
+    if(interface == ESP_IF_WIFI_STA)
+    {
+        #if CONFIG_USE_WIFI
+        return drv_wifi_get_sta_connected();
+        #else
+        return false;
+        #endif
+    }
+    else if(interface == ESP_IF_WIFI_AP)
+    {
+        #if CONFIG_USE_WIFI
+        return drv_wifi_get_ap_connected();
+        #else
+        return false;
+        #endif
+    }
+    else //if(interface >= ESP_IF_ETH)
+    {
+        #if CONFIG_USE_ETHERNET
+        int eth_index = interface - ESP_IF_ETH;
+        return drv_eth_get_connected(eth_index);
+        #else
+        return false;
+        #endif
+    }
+}
+
+int socket_interface_count(void)
+{
+    #if CONFIG_USE_ETHERNET
+    int nCount = ESP_IF_ETH + drv_eth_get_netif_count();
+    #else
+    int nCount = ESP_IF_ETH;
+    #endif
+    return (nCount > 32) ? 32 : nCount;
+}
+
+uint32_t socket_interface_eth_mask(void)
+{
+    uint32_t u32Mask = 0;
+    for (int nInterface = ESP_IF_ETH; nInterface < socket_interface_count(); nInterface++)
+    {
+        u32Mask |= (1u << nInterface);
+    }
+    return u32Mask;
+}
+
+/* 
+ * Event handler context - only marks the interfaces to re-query and wakes the socket tasks.
+ * The owner drivers (drv_wifi/drv_eth) update their state in their own handlers for the same event.
+ */
+static void socket_interface_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    uint32_t u32Mask = 0;
+
+    if (event_base == IP_EVENT)
+    {
+        if ((event_id == IP_EVENT_STA_GOT_IP) || (event_id == IP_EVENT_STA_LOST_IP))
+        {
+            u32Mask = (1u << ESP_IF_WIFI_STA);
+        }
+        else if (event_id == IP_EVENT_AP_STAIPASSIGNED)
+        {
+            u32Mask = (1u << ESP_IF_WIFI_AP);
+        }
+        else if ((event_id == IP_EVENT_ETH_GOT_IP) || (event_id == IP_EVENT_ETH_LOST_IP))
+        {
+            u32Mask = socket_interface_eth_mask();
+        }
+    }
+    #if CONFIG_USE_WIFI
+    else if (event_base == WIFI_EVENT)
+    {
+        if ((event_id == WIFI_EVENT_AP_START) || (event_id == WIFI_EVENT_AP_STOP) || (event_id == WIFI_EVENT_AP_STACONNECTED) || (event_id == WIFI_EVENT_AP_STADISCONNECTED))
+        {
+            u32Mask = (1u << ESP_IF_WIFI_AP);
+        }
+        else if ((event_id == WIFI_EVENT_STA_CONNECTED) || (event_id == WIFI_EVENT_STA_DISCONNECTED))
+        {
+            u32Mask = (1u << ESP_IF_WIFI_STA);
+        }
+    }
+    #endif
+    #if CONFIG_USE_ETHERNET
+    else if (event_base == ETH_EVENT)
+    {
+        if ((event_id == ETHERNET_EVENT_CONNECTED) || (event_id == ETHERNET_EVENT_DISCONNECTED) || (event_id == ETHERNET_EVENT_STOP))
+        {
+            u32Mask = socket_interface_eth_mask();
+        }
+    }
+    #endif
+
+    if (u32Mask == 0)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&interface_state_mux);
+    u32InterfaceDirtyMask |= u32Mask;
+    s64InterfaceEventUs = esp_timer_get_time();
+    portEXIT_CRITICAL(&interface_state_mux);
+
+    /* drv_socket_wake checks the runtime under wake_mux - safe against a socket task freeing its runtime */
+    for (int index = 0; index < nSocketListCount; index++)
+    {
+        if (pSocketList[index] != NULL)
+        {
+            drv_socket_wake(pSocketList[index]);
+        }
+    }
+}
+
+void socket_interface_events_init(void)
+{
+    if (bInterfaceEventsRegistered)
+    {
+        return;
+    }
+    bInterfaceEventsRegistered = true;
+
+    esp_err_t err = esp_event_handler_register(IP_EVENT, ESP_EVENT_ANY_ID, socket_interface_event_handler, NULL);
+    #if CONFIG_USE_WIFI
+    if (err == ESP_OK) err = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, socket_interface_event_handler, NULL);
+    #endif
+    #if CONFIG_USE_ETHERNET
+    if (err == ESP_OK) err = esp_event_handler_register(ETH_EVENT, ESP_EVENT_ANY_ID, socket_interface_event_handler, NULL);
+    #endif
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Interface events register failed (%s) - state polled every %d ms", esp_err_to_name(err), DRV_SOCKET_INTERFACE_REFRESH_MS);
+    }
+    bInterfaceEventsActive = (err == ESP_OK);
+}
+
+/* re-query the interfaces marked by events (all of them periodically - watchdog when the events are registered) */
+void socket_interface_state_update(void)
+{
+    uint32_t u32Dirty;
+    uint32_t u32Up = 0;
+    TickType_t nTicksNow = xTaskGetTickCount();
+    uint32_t u32RefreshMs = bInterfaceEventsActive ? DRV_SOCKET_INTERFACE_WATCHDOG_MS : DRV_SOCKET_INTERFACE_REFRESH_MS;
+
+    portENTER_CRITICAL(&interface_state_mux);
+    if ((nTicksNow - nInterfaceRefreshTicks) >= pdMS_TO_TICKS(u32RefreshMs))
+    {
+        nInterfaceRefreshTicks = nTicksNow;
+        u32InterfaceDirtyMask = 0xFFFFFFFF;
+    }
+    u32Dirty = u32InterfaceDirtyMask;
+    u32InterfaceDirtyMask = 0;
+    portEXIT_CRITICAL(&interface_state_mux);
+
+    if (u32Dirty == 0)
+    {
+        return;
+    }
+
+    int nCount = socket_interface_count();
+    for (int nInterface = 0; nInterface < nCount; nInterface++)
+    {
+        if ((u32Dirty & (1u << nInterface)) && socket_query_interface_connected(nInterface))
+        {
+            u32Up |= (1u << nInterface);
+        }
+    }
+
+    portENTER_CRITICAL(&interface_state_mux);
+    uint32_t u32UpMask = (u32InterfaceUpMask & ~u32Dirty) | u32Up;
+    if (u32UpMask != u32InterfaceUpMask)
+    {
+        u32InterfaceUpMask = u32UpMask;
+        u32InterfaceStateGeneration++;
+    }
+    portEXIT_CRITICAL(&interface_state_mux);
+}
+
+/* 
+ * true - the interface selection and the connect deny are re-evaluated: interface state change (events), 
+ * interface list change, deny flags change (runtime start included)
+ */
+bool socket_interface_dirty(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    uint8_t u8Deny = (pSocket->bConnectDenyETH ? 1 : 0) | (pSocket->bConnectDenySTA ? 2 : 0) | (pSocket->bConnectDenyAP ? 4 : 0);
+    uint32_t u32Generation;
+
+    socket_interface_state_update();
+    portENTER_CRITICAL(&interface_state_mux);
+    u32Generation = u32InterfaceStateGeneration;
+    portEXIT_CRITICAL(&interface_state_mux);
+
+    if ((u32Generation != pRuntime->u32InterfaceGeneration) || (u8Deny != pRuntime->u8ConnectDenySeen))
+    {
+        pRuntime->u32InterfaceGeneration = u32Generation;
+        pRuntime->u8ConnectDenySeen = u8Deny;
+        pRuntime->bInterfaceDirty = true;
+    }
+    bool bDirty = pRuntime->bInterfaceDirty;
+    pRuntime->bInterfaceDirty = false;
+    return bDirty;
+}
+
+/* bConnectDeny of the active interface - per type flags and the interface list entry */
+void socket_connect_deny_update(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    if (pRuntime->adapter_if >= ESP_IF_ETH)   /* any of the eth interfaces */
+    {
+        pSocket->bConnectDeny = pSocket->bConnectDenyETH;
+    }
+    else if (pRuntime->adapter_if == ESP_IF_WIFI_STA)
+    {
+        pSocket->bConnectDeny = pSocket->bConnectDenySTA;
+    }
+    else if (pRuntime->adapter_if == ESP_IF_WIFI_AP)
+    {
+        pSocket->bConnectDeny = pSocket->bConnectDenyAP;
+    }
+    for (int index = 0; index < pRuntime->nInterfaceCount; index++)
+    {
+        if ((pRuntime->asInterface[index].adapter_if == pRuntime->adapter_if) && pRuntime->asInterface[index].bConnectDeny)
+        {
+            pSocket->bConnectDeny = true;
+        }
+    }
+    pRuntime->deny_if = pRuntime->adapter_if;
+}
+
+bool socket_check_interface_connected(esp_interface_t interface)
+{
+    if ((interface < 0) || (interface >= 32))
+    {
+        return false;
+    }
+    return (u32InterfaceUpMask & (1u << interface)) != 0;
+}
+
+/* failover time is measured from the interface event that triggered the switch */
+void socket_failover_start(drv_socket_t* pSocket)
+{
+    int64_t s64EventUs = s64InterfaceEventUs;
+    pSocket->pRuntime->s64FailoverStartUs = (s64EventUs != 0) ? s64EventUs : esp_timer_get_time();
+}
+
+void socket_failover_done(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    drv_socket_stats_t* pStats = &pRuntime->stats;
+
+    if (pRuntime->s64FailoverStartUs != 0)
+    {
+        pStats->u32FailoverTimeLastMs = (uint32_t)((esp_timer_get_time() - pRuntime->s64FailoverStartUs) / 1000);
+        if (pStats->u32FailoverTimeLastMs > pStats->u32FailoverTimeMaxMs) pStats->u32FailoverTimeMaxMs = pStats->u32FailoverTimeLastMs;
+        pRuntime->s64FailoverStartUs = 0;
+        ESP_LOGW(TAG, "Socket %s failover to IF %d done in %u ms", pSocket->cName, pRuntime->adapter_if, (unsigned)pStats->u32FailoverTimeLastMs);
+    }
+}
+
+void socket_migrate_close(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    if (pRuntime->nMigrateSocket >= 0)
+    {
+        close(pRuntime->nMigrateSocket);
+        pRuntime->nMigrateSocket = -1;
+    }
+}
+
+/* failed attempt - the old interface and connection stay in use */
+void socket_migrate_fail(drv_socket_t* pSocket)
+{
+    socket_migrate_close(pSocket);
+    pSocket->pRuntime->nMigrateRetryTicks = xTaskGetTickCount() + pdMS_TO_TICKS(DRV_SOCKET_MIGRATE_RETRY_MS);
+}
+
+/* 
+ * Make-before-break: non-blocking connect of a new TCP socket on the new interface (completed by socket_migrate_maintain),
+ * the established connection is served meanwhile.
+ */
+bool socket_migrate_start(drv_socket_t* pSocket, esp_interface_t adapter_if_new)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    struct sockaddr_in bind_addr;
+    int err;
+
+    bzero(&bind_addr, sizeof(bind_addr));
+    bind_addr.sin_family = AF_INET;
+    bind_addr.sin_port = 0;     /* system assigned - the active connection may hold the configured port */
+    bind_addr.sin_addr.s_addr = socket_get_interface_address(adapter_if_new);
+    if ((bind_addr.sin_addr.s_addr == htonl(INADDR_NONE)) || (bind_addr.sin_addr.s_addr == htonl(INADDR_ANY)))
+    {
+        socket_migrate_fail(pSocket);
+        return false;
+    }
+
+    int nSocket = socket(pSocket->address_family, pSocket->protocol_type, pSocket->protocol);
+    if (nSocket < 0)
+    {
+        err = errno;
+        ESP_LOGE(TAG, "Socket %s migrate to IF %d unable to create socket: errno %d (%s)", pSocket->cName, adapter_if_new, err, strerror(err));
+        socket_migrate_fail(pSocket);
+        return false;
+    }
+    fcntl(nSocket, F_SETFL, fcntl(nSocket, F_GETFL, 0) | O_NONBLOCK);
+    if ((bind(nSocket, (struct sockaddr *)&bind_addr, sizeof(bind_addr)) != 0)
+     || ((connect(nSocket, (struct sockaddr *)&pRuntime->host_addr_main, sizeof(pRuntime->host_addr_main)) != 0) && (errno != EINPROGRESS)))
+    {
+        err = errno;
+        ESP_LOGE(TAG, "Socket %s migrate to IF %d unable to connect: errno %d (%s)", pSocket->cName, adapter_if_new, err, strerror(err));
+        close(nSocket);
+        socket_migrate_fail(pSocket);
+        return false;
+    }
+    pRuntime->nMigrateSocket = nSocket;
+    pRuntime->migrate_if = adapter_if_new;
+    pRuntime->nMigrateTicks = xTaskGetTickCount() + pdMS_TO_TICKS(DRV_SOCKET_MIGRATE_CONNECT_MS);
+    ESP_LOGI(TAG, "Socket %s migrate %d connecting on IF %d", pSocket->cName, nSocket, adapter_if_new);
+    return true;
+}
+
+/* 
+ * old connection of a make-before-break switch: FIN after the queued data, then the bytes already received 
+ * (read without wait, up to DRV_SOCKET_MIGRATE_DRAIN_READS reads) through the common receive path
+ */
+void socket_migrate_drain(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    int nSize = MAX_TCP_READ_SIZE + pSocket->pRuntime->au16PipelineHeadroom[DRV_SOCKET_STAGE_RECV];
+    uint8_t* au8Temp = malloc(nSize);
+
+    shutdown(pConnection->nSocket, SHUT_WR);
+    if (au8Temp == NULL)
+    {
+        ESP_LOGE(TAG, "Error during allocate %d bytes for migrate drain of socket %s", nSize, pSocket->cName);
+        return;
+    }
+    for (int nRead = 0; nRead < DRV_SOCKET_MIGRATE_DRAIN_READS; nRead++)
+    {
+        int nLength = MAX_TCP_READ_SIZE;
+        if (SOCKET_PREVENT_OVERFLOW(pSocket) && (drv_stream_get_free(pConnection->pRecvStream) < nLength))
+        {
+            nLength = drv_stream_get_free(pConnection->pRecvStream);
+        }
+        if (nLength <= 0)
+        {
+            break;
+        }
+        nLength = pSocket->pRuntime->pRecvIo(pSocket, nConnectionIndex, au8Temp, nLength, MSG_DONTWAIT);
+        pConnection->stats.u32RecvCalls++;
+        if (nLength <= 0)
+        {
+            break;
+        }
+        pConnection->stats.u64BytesIn += nLength;
+        pConnection->stats.u32PacketsIn++;
+        socket_recv_deliver(pSocket, nConnectionIndex, au8Temp, nLength, nSize);
+        if (socket_connection_active(pSocket, nConnectionIndex) == false)
+        {
+            break;
+        }
+    }
+    free(au8Temp);
+}
+
+/* 
+ * Pending make-before-break connect: when established swap it into the connection object (send/recv streams and 
+ * their pending data are kept) and close the old socket gracefully.
+ */
+void socket_migrate_maintain(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    if (pRuntime->nMigrateSocket < 0)
+    {
+        return;
+    }
+    if ((pSocket->bConnected == false) || (pSocket->nSocketConnectionsCount != 1))
+    {
+        socket_migrate_close(pSocket);
+        return;
+    }
+
+    fd_set wfds;
+    struct timeval timeout = {0};
+    FD_ZERO(&wfds);
+    FD_SET(pRuntime->nMigrateSocket, &wfds);
+    if (select(pRuntime->nMigrateSocket + 1, NULL, &wfds, NULL, &timeout) <= 0)
+    {
+        if ((int32_t)(xTaskGetTickCount() - pRuntime->nMigrateTicks) >= 0)
+        {
+            ESP_LOGE(TAG, "Socket %s migrate to IF %d connect timeout", pSocket->cName, pRuntime->migrate_if);
+            socket_migrate_fail(pSocket);
+        }
+        return;
+    }
+
+    int nError = 0;
+    socklen_t nErrorSize = sizeof(nError);
+    getsockopt(pRuntime->nMigrateSocket, SOL_SOCKET, SO_ERROR, &nError, &nErrorSize);
+    if (nError != 0)
+    {
+        ESP_LOGE(TAG, "Socket %s migrate to IF %d connect failed: errno %d (%s)", pSocket->cName, pRuntime->migrate_if, nError, strerror(nError));
+        socket_migrate_fail(pSocket);
+        return;
+    }
+
+    esp_interface_t adapter_if_old = pRuntime->adapter_if;
+    int nConnectionIndex = socket_connection_slot(pSocket, 0);
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    int nSocketOld = pConnection->nSocket;
+    int nSocketNew = pRuntime->nMigrateSocket;
+
+    /* data already received on the old connection is delivered before the new one is read */
+    socket_migrate_drain(pSocket, nConnectionIndex);
+    if (socket_connection_active(pSocket, nConnectionIndex) == false)
+    {
+        socket_migrate_close(pSocket);
+        return;
+    }
+
+    pRuntime->nMigrateSocket = -1;
+    fcntl(nSocketNew, F_SETFL, fcntl(nSocketNew, F_GETFL, 0) & ~O_NONBLOCK);
+    pRuntime->adapter_if = pRuntime->migrate_if;
+    socket_get_adapter_interface_ip(pSocket);       /* same host - no resolve (may block) on the switch */
+    pRuntime->bIdentifyValid = false;
+    socket_prepare_adapter_interface_ip_info(pSocket);
+    pRuntime->stats.u32InterfaceSwitches++;
+
+    pConnection->nSocket = nSocketNew;
+    socket_set_options(pSocket, nConnectionIndex);
+    /* graceful close - data already queued on the old connection is still flushed (FIN sent by the drain) */
+    close(nSocketOld);
+
+    if (pSocket->onConnect != NULL)
+    {
+        pSocket->onConnect(nConnectionIndex);
+    }
+    pConnection->bIndentifyNeeded = SOCKET_IDENTIFY_FORCED(pSocket);
+    if (pConnection->bIndentifyNeeded)
+    {
+        pConnection->bSendEnable = false;
+    }
+    pConnection->u8IdentifyMatchState = 0;
+    pConnection->heartbeat.u8RecordRxCount = 0;     /* new stream - starts with a record */
+    pConnection->heartbeat.u16RecordDataLeft = 0;
+    socket_connection_timers_start(pSocket, nConnectionIndex);
+
+    pRuntime->stats.u32Migrations++;
+    ESP_LOGW(TAG, "Socket %s[%d] migrated IF %d -> %d socket %d -> %d", pSocket->cName, nConnectionIndex, adapter_if_old, pRuntime->adapter_if, nSocketOld, nSocketNew);
+    socket_reconnect_success(pSocket);
+    socket_failover_done(pSocket);
+}
+
+/* switch to another interface while the current one is still up (priority change) */
+void socket_switch_adapter_if(drv_socket_t* pSocket, esp_interface_t adapter_if_new)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    if (pSocket->bMakeBeforeBreak 
+     && (pSocket->bServerType == false) 
+     && (pSocket->protocol_type == DRV_SOCKET_SOCK_STREAM) 
+     && pSocket->bConnected 
+     && (pSocket->nSocketConnectionsCount == 1)
+     && (SOCKET_BROADCAST(pRuntime) == false))
+    {
+        TickType_t nTicksLeft = pRuntime->nMigrateRetryTicks - xTaskGetTickCount();
+        if ((pRuntime->nMigrateSocket >= 0) && (pRuntime->migrate_if == adapter_if_new))
+        {
+            return;     /* connect in progress */
+        }
+        socket_migrate_close(pSocket);
+        if ((nTicksLeft > 0) && (nTicksLeft <= pdMS_TO_TICKS(DRV_SOCKET_MIGRATE_RETRY_MS)))
+        {
+            return;     /* last attempt failed - wait before retry */
+        }
+        socket_failover_start(pSocket);
+        socket_migrate_start(pSocket, adapter_if_new);
+    }
+    else
+    {
+        socket_failover_start(pSocket);
+        pRuntime->adapter_if = adapter_if_new;
+        pSocket->bDisconnectRequest = true;
+    }
+}
+
+/* effective interface list - the default/backup pair (in bPriorityBackupAdapterInterface order) if no list is configured */
+int socket_get_interface_list(drv_socket_t* pSocket, drv_socket_interface_policy_t** ppInterface, drv_socket_interface_policy_t asPair[2])
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    if (pRuntime->nInterfaceCount > 0)
+    {
+        *ppInterface = pRuntime->asInterface;
+        return pRuntime->nInterfaceCount;
+    }
+
+    int nFirst = (pSocket->bPriorityBackupAdapterInterface == DRV_SOCKET_PRIORITY_INTERFACE_BACKUP) ? DRV_SOCKET_ADAPTER_INTERFACE_BACKUP : DRV_SOCKET_ADAPTER_INTERFACE_DEFAULT;
+    memset(asPair, 0, 2 * sizeof(drv_socket_interface_policy_t));
+    asPair[0].adapter_if = pSocket->adapter_interface[nFirst];
+    asPair[1].adapter_if = pSocket->adapter_interface[1 - nFirst];
+    *ppInterface = asPair;
+    return 2;
+}
+
+bool socket_interface_usable(drv_socket_interface_policy_t* pInterface)
+{
+    return (pInterface->bConnectDeny == false) && socket_check_interface_connected(pInterface->adapter_if);
+}
+
+void drv_socket_set_interface_list(drv_socket_t* pSocket, const drv_socket_interface_policy_t* pInterface, int nCount, drv_socket_interface_select_t eSelect)
+{
+    if (nCount > DRV_SOCKET_INTERFACE_COUNT_MAX)
+    {
+        ESP_LOGE(TAG, "Socket %s interface list %d limited to %d", pSocket->cName, nCount, DRV_SOCKET_INTERFACE_COUNT_MAX);
+        nCount = DRV_SOCKET_INTERFACE_COUNT_MAX;
+    }
+    portENTER_CRITICAL(&options_mux);
+    memcpy(pSocket->asInterface, pInterface, nCount * sizeof(drv_socket_interface_policy_t));
+    pSocket->eInterfaceSelect = eSelect;
+    pSocket->nInterfaceCount = nCount;
+    if (pSocket->pRuntime != NULL)
+    {
+        pSocket->pRuntime->bInterfaceListChanged = true;
+    }
+    portEXIT_CRITICAL(&options_mux);
+    drv_socket_wake(pSocket);
+}
+
+/* the task uses its own copy of the interface list - taken on start and after drv_socket_set_interface_list */
+void socket_interface_list_apply(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    portENTER_CRITICAL(&options_mux);
+    pRuntime->bInterfaceListChanged = false;
+    pRuntime->bInterfaceDirty = true;
+    pRuntime->nInterfaceCount = (pSocket->nInterfaceCount < DRV_SOCKET_INTERFACE_COUNT_MAX) ? pSocket->nInterfaceCount : DRV_SOCKET_INTERFACE_COUNT_MAX;
+    memcpy(pRuntime->asInterface, pSocket->asInterface, pRuntime->nInterfaceCount * sizeof(drv_socket_interface_policy_t));
+    pRuntime->eInterfaceSelect = pSocket->eInterfaceSelect;
+    portEXIT_CRITICAL(&options_mux);
+}
+
+/* lower is better: RTT (ms) + loss + weak Wi-Fi signal (RTT and loss not used when stale) */
+uint32_t socket_link_score(drv_socket_link_quality_t* pLink)
+{
+    uint32_t u32Score = 0;
+
+    if ((pLink->u32Samples > 0) && ((xTaskGetTickCount() - pLink->nUpdateTicks) < pdMS_TO_TICKS(DRV_SOCKET_LINK_STALE_MS)))
+    {
+        u32Score += pLink->u32RttUs / 1000;
+        u32Score += (uint32_t)pLink->u16LossPermille * DRV_SOCKET_LINK_LOSS_WEIGHT / 10;
+    }
+    if ((pLink->s8Rssi != 0) && (pLink->s8Rssi < DRV_SOCKET_LINK_RSSI_GOOD))
+    {
+        u32Score += (uint32_t)(DRV_SOCKET_LINK_RSSI_GOOD - pLink->s8Rssi) * DRV_SOCKET_LINK_RSSI_WEIGHT;
+    }
+    return u32Score;
+}
+
+drv_socket_link_quality_t* socket_link_get(esp_interface_t adapter_if)
+{
+    return (adapter_if < DRV_SOCKET_INTERFACE_COUNT_MAX) ? &asLinkQuality[adapter_if] : NULL;
+}
+
+void socket_link_sample(esp_interface_t adapter_if, bool bLost, uint32_t u32RttUs)
+{
+    drv_socket_link_quality_t* pLink = socket_link_get(adapter_if);
+
+    if (pLink == NULL)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&link_quality_mux);
+    if (bLost == false)
+    {
+        if (pLink->u32Samples == 0)
+        {
+            pLink->u32RttUs = u32RttUs;
+        }
+        else
+        {
+            pLink->u32RttUs = (uint32_t)((int32_t)pLink->u32RttUs + ((int32_t)u32RttUs - (int32_t)pLink->u32RttUs) / 8);
+        }
+    }
+    pLink->u16LossPermille = (uint16_t)((int32_t)pLink->u16LossPermille + ((bLost ? 1000 : 0) - (int32_t)pLink->u16LossPermille) / 8);
+    pLink->u32Samples++;
+    pLink->nUpdateTicks = xTaskGetTickCount();
+    pLink->u32Score = socket_link_score(pLink);
+    portEXIT_CRITICAL(&link_quality_mux);
+}
+
+/* application ping/keepalive answer on the interface */
+void drv_socket_link_report_rtt(esp_interface_t adapter_if, uint32_t u32RttUs)
+{
+    socket_link_sample(adapter_if, false, u32RttUs);
+}
+
+/* application ping/keepalive not answered (or connection error) on the interface */
+void drv_socket_link_report_loss(esp_interface_t adapter_if)
+{
+    socket_link_sample(adapter_if, true, 0);
+}
+
+/* Wi-Fi station signal - one read per period for all socket tasks (the first due task reads it) */
+void socket_link_rssi_update(void)
+{
+    #if CONFIG_USE_WIFI
+    TickType_t nTicksNow = xTaskGetTickCount();
+    wifi_ap_record_t ap_info;
+    int8_t s8Rssi = 0;
+    bool bDue;
+
+    portENTER_CRITICAL(&link_quality_mux);
+    bDue = ((nTicksNow - nLinkRssiTicks) >= pdMS_TO_TICKS(DRV_SOCKET_LINK_RSSI_PERIOD_MS));
+    if (bDue)
+    {
+        nLinkRssiTicks = nTicksNow;
+    }
+    portEXIT_CRITICAL(&link_quality_mux);
+    if (bDue == false)
+    {
+        return;
+    }
+    if (socket_check_interface_connected(ESP_IF_WIFI_STA) && (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK))
+    {
+        s8Rssi = ap_info.rssi;
+    }
+    portENTER_CRITICAL(&link_quality_mux);
+    asLinkQuality[ESP_IF_WIFI_STA].s8Rssi = s8Rssi;
+    asLinkQuality[ESP_IF_WIFI_STA].u32Score = socket_link_score(&asLinkQuality[ESP_IF_WIFI_STA]);
+    portEXIT_CRITICAL(&link_quality_mux);
+    #endif
+}
+
+uint32_t socket_link_get_score(esp_interface_t adapter_if)
+{
+    drv_socket_link_quality_t* pLink = socket_link_get(adapter_if);
+    uint32_t u32Score = 0;
+
+    if (pLink != NULL)
+    {
+        portENTER_CRITICAL(&link_quality_mux);
+        u32Score = socket_link_score(pLink);
+        portEXIT_CRITICAL(&link_quality_mux);
+    }
+    return u32Score;
+}
+
+void socket_link_decision_add(drv_socket_t* pSocket, drv_socket_link_decision_type_t eType, esp_interface_t from_if, esp_interface_t to_if, uint32_t u32ScoreFrom, uint32_t u32ScoreTo)
+{
+    portENTER_CRITICAL(&link_quality_mux);
+    drv_socket_link_decision_t* pLast = &asLinkDecision[(u32LinkDecisionCount - 1) & (DRV_SOCKET_LINK_HISTORY_COUNT - 1)];
+    if ((eType == DRV_SOCKET_LINK_DECISION_SUPPRESS) && (u32LinkDecisionCount > 0) 
+     && (pLast->eType == eType) && (pLast->pName == pSocket->cName) && (pLast->from_if == from_if) && (pLast->to_if == to_if))
+    {
+        /* same suppression as the last record - keep one entry */
+        pLast->u32TimeMs = (uint32_t)(esp_timer_get_time() / 1000);
+        pLast->u32ScoreFrom = u32ScoreFrom;
+        pLast->u32ScoreTo = u32ScoreTo;
+    }
+    else
+    {
+        drv_socket_link_decision_t* pDecision = &asLinkDecision[u32LinkDecisionCount & (DRV_SOCKET_LINK_HISTORY_COUNT - 1)];
+        u32LinkDecisionCount++;
+        pDecision->u32TimeMs = (uint32_t)(esp_timer_get_time() / 1000);
+        pDecision->pName = pSocket->cName;
+        pDecision->eType = eType;
+        pDecision->from_if = from_if;
+        pDecision->to_if = to_if;
+        pDecision->u32ScoreFrom = u32ScoreFrom;
+        pDecision->u32ScoreTo = u32ScoreTo;
+    }
+    portEXIT_CRITICAL(&link_quality_mux);
+}
+
+/* 
+ * Link quality gate over the policy selection (nSelect, current usable):
+ *  - policy keeps the current - leave it only if degraded and another usable one scores better by the margin
+ *  - policy switches - keep the current if the target scores worse than the current by the margin
+ * After a quality switch both are held down for CONFIG_SOCKET_LINK_HOLD_DOWN_S to avoid flapping - the left 
+ * interface gets no more RTT/loss reports, its score goes stale (lower) and the policy would switch straight back.
+ */
+int socket_link_select(drv_socket_t* pSocket, drv_socket_interface_policy_t* pInterface, int nCount, int nCurrent, int nSelect)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    uint32_t u32ScoreCurrent = socket_link_get_score(pInterface[nCurrent].adapter_if);
+    TickType_t nTicksNow = xTaskGetTickCount();
+    bool bHoldDown = pRuntime->bLinkSwitched && ((nTicksNow - pRuntime->nLinkSwitchTicks) < pdMS_TO_TICKS(CONFIG_SOCKET_LINK_HOLD_DOWN_S * 1000));
+
+    if (nSelect != nCurrent)
+    {
+        uint32_t u32ScoreSelect = socket_link_get_score(pInterface[nSelect].adapter_if);
+        if (bHoldDown || (u32ScoreSelect > u32ScoreCurrent + CONFIG_SOCKET_LINK_SWITCH_MARGIN))
+        {
+            socket_link_decision_add(pSocket, DRV_SOCKET_LINK_DECISION_SUPPRESS, pInterface[nCurrent].adapter_if, pInterface[nSelect].adapter_if, u32ScoreCurrent, u32ScoreSelect);
+            return nCurrent;
+        }
+        return nSelect;
+    }
+
+    if ((u32ScoreCurrent <= CONFIG_SOCKET_LINK_DEGRADED_SCORE) || bHoldDown)
+    {
+        return nCurrent;
+    }
+
+    int nBetter = -1;
+    uint32_t u32ScoreBetter = 0;
+    for (int index = 0; index < nCount; index++)
+    {
+        if ((index != nCurrent) && socket_interface_usable(&pInterface[index]))
+        {
+            uint32_t u32Score = socket_link_get_score(pInterface[index].adapter_if);
+            if ((u32Score + CONFIG_SOCKET_LINK_SWITCH_MARGIN < u32ScoreCurrent) && ((nBetter < 0) || (u32Score < u32ScoreBetter)))
+            {
+                nBetter = index;
+                u32ScoreBetter = u32Score;
+            }
+        }
+    }
+    if (nBetter < 0)
+    {
+        return nCurrent;
+    }
+    ESP_LOGW(TAG, "Socket %s link degraded IF %d score %" PRIu32 " -> IF %d score %" PRIu32, pSocket->cName, pInterface[nCurrent].adapter_if, u32ScoreCurrent, pInterface[nBetter].adapter_if, u32ScoreBetter);
+    socket_link_decision_add(pSocket, DRV_SOCKET_LINK_DECISION_SWITCH, pInterface[nCurrent].adapter_if, pInterface[nBetter].adapter_if, u32ScoreCurrent, u32ScoreBetter);
+    pRuntime->bLinkSwitched = true;
+    pRuntime->nLinkSwitchTicks = nTicksNow;
+    return nBetter;
+}
+
+void drv_socket_link_print(void)
+{
+    TickType_t nTicksNow = xTaskGetTickCount();
+    int nInterfaceCount = socket_interface_count();
+
+    if (nInterfaceCount > DRV_SOCKET_INTERFACE_COUNT_MAX) nInterfaceCount = DRV_SOCKET_INTERFACE_COUNT_MAX;
+    ESP_LOGI(TAG, "Link degraded score:%d switch margin:%d hold down:%d s", CONFIG_SOCKET_LINK_DEGRADED_SCORE, CONFIG_SOCKET_LINK_SWITCH_MARGIN, CONFIG_SOCKET_LINK_HOLD_DOWN_S);
+    for (int index = 0; index < nInterfaceCount; index++)
+    {
+        drv_socket_link_quality_t sLink;
+        portENTER_CRITICAL(&link_quality_mux);
+        sLink = asLinkQuality[index];
+        sLink.u32Score = socket_link_score(&asLinkQuality[index]);
+        portEXIT_CRITICAL(&link_quality_mux);
+        ESP_LOGI(TAG, "Link IF %d %s RTT:%" PRIu32 " us Loss:%u.%u%% RSSI:%d Samples:%" PRIu32 " Age:%u ms Score:%" PRIu32, 
+            index, socket_check_interface_connected(index) ? "up  " : "down", 
+            sLink.u32RttUs, sLink.u16LossPermille / 10, sLink.u16LossPermille % 10, sLink.s8Rssi, sLink.u32Samples, 
+            (sLink.u32Samples > 0) ? (unsigned)((nTicksNow - sLink.nUpdateTicks) * portTICK_PERIOD_MS) : 0, sLink.u32Score);
+    }
+
+    uint32_t u32Count = u32LinkDecisionCount;
+    uint32_t u32First = (u32Count > DRV_SOCKET_LINK_HISTORY_COUNT) ? (u32Count - DRV_SOCKET_LINK_HISTORY_COUNT) : 0;
+    for (uint32_t u32Index = u32First; u32Index != u32Count; u32Index++)
+    {
+        drv_socket_link_decision_t sDecision;
+        portENTER_CRITICAL(&link_quality_mux);
+        sDecision = asLinkDecision[u32Index & (DRV_SOCKET_LINK_HISTORY_COUNT - 1)];
+        portEXIT_CRITICAL(&link_quality_mux);
+        ESP_LOGI(TAG, "Link %10" PRIu32 " ms %-8s %s IF %d (score %" PRIu32 ") -> IF %d (score %" PRIu32 ")", 
+            sDecision.u32TimeMs, sDecision.pName, 
+            (sDecision.eType == DRV_SOCKET_LINK_DECISION_SWITCH) ? "switch  " : "suppress", 
+            sDecision.from_if, sDecision.u32ScoreFrom, sDecision.to_if, sDecision.u32ScoreTo);
+    }
+}
+
+void socket_select_adapter_if(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    drv_socket_interface_policy_t asPair[2];
+    drv_socket_interface_policy_t* pInterface;
+    int nCount = socket_get_interface_list(pSocket, &pInterface, asPair);
+    drv_socket_interface_select_t eSelect = (pRuntime->nInterfaceCount > 0) ? pRuntime->eInterfaceSelect : DRV_SOCKET_INTERFACE_SELECT_PRIORITY;
+    int nCurrent = -1;
+    int nSelect = -1;
+
+    if (pSocket->bLinkQualitySelect)
+    {
+        socket_link_rssi_update();
+    }
+
+    for (int index = 0; index < nCount; index++)
+    {
+        if (pInterface[index].adapter_if == pRuntime->adapter_if)
+        {
+            nCurrent = index;
+            break;
+        }
+    }
+    bool bCurrentUsable = (nCurrent >= 0) && socket_interface_usable(&pInterface[nCurrent]);
+
+    if ((eSelect == DRV_SOCKET_INTERFACE_SELECT_STICKY) && bCurrentUsable)
+    {
+        nSelect = nCurrent;
+    }
+    else
+    {
+        for (int index = 0; index < nCount; index++)
+        {
+            if (socket_interface_usable(&pInterface[index]))
+            {
+                if (nSelect < 0)
+                {
+                    nSelect = index;
+                    if (eSelect != DRV_SOCKET_INTERFACE_SELECT_COST)
+                    {
+                        break;
+                    }
+                }
+                else if (pInterface[index].u8Cost < pInterface[nSelect].u8Cost)
+                {
+                    nSelect = index;
+                }
+            }
+        }
+    }
+
+    if (pSocket->bLinkQualitySelect && bCurrentUsable && (nSelect >= 0))
+    {
+        nSelect = socket_link_select(pSocket, pInterface, nCount, nCurrent, nSelect);
+    }
+
+    if ((pRuntime->adapter_if >= socket_interface_count()) || (nCurrent < 0))  //not selected valid if
+    {
+        ESP_LOGE(TAG, "Socket %s not selected valid if", pSocket->cName);
+        pRuntime->adapter_if = pInterface[(nSelect >= 0) ? nSelect : 0].adapter_if;
+        pSocket->bDisconnectRequest = true;
+    }
+    else if ((nSelect < 0) || (nSelect == nCurrent))
+    {
+        /* keep the current (nothing usable - wait on it) */
+    }
+    else if (bCurrentUsable)
+    {
+        ESP_LOGW(TAG, "Socket %s switch to INTERFACE %d -> %d", pSocket->cName, pRuntime->adapter_if, pInterface[nSelect].adapter_if);
+        socket_switch_adapter_if(pSocket, pInterface[nSelect].adapter_if);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Socket %s switch to INTERFACE %d -> %d (%d down)", pSocket->cName, pRuntime->adapter_if, pInterface[nSelect].adapter_if, pRuntime->adapter_if);
+        pRuntime->adapter_if = pInterface[nSelect].adapter_if;
+        socket_failover_start(pSocket);
+        pSocket->bDisconnectRequest = true;     /* the connection on the down interface is lost - reconnect now */
+    }
+}
+
+/* first usable interface from the list other than the active one */
+bool socket_get_alternate_interface(drv_socket_t* pSocket, esp_interface_t* pAlternate_if)
+{
+    drv_socket_interface_policy_t asPair[2];
+    drv_socket_interface_policy_t* pInterface;
+    int nCount = socket_get_interface_list(pSocket, &pInterface, asPair);
+
+    for (int index = 0; index < nCount; index++)
+    {
+        if ((pInterface[index].adapter_if != pSocket->pRuntime->adapter_if) && socket_interface_usable(&pInterface[index]))
+        {
+            *pAlternate_if = pInterface[index].adapter_if;
+            return true;
+        }
+    }
+    return false;
+}
+
+void socket_standby_close(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+
+    if (pRuntime->nStandbySocket >= 0)
+    {
+        ESP_LOGW(TAG, "Socket %s standby %d on IF %d closed", pSocket->cName, pRuntime->nStandbySocket, pRuntime->standby_if);
+        shutdown(pRuntime->nStandbySocket, SHUT_RDWR);
+        close(pRuntime->nStandbySocket);
+        pRuntime->nStandbySocket = -1;
+    }
+    pRuntime->bStandbyConnecting = false;
+}
+
+/* non-blocking connect to the host on the standby interface (active connection is not delayed) */
+bool socket_standby_open(drv_socket_t* pSocket, esp_interface_t standby_if)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    struct sockaddr_in bind_addr;
+    int err;
+
+    bzero(&bind_addr, sizeof(bind_addr));
+    bind_addr.sin_family = AF_INET;
+    bind_addr.sin_port = 0;     /* system assigned - the active connection may hold the configured port on INADDR_ANY */
+    bind_addr.sin_addr.s_addr = socket_get_interface_address(standby_if);
+    if ((bind_addr.sin_addr.s_addr == htonl(INADDR_NONE)) || (bind_addr.sin_addr.s_addr == htonl(INADDR_ANY)))
+    {
+        return false;
+    }
+
+    int nSocket = socket(pSocket->address_family, pSocket->protocol_type, pSocket->protocol);
+    if (nSocket < 0)
+    {
+        err = errno;
+        ESP_LOGE(TAG, "Socket %s standby unable to create socket: errno %d (%s)", pSocket->cName, err, strerror(err));
+        return false;
+    }
+    fcntl(nSocket, F_SETFL, fcntl(nSocket, F_GETFL, 0) | O_NONBLOCK);
+    if ((bind(nSocket, (struct sockaddr *)&bind_addr, sizeof(bind_addr)) != 0)
+     || ((connect(nSocket, (struct sockaddr *)&pRuntime->host_addr_main, sizeof(pRuntime->host_addr_main)) != 0) && (errno != EINPROGRESS)))
+    {
+        err = errno;
+        ESP_LOGE(TAG, "Socket %s standby on IF %d unable to connect: errno %d (%s)", pSocket->cName, standby_if, err, strerror(err));
+        close(nSocket);
+        return false;
+    }
+    pRuntime->nStandbySocket = nSocket;
+    pRuntime->standby_if = standby_if;
+    pRuntime->bStandbyConnecting = true;
+    pRuntime->nStandbyTicks = xTaskGetTickCount() + pdMS_TO_TICKS(DRV_SOCKET_STANDBY_CONNECT_MS);
+    ESP_LOGI(TAG, "Socket %s standby %d connecting on IF %d", pSocket->cName, nSocket, standby_if);
+    return true;
+}
+
+/* keep the standby connection on the first usable interface other than the active one */
+void socket_standby_maintain(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    TickType_t nTicksNow = xTaskGetTickCount();
+    bool bDue = ((int32_t)(nTicksNow - pRuntime->nStandbyTicks) >= 0);
+    esp_interface_t standby_if;
+
+    if ((pSocket->bHotStandby == false) || (pSocket->protocol_type != DRV_SOCKET_SOCK_STREAM) || SOCKET_BROADCAST(pRuntime))
+    {
+        socket_standby_close(pSocket);
+        return;
     }
-    else if (interface_address == htonl(INADDR_ANY))
+
+    bool bAlternate = socket_get_alternate_interface(pSocket, &standby_if);
+    if ((bAlternate == false) || ((pRuntime->nStandbySocket >= 0) && (pRuntime->standby_if != standby_if)))
     {
-        ESP_LOGW(TAG, "Socket %s default adapter interface selected IP: %s", pSocket->cName, adapter_interface_ip);
+        socket_standby_close(pSocket);
     }
-    else
+    if (bAlternate == false)
     {
-        ESP_LOGI(TAG, "Socket %s adapter interface selected IP: %s", pSocket->cName, adapter_interface_ip);
+        return;
     }
 
-    //pSocket->pRuntime->adapter_interface_ip_address = interface_address;
+    if (pRuntime->nStandbySocket < 0)
+    {
+        if (bDue && (socket_standby_open(pSocket, standby_if) == false))
+        {
+            pRuntime->nStandbyTicks = nTicksNow + pdMS_TO_TICKS(DRV_SOCKET_STANDBY_RETRY_MS);
+        }
+    }
+    else if (pRuntime->bStandbyConnecting)
+    {
+        fd_set wfds;
+        struct timeval timeout = {0};
+        FD_ZERO(&wfds);
+        FD_SET(pRuntime->nStandbySocket, &wfds);
+        if (select(pRuntime->nStandbySocket + 1, NULL, &wfds, NULL, &timeout) > 0)
+        {
+            int nError = 0;
+            socklen_t nErrorSize = sizeof(nError);
+            getsockopt(pRuntime->nStandbySocket, SOL_SOCKET, SO_ERROR, &nError, &nErrorSize);
+            if (nError == 0)
+            {
+                fcntl(pRuntime->nStandbySocket, F_SETFL, fcntl(pRuntime->nStandbySocket, F_GETFL, 0) & ~O_NONBLOCK);
+                socket_set_fd_options(pSocket, -1, pRuntime->nStandbySocket);
+                pRuntime->bStandbyConnecting = false;
+                pRuntime->nStandbyTicks = nTicksNow + pdMS_TO_TICKS(DRV_SOCKET_STANDBY_CHECK_MS);
+                ESP_LOGI(TAG, "Socket %s standby %d ready on IF %d", pSocket->cName, pRuntime->nStandbySocket, pRuntime->standby_if);
+            }
+            else
+            {
+                ESP_LOGE(TAG, "Socket %s standby on IF %d connect failed: errno %d (%s)", pSocket->cName, pRuntime->standby_if, nError, strerror(nError));
+                socket_standby_close(pSocket);
+                pRuntime->nStandbyTicks = nTicksNow + pdMS_TO_TICKS(DRV_SOCKET_STANDBY_RETRY_MS);
+            }
+        }
+        else if (bDue)
+        {
+            ESP_LOGE(TAG, "Socket %s standby on IF %d connect timeout", pSocket->cName, pRuntime->standby_if);
+            socket_standby_close(pSocket);
+            pRuntime->nStandbyTicks = nTicksNow + pdMS_TO_TICKS(DRV_SOCKET_STANDBY_RETRY_MS);
+        }
+    }
+    else if (bDue)
+    {
+        /* idle connection (keepalive only) - detect close by the host */
+        uint8_t u8Peek;
+        int nLength = recv(pRuntime->nStandbySocket, &u8Peek, 1, MSG_PEEK | MSG_DONTWAIT);
+        if ((nLength == 0) || ((nLength < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)))
+        {
+            socket_standby_close(pSocket);
+        }
+        pRuntime->nStandbyTicks = nTicksNow + pdMS_TO_TICKS(DRV_SOCKET_STANDBY_CHECK_MS);
+    }
 }
 
-void socket_prepare_adapter_interface_ip_info(drv_socket_t* pSocket)
+/* client connection lost - continue on the established standby connection (no handshake, no DNS) */
+bool socket_standby_promote(drv_socket_t* pSocket)
 {
-    /* Configure Bind to IP Info (Adapter interface Info) */
-    #ifdef CONFIG_EXAMPLE_IPV6
-    // Note that by default IPV6 binds to both protocols, it is must be disabled
-    // if both protocols used at the same time (used in CI)
-    if (pSocket->bIPV6)setsockopt(pSocket->nSocketIndex, IPPROTO_IPV6, IPV6_V6ONLY, &opt, sizeof(opt));
-    #endif
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
 
-    #ifdef CONFIG_EXAMPLE_IPV6
-    if (pSocket->bIPV6)
+    if ((pRuntime->nStandbySocket < 0) || pRuntime->bStandbyConnecting || pSocket->bServerType || (pSocket->nSocketConnectionsCount > 0))
     {
-        struct sockaddr_in6 *dest_addr_ip6 = (struct sockaddr_in6 *)&pSocket->pRuntime->adapterif_addr;
-        bzero(&dest_addr_ip6->sin6_addr.un, sizeof(dest_addr_ip6->sin6_addr.un));
-        dest_addr_ip6->sin6_family = pSocket->address_family;
-        dest_addr_ip6->sin6_port = htons(pSocket->u16Port);
+        return false;
     }
-    else
-    #endif
+    if (socket_check_interface_connected(pRuntime->standby_if) == false)
     {
-        struct sockaddr_in *dest_addr_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->adapterif_addr;
-        //dest_addr_ip4->sin_addr.s_addr = pSocket->pRuntime->adapter_interface_ip_address;
-        dest_addr_ip4->sin_addr.s_addr = inet_addr(pSocket->pRuntime->cAdapterInterfaceIP);
-        dest_addr_ip4->sin_family = pSocket->address_family;
-        dest_addr_ip4->sin_port = htons(pSocket->u16Port);
+        socket_standby_close(pSocket);
+        return false;
     }
-}
-
 
+    int nSocket = pRuntime->nStandbySocket;
+    pRuntime->nStandbySocket = -1;
+    int nConnectionIndex = socket_connection_add_to_list(pSocket, nSocket, NULL);
+    if (nConnectionIndex < 0)
+    {
+        close(nSocket);
+        return false;
+    }
 
-void clear_dns_cache() 
-{
-    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-    if (netif == NULL) {
-        printf("Failed to get netif handle\n");
-        return;
+    pRuntime->adapter_if = pRuntime->standby_if;
+    socket_get_adapter_interface_ip(pSocket);
+    socket_prepare_adapter_interface_ip_info(pSocket);
+    pSocket->bConnected = true;
+    pSocket->bDisconnectRequest = false;
+    pRuntime->stats.u32Connects++;
+    pRuntime->stats.u32Reconnects++;
+    pRuntime->stats.u32StandbySwitches++;
+    ESP_LOGW(TAG, "Socket %s[%d] %d standby promoted on IF %d", pSocket->cName, nConnectionIndex, nSocket, pRuntime->adapter_if);
+    if (pRuntime->s64FailoverStartUs == 0)
+    {
+        /* connection error (no interface event) - switch time from the connection loss */
+        pRuntime->s64FailoverStartUs = pRuntime->s64ConnectionLostUs;
     }
-    esp_netif_dns_info_t dns_info = {0};
-    dns_info.ip.u_addr.ip4.addr = 0;
-    esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns_info);
-    esp_netif_set_dns_info(netif, ESP_NETIF_DNS_BACKUP, &dns_info);
+    socket_reconnect_success(pSocket);
+    socket_failover_done(pSocket);
+    return true;
 }
 
-uint32_t drv_socket_caller_id;
+/* dual-path mode applies to UDP client sockets */
+bool socket_dual_path_active(drv_socket_t* pSocket)
+{
+    return pSocket->bDualPath && (pSocket->bServerType == false) && (pSocket->protocol_type == DRV_SOCKET_SOCK_DGRAM);
+}
 
-/* try resolve cURL to IP Address. If not resolved - use cHostIP */
-char* socket_get_host_ip_address(drv_socket_t* pSocket)
+void socket_dual_path_close(drv_socket_t* pSocket)
 {
-    char* pLastUsedHostIP = NULL;
-    bool bURLResolved;
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
 
-    /* Try Resolve URL */
-    bURLResolved = false;
-    if ((pSocket->cURL != NULL) && (strlen(pSocket->cURL) > 0))
+    if (pRuntime->nPathSocket >= 0)
     {
-        ESP_LOGI(TAG, "Socket %s Start resolve URL %s", pSocket->cName, pSocket->cURL);
+        ESP_LOGW(TAG, "Socket %s path socket %d on IF %d closed", pSocket->cName, pRuntime->nPathSocket, pRuntime->path_if);
+        close(pRuntime->nPathSocket);
+        pRuntime->nPathSocket = -1;
+    }
+}
 
-        bURLResolved = drv_dns_resolve(pSocket->cURL, pSocket->cHostIPResolved, sizeof(pSocket->cHostIPResolved), &pSocket->bActiveTask);
-        if (bURLResolved)
-        {
-            ESP_LOGI(TAG, "Socket %s resolved URL %s to ip address: %s", pSocket->cName, pSocket->cURL, pSocket->cHostIPResolved);
-        }
-        else
-        {
-            ESP_LOGE(TAG, "Socket %s Fail resolve URL %s - use default IP: %s", pSocket->cName,pSocket->cURL, pSocket->cHostIP);
-        }
+/* second datagram socket bound to the alternate interface (same port, same host as the active one) */
+bool socket_dual_path_open(drv_socket_t* pSocket, esp_interface_t path_if)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    struct sockaddr_in bind_addr;
+    int err;
 
-        ESP_LOGI(TAG, "Socket %s Final resolve URL %s", pSocket->cName, pSocket->cURL); 
+    bzero(&bind_addr, sizeof(bind_addr));
+    bind_addr.sin_family = AF_INET;
+    bind_addr.sin_port = htons(pSocket->u16Port);
+    bind_addr.sin_addr.s_addr = socket_get_interface_address(path_if);
+    if ((bind_addr.sin_addr.s_addr == htonl(INADDR_NONE)) || (bind_addr.sin_addr.s_addr == htonl(INADDR_ANY)))
+    {
+        return false;
     }
 
-    if(bURLResolved)  
+    int nSocket = socket(pSocket->address_family, pSocket->protocol_type, pSocket->protocol);
+    if (nSocket < 0)
     {
-        pLastUsedHostIP = pSocket->cHostIPResolved;
-    } 
-    else
+        err = errno;
+        ESP_LOGE(TAG, "Socket %s path unable to create socket: errno %d (%s)", pSocket->cName, err, strerror(err));
+        return false;
+    }
+    int nReuse = 1;
+    setsockopt(nSocket, SOL_SOCKET, SO_REUSEADDR, &nReuse, sizeof(nReuse));    /* the active socket may hold the port on INADDR_ANY */
+    socket_set_fd_options(pSocket, -1, nSocket);
+    if ((bind(nSocket, (struct sockaddr *)&bind_addr, sizeof(bind_addr)) != 0)
+     || ((SOCKET_BROADCAST(pRuntime) == false) && (connect(nSocket, (struct sockaddr *)&pRuntime->host_addr_main, sizeof(pRuntime->host_addr_main)) != 0)))
     {
-        pLastUsedHostIP = pSocket->cHostIP;
+        err = errno;
+        ESP_LOGE(TAG, "Socket %s path on IF %d unable to bind/connect: errno %d (%s)", pSocket->cName, path_if, err, strerror(err));
+        close(nSocket);
+        return false;
     }
-
-    return pLastUsedHostIP;
+    pRuntime->nPathSocket = nSocket;
+    pRuntime->path_if = path_if;
+    ESP_LOGI(TAG, "Socket %s path socket %d on IF %d", pSocket->cName, nSocket, path_if);
+    return true;
 }
 
-void socket_prepare_host_ip_info(drv_socket_t* pSocket)
+/* keep the path socket on the first usable interface other than the active one */
+void socket_dual_path_maintain(drv_socket_t* pSocket)
 {
-    char cRecvFromIP[16] = "255.255.255.255";
-    char* pRecvFromIP = cRecvFromIP;
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    TickType_t nTicksNow = xTaskGetTickCount();
+    esp_interface_t path_if;
 
-    //char cSendToIP[16] = "192.168.3.118";
-    char cSendToIP[16] = "255.255.255.255";
-    char* pSendToIP = cSendToIP;
+    if (socket_dual_path_active(pSocket) == false)
+    {
+        socket_dual_path_close(pSocket);
+        return;
+    }
+
+    bool bAlternate = socket_get_alternate_interface(pSocket, &path_if);
+    if ((bAlternate == false) || ((pRuntime->nPathSocket >= 0) && (pRuntime->path_if != path_if)))
+    {
+        socket_dual_path_close(pSocket);
+    }
+    if (bAlternate && (pRuntime->nPathSocket < 0) && ((int32_t)(nTicksNow - pRuntime->nPathTicks) >= 0))
+    {
+        if (socket_dual_path_open(pSocket, path_if) == false)
+        {
+            pRuntime->nPathTicks = nTicksNow + pdMS_TO_TICKS(DRV_SOCKET_DUAL_PATH_RETRY_MS);
+        }
+    }
+}
 
+/* u8Path 0 takes the next sequence, u8Path 1 reuses it (copy of the same datagram) */
+void socket_dual_path_header(drv_socket_t* pSocket, uint8_t* pHeader, uint8_t u8Path)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
 
-    /* Host IP Address Preparation - host_addr_main */
-    pSocket->pRuntime->bBroadcastRxTx = false;
-    #ifdef CONFIG_EXAMPLE_IPV6
-    if (pSocket->bIPV6)
+    if (u8Path == 0)
     {
-        struct sockaddr_in6 *host_addr_ip6 = (struct sockaddr_in6 *)&pSocket->pRuntime->host_addr_main;
-        host_addr_ip6->sin6_addr.un = inet_addr(pSocket->pRuntime->pLastUsedHostIP);
-        host_addr_ip6->sin6_family = pSocket->address_family;
-        host_addr_ip6->sin6_port = htons(pSocket->u16Port);
+        pRuntime->u32PathSequenceTx++;
+    }
+    pHeader[0] = DRV_SOCKET_DUAL_PATH_MAGIC;
+    pHeader[1] = u8Path;
+    pHeader[2] = (uint8_t)(pRuntime->u16PathFlowTx >> 8);
+    pHeader[3] = (uint8_t)(pRuntime->u16PathFlowTx >> 0);
+    pHeader[4] = (uint8_t)(pRuntime->u32PathSequenceTx >> 24);
+    pHeader[5] = (uint8_t)(pRuntime->u32PathSequenceTx >> 16);
+    pHeader[6] = (uint8_t)(pRuntime->u32PathSequenceTx >> 8);
+    pHeader[7] = (uint8_t)(pRuntime->u32PathSequenceTx >> 0);
+}
 
-        struct sockaddr_in6 *host_addr_recv_ip6 = (struct sockaddr_in6 *)&pSocket->pRuntime->host_addr_recv;
-        host_addr_recv_ip6->sin6_addr.un = inet_addr(pRecvFromIP);
-        host_addr_recv_ip6->sin6_family = pSocket->address_family;
-        host_addr_recv_ip6->sin6_port = htons(pSocket->u16Port);
+/* pData is the datagram already sent on the active path (header included) */
+void socket_dual_path_send(drv_socket_t* pSocket, uint8_t* pData, int nLength, bool bActiveSent)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    drv_socket_stats_t* pStats = &pRuntime->stats;
+    int nLengthSent;
 
-        struct sockaddr_in6 *host_addr_send_ip6 = (struct sockaddr_in6 *)&pSocket->pRuntime->host_addr_send;
-        host_addr_send_ip6->sin6_addr.un = inet_addr(pSendToIP);
-        host_addr_send_ip6->sin6_family = pSocket->address_family;
-        host_addr_send_ip6->sin6_port = htons(pSocket->u16Port);
+    if (bActiveSent)
+    {
+        pStats->asPath[0].u32Sent++;
     }
     else
-    #endif
     {
-        struct sockaddr_in *host_addr_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->host_addr_main;
-        host_addr_ip4->sin_addr.s_addr = inet_addr(pSocket->pRuntime->pLastUsedHostIP);
-        host_addr_ip4->sin_family = pSocket->address_family;
-        host_addr_ip4->sin_port = htons(pSocket->u16Port);
-
-        struct sockaddr_in *host_addr_recv_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->host_addr_recv;
-        host_addr_recv_ip4->sin_addr.s_addr = inet_addr(pRecvFromIP);
-        host_addr_recv_ip4->sin_family = pSocket->address_family;
-        host_addr_recv_ip4->sin_port = htons(pSocket->u16Port);
-
-        struct sockaddr_in *host_addr_send_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->host_addr_send;
-        host_addr_send_ip4->sin_addr.s_addr = inet_addr(pSendToIP);
-        host_addr_send_ip4->sin_family = pSocket->address_family;
-        host_addr_send_ip4->sin_port = htons(pSocket->u16Port);
-
-        if (((host_addr_ip4->sin_addr.s_addr >> 0) & 0xFF) == 0xFF)pSocket->pRuntime->bBroadcastRxTx = true;
-        if (((host_addr_ip4->sin_addr.s_addr >> 8) & 0xFF) == 0xFF)pSocket->pRuntime->bBroadcastRxTx = true;
-        if (((host_addr_ip4->sin_addr.s_addr >>16) & 0xFF) == 0xFF)pSocket->pRuntime->bBroadcastRxTx = true;
-        if (((host_addr_ip4->sin_addr.s_addr >>24) & 0xFF) == 0xFF)pSocket->pRuntime->bBroadcastRxTx = true;
+        pStats->asPath[0].u32SendErrors++;
     }
 
-    ESP_LOGI(TAG, "Socket %s Bind/Connect: %s", pSocket->cName, pSocket->pRuntime->pLastUsedHostIP); 
-    ESP_LOGI(TAG, "Socket %s RecvFrom:     %s", pSocket->cName, pRecvFromIP); 
-    ESP_LOGI(TAG, "Socket %s SendTo:       %s", pSocket->cName, pSendToIP); 
+    if (pRuntime->nPathSocket < 0)
+    {
+        return;
+    }
 
+    socket_dual_path_header(pSocket, pData, 1);
+    if (SOCKET_BROADCAST(pRuntime))
+    {
+        nLengthSent = sendto(pRuntime->nPathSocket, pData, nLength, 0, (struct sockaddr *)&pRuntime->host_addr_send, sizeof(pRuntime->host_addr_send));
+    }
+    else
+    {
+        nLengthSent = send(pRuntime->nPathSocket, pData, nLength, 0);
+    }
 
+    if (nLengthSent == nLength)
+    {
+        pStats->asPath[1].u32Sent++;
+    }
+    else
+    {
+        int err = errno;
+        pStats->asPath[1].u32SendErrors++;
+        if ((nLengthSent < 0) && (err != EAGAIN) && (err != EWOULDBLOCK))
+        {
+            ESP_LOGE(TAG, "Error during send to socket %s path IF %d: errno %d (%s)", pSocket->cName, pRuntime->path_if, err, strerror(err));
+            socket_dual_path_close(pSocket);
+            pRuntime->nPathTicks = xTaskGetTickCount() + pdMS_TO_TICKS(DRV_SOCKET_DUAL_PATH_RETRY_MS);
+        }
+    }
 }
 
-void socket_strt(drv_socket_t* pSocket)
+/* returns false if the sequence was already received or is older than the window (*pbTooOld) */
+bool socket_dual_path_window(drv_socket_path_window_t* pWindow, uint32_t u32Sequence, bool* pbTooOld)
 {
-    int err;
-    int nSocketIndex = socket(pSocket->address_family, pSocket->protocol_type, pSocket->protocol);
+    int32_t nAhead = (int32_t)(u32Sequence - pWindow->u32SequenceRx);
 
-    if (nSocketIndex < 0) 
+    *pbTooOld = false;
+    if ((pWindow->bValid == false) || (nAhead <= -DRV_SOCKET_DUAL_PATH_RESYNC))
     {
-        err = errno;
-        ESP_LOGE(TAG, "Unable to create socket %s %d: errno %d (%s)", pSocket->cName, nSocketIndex, err, strerror(err));
+        /* first datagram or sender restarted */
+        pWindow->bValid = true;
+        pWindow->u32SequenceRx = u32Sequence;
+        pWindow->u64WindowRx = 1;
+    }
+    else if (nAhead > 0)
+    {
+        pWindow->u64WindowRx = (nAhead < 64) ? ((pWindow->u64WindowRx << nAhead) | 1) : 1;
+        pWindow->u32SequenceRx = u32Sequence;
     }
     else
     {
-        ESP_LOGI(TAG, "Created socket %s %d: AdapterIF: %d Address Family: %d", pSocket->cName, nSocketIndex, pSocket->pRuntime->adapter_if, pSocket->address_family);
+        uint64_t u64Bit = (-nAhead < 64) ? ((uint64_t)1 << -nAhead) : 0;
+        if (u64Bit == 0)
+        {
+            *pbTooOld = true;
+            return false;
+        }
+        if (pWindow->u64WindowRx & u64Bit)
+        {
+            return false;
+        }
+        pWindow->u64WindowRx |= u64Bit;
     }
-    if (pSocket->bServerType)
+    return true;
+}
+
+/* 
+ * Duplicate filter - returns false if the sequence was already received (or is too old). 
+ * On true the header is removed from pData. Datagrams without the header are passed unchanged.
+ */
+bool socket_dual_path_receive(drv_socket_t* pSocket, uint8_t u8Path, uint8_t* pData, int* pLength)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    drv_socket_path_stats_t* pPath = &pRuntime->stats.asPath[u8Path];
+    uint32_t u32TimeUs = (uint32_t)esp_timer_get_time();
+    bool bTooOld;
+
+    if ((*pLength < DRV_SOCKET_DUAL_PATH_HEADER_SIZE) || (pData[0] != DRV_SOCKET_DUAL_PATH_MAGIC))
     {
-        pSocket->nSocketIndexServer = nSocketIndex;
+        return true;
     }
-    else
+    pPath->u32Received++;
+
+    uint32_t u32Sequence = ((uint32_t)pData[4] << 24) | ((uint32_t)pData[5] << 16) | ((uint32_t)pData[6] << 8) | (uint32_t)pData[7];
+    drv_socket_path_arrival_t* pArrival = &pRuntime->asPathArrival[u32Sequence & (DRV_SOCKET_DUAL_PATH_ARRIVAL_COUNT - 1)];
+
+    if (socket_dual_path_window(&pRuntime->pathRx, u32Sequence, &bTooOld) == false)
     {
-        socket_connection_add_to_list(pSocket, nSocketIndex);
-        //pSocket->nSocketIndexPrimer = nSocketIndex;
+        pPath->u32Late++;
+        if ((bTooOld == false) && (pArrival->u32Sequence == u32Sequence) && (pArrival->u8Path != u8Path))
+        {
+            pPath->u32LagLastUs = u32TimeUs - pArrival->u32TimeUs;
+            pPath->u64LagSumUs += pPath->u32LagLastUs;
+            if (pPath->u32LagLastUs > pPath->u32LagMaxUs) pPath->u32LagMaxUs = pPath->u32LagLastUs;
+        }
+        return false;
     }
+
+    pArrival->u32Sequence = u32Sequence;
+    pArrival->u32TimeUs = u32TimeUs;
+    pArrival->u8Path = u8Path;
+    pPath->u32First++;
+
+    *pLength -= DRV_SOCKET_DUAL_PATH_HEADER_SIZE;
+    memmove(pData, pData + DRV_SOCKET_DUAL_PATH_HEADER_SIZE, *pLength);
+    return *pLength > 0;
 }
 
-void socket_connect_server_periodic(drv_socket_t* pSocket)
+/* duplicate filter of the sender flow (a new or the least recent one is reused for an unknown flow) */
+drv_socket_path_window_t* socket_dual_path_flow(drv_socket_runtime_t* pRuntime, uint16_t u16Flow)
 {
-    int err;
+    drv_socket_path_window_t* pReuse = &pRuntime->asPathFlowRx[0];
+
+    for (int index = 0; index < DRV_SOCKET_DUAL_PATH_FLOW_COUNT; index++)
+    {
+        drv_socket_path_window_t* pWindow = &pRuntime->asPathFlowRx[index];
+        if (pWindow->bValid == false)
+        {
+            if (pReuse->bValid)
+            {
+                pReuse = pWindow;
+            }
+            continue;
+        }
+        if (pWindow->u16Flow == u16Flow)
+        {
+            return pWindow;
+        }
+        if (pReuse->bValid && ((int32_t)(pWindow->nTicks - pReuse->nTicks) < 0))
+        {
+            pReuse = pWindow;
+        }
+    }
+    memset(pReuse, 0, sizeof(drv_socket_path_window_t));
+    pReuse->u16Flow = u16Flow;
+    return pReuse;
+}
 
+/* 
+ * UDP server (bDualPath): both copies of a dual-path sender arrive from different source addresses (peers) - 
+ * the duplicate filter is per sender flow id. Same result as socket_dual_path_receive (no path lag measured).
+ */
+bool socket_dual_path_receive_peer(drv_socket_t* pSocket, uint8_t* pData, int* pLength)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    bool bTooOld;
 
-    ESP_LOGD(TAG, "Socket %s %d periodic check incoming connections", pSocket->cName, pSocket->nSocketIndexServer);
+    if ((*pLength < DRV_SOCKET_DUAL_PATH_HEADER_SIZE) || (pData[0] != DRV_SOCKET_DUAL_PATH_MAGIC) || (pData[1] > 1))
+    {
+        return true;
+    }
+    drv_socket_path_stats_t* pPath = &pRuntime->stats.asPath[pData[1]];
+    uint16_t u16Flow = ((uint16_t)pData[2] << 8) | (uint16_t)pData[3];
+    uint32_t u32Sequence = ((uint32_t)pData[4] << 24) | ((uint32_t)pData[5] << 16) | ((uint32_t)pData[6] << 8) | (uint32_t)pData[7];
+    drv_socket_path_window_t* pWindow = socket_dual_path_flow(pRuntime, u16Flow);
+
+    pPath->u32Received++;
+    pWindow->nTicks = xTaskGetTickCount();
+    if (socket_dual_path_window(pWindow, u32Sequence, &bTooOld) == false)
+    {
+        pPath->u32Late++;
+        return false;
+    }
+    pPath->u32First++;
 
-    struct sockaddr_storage source_addr; // Large enough for both IPv4 or IPv6
-    socklen_t addr_len = sizeof(source_addr);
+    *pLength -= DRV_SOCKET_DUAL_PATH_HEADER_SIZE;
+    memmove(pData, pData + DRV_SOCKET_DUAL_PATH_HEADER_SIZE, *pLength);
+    return *pLength > 0;
+}
 
-    // Set a timeout of 0 ms
-    struct timeval timeout;
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 0;
+/* one datagram from the path socket - duplicates dropped, then delivered as a datagram of the active path */
+void socket_dual_path_recv(drv_socket_t* pSocket, int nConnectionIndex)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    int err;
 
-    // Set the socket to non-blocking mode
-    fcntl(pSocket->nSocketIndexServer, F_SETFL, O_NONBLOCK);
+    if ((pRuntime->nPathSocket < 0) || (pConnection == NULL))
+    {
+        return;
+    }
+    if (SOCKET_PREVENT_OVERFLOW(pSocket) && (drv_stream_get_free(pConnection->pRecvStream) == 0))
+    {
+        return;
+    }
 
-    // Use select() to wait for the socket to become readable or for the timeout to expire
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(pSocket->nSocketIndexServer, &rfds);
-    int ready = select(pSocket->nSocketIndexServer + 1, &rfds, NULL, NULL, &timeout);
+    int nSize = MAX_TCP_READ_SIZE + pRuntime->au16PipelineHeadroom[DRV_SOCKET_STAGE_RECV];
+    uint8_t* au8Temp = malloc(nSize);
+    if (au8Temp == NULL)
+    {
+        ESP_LOGE(TAG, "Error during allocate %d bytes for read from socket %s path", nSize, pSocket->cName);
+        return;
+    }
 
-    if (ready < 0) 
+    int nLength;
+    if (SOCKET_BROADCAST(pRuntime))
     {
-        ESP_LOGE(TAG, "Socket %s %d Error in select() function: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, errno, strerror(errno));
-        socket_disconnect(pSocket);
-        //close(pSocket->nSocketIndexServer);
-        //pSocket->nSocketIndexServer = -1;
-    } 
-    else if (ready == 0) 
+        socklen_t socklen = sizeof(pRuntime->host_addr_recv);
+        nLength = recvfrom(pRuntime->nPathSocket, au8Temp, MAX_TCP_READ_SIZE, MSG_DONTWAIT, (struct sockaddr *)&pRuntime->host_addr_recv, &socklen);
+    }
+    else
     {
-        if ((pSocket->nTaskLoopCounter % ((pdMS_TO_TICKS(30000)) / nTaskRestTimeTicks)) == 0)
-        {
-            ESP_LOGW(TAG, "Socket %s %d Timeout waiting for client to connect", pSocket->cName, pSocket->nSocketIndexServer);
-        }
-        //socket_disconnect(pSocket);
-        //close(pSocket->nSocketIndexServer);
-        //pSocket->nSocketIndexServer = -1;
-    } 
-    else 
+        nLength = recv(pRuntime->nPathSocket, au8Temp, MAX_TCP_READ_SIZE, MSG_DONTWAIT);
+    }
+
+    pConnection->stats.u32RecvCalls++;
+    if (nLength > 0)
     {
-        int nNewSocketClientIndex = accept(pSocket->nSocketIndexServer, (struct sockaddr *)&source_addr, &addr_len);
-        if (nNewSocketClientIndex < 0) 
-        {
-            err = errno;
-            ESP_LOGE(TAG, "Socket %s %d Unable to accept connection %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, nNewSocketClientIndex, err, strerror(err));
-            //socket_disconnect(pSocket); //To Do check not to disconnect socket if no more connections available
-            //close(pSocket->nSocketIndexServer);
-            //pSocket->nSocketIndexServer = -1;
-        }
-        else
+        pConnection->stats.u64BytesIn += nLength;
+        pConnection->stats.u32PacketsIn++;
+        SOCKET_TRACE(DRV_TRACE_LEVEL_DEBUG, DRV_SOCKET_TRACE_RECV_PEEK, pSocket, nConnectionIndex, pRuntime->nPathSocket, nLength, 0);
+        if (socket_dual_path_receive(pSocket, 1, au8Temp, &nLength))
         {
-            char addr_str[128];
-            if (source_addr.ss_family == PF_INET) 
-            {
-                inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str) - 1);
-            }
-            else if (source_addr.ss_family == PF_INET6) 
-            {
-                #if LWIP_IPV6
-                inet6_ntoa_r(((struct sockaddr_in6 *)&source_addr)->sin6_addr, addr_str, sizeof(addr_str) - 1);
-                #else
-                ESP_LOGE(TAG, "Socket %s %d IPv6 Need LWIP_IPV6 defined", pSocket->cName, pSocket->nSocketIndexServer);
-                #endif
-            }
-            ESP_LOGI(TAG, "Socket %s %d accepted ip address: %s", pSocket->cName, pSocket->nSocketIndexServer, addr_str);
-
-            if (socket_connection_add_to_list(pSocket, nNewSocketClientIndex))
+            if (SOCKET_BROADCAST(pRuntime) && (pSocket->onReceiveFrom != NULL))
             {
-                pSocket->nSocketIndexPrimerIP[pSocket->nSocketConnectionsCount-1] = source_addr;
+                struct sockaddr_in *host_addr_recv_ip4 = (struct sockaddr_in *)&pRuntime->host_addr_recv;
+                pSocket->onReceiveFrom(host_addr_recv_ip4->sin_addr.s_addr, htons(host_addr_recv_ip4->sin_port));
             }
-            
-            //pSocket->nSocketIndexPrimer = nNewSocketClientIndex;
+            /* same processing as the active path datagrams */
+            socket_recv_deliver(pSocket, nConnectionIndex, au8Temp, nLength, nSize);
         }
     }
-    // Set the socket back to blocking mode
-    fcntl(pSocket->nSocketIndexServer, F_SETFL, 0);
+    else
+    {
+        err = errno;
+        if ((nLength < 0) && (err != EAGAIN) && (err != EWOULDBLOCK))
+        {
+            ESP_LOGE(TAG, "Error during read from socket %s path IF %d: errno %d (%s)", pSocket->cName, pRuntime->path_if, err, strerror(err));
+            socket_dual_path_close(pSocket);
+            pRuntime->nPathTicks = xTaskGetTickCount() + pdMS_TO_TICKS(DRV_SOCKET_DUAL_PATH_RETRY_MS);
+        }
+    }
+    free(au8Temp);
+}
 
+/* 
+ * Heartbeat frame (DRV_SOCKET_HEARTBEAT_FRAME_SIZE bytes): 0x7E 'H' 'B' type, sequence, sender time (us, low 32 bits) 
+ * both network order. Requests are echoed by the peer with the type changed (or unchanged by a plain echo) 
+ */
+void socket_heartbeat_frame(uint8_t* pFrame, uint8_t u8Type, uint32_t u32Sequence, uint32_t u32TimeUs)
+{
+    pFrame[0] = DRV_SOCKET_HEARTBEAT_MAGIC_0;
+    pFrame[1] = DRV_SOCKET_HEARTBEAT_MAGIC_1;
+    pFrame[2] = DRV_SOCKET_HEARTBEAT_MAGIC_2;
+    pFrame[3] = u8Type;
+    pFrame[4] = (uint8_t)(u32Sequence >> 24);
+    pFrame[5] = (uint8_t)(u32Sequence >> 16);
+    pFrame[6] = (uint8_t)(u32Sequence >> 8);
+    pFrame[7] = (uint8_t)(u32Sequence >> 0);
+    pFrame[8] = (uint8_t)(u32TimeUs >> 24);
+    pFrame[9] = (uint8_t)(u32TimeUs >> 16);
+    pFrame[10] = (uint8_t)(u32TimeUs >> 8);
+    pFrame[11] = (uint8_t)(u32TimeUs >> 0);
 }
 
-void socket_connect_server(drv_socket_t* pSocket)
+void socket_heartbeat_init(drv_socket_t* pSocket, int nConnectionIndex)
 {
-    int err = 0;
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
 
-    int opt = 1;
-    socklen_t optlen = sizeof(opt);
+    memset(&pConnection->heartbeat, 0, sizeof(drv_socket_heartbeat_t));
+    drv_socket_timer_init(&pConnection->timerHeartbeat, socket_heartbeat, pSocket, nConnectionIndex);
+    if (pSocket->bHeartbeatUse)
+    {
+        drv_socket_timer_start(&pSocket->pRuntime->timerWheel, &pConnection->timerHeartbeat, pdMS_TO_TICKS(CONFIG_SOCKET_HEARTBEAT_INTERVAL_MS));
+    }
+}
 
-    int ret_so;
+/* heartbeat timer - send the request, an unanswered previous request is a miss */
+void socket_heartbeat(void* pArg, int nConnectionIndex)
+{
+    drv_socket_t* pSocket = (drv_socket_t*)pArg;
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    drv_socket_heartbeat_t* pHeartbeat = &pConnection->heartbeat;
+    drv_socket_timer_t* pTimer = &pConnection->timerHeartbeat;
+    uint8_t au8Frame[DRV_SOCKET_HEARTBEAT_FRAME_SIZE];
 
-    ret_so = getsockopt( pSocket->nSocketIndexServer , SOL_SOCKET, SO_REUSEADDR,(void*)&opt, &optlen);
-    if (ret_so < 0)
+    if (pSocket->bHeartbeatUse == false)
     {
-        err = errno;
-        ESP_LOGE(TAG, LOG_COLOR(LOG_COLOR_CYAN)"Socket %s %d getsockopt  SO_REUSEADDR=%d retv = %d. errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, opt, ret_so, err, strerror(errno));
+        return;
     }
 
-    opt = 1;
-    ret_so = setsockopt( pSocket->nSocketIndexServer , SOL_SOCKET, SO_REUSEADDR,(void*)&opt, sizeof(opt));
-    if (ret_so < 0)
+    /* fixed period from the last expire (no drift from the loop duration) */
+    TickType_t nNextTicks = pTimer->nExpireTicks + pdMS_TO_TICKS(CONFIG_SOCKET_HEARTBEAT_INTERVAL_MS);
+    if ((int32_t)(nNextTicks - xTaskGetTickCount()) <= 0)
     {
-        err = errno;
-        ESP_LOGE(TAG, LOG_COLOR(LOG_COLOR_CYAN)"Socket %s %d setsockopt  SO_REUSEADDR=%d retv = %d. errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, opt, ret_so, err, strerror(errno));
+        nNextTicks = xTaskGetTickCount() + pdMS_TO_TICKS(CONFIG_SOCKET_HEARTBEAT_INTERVAL_MS);
     }
+    drv_socket_timer_start_at(&pSocket->pRuntime->timerWheel, pTimer, nNextTicks);
 
-    //vTaskDelay(pdMS_TO_TICKS(100));
-
+    if ((pConnection->bSendEnable == false) || SOCKET_BROADCAST(pSocket->pRuntime))
+    {
+        return;
+    }
 
+    if (pHeartbeat->bOutstanding)
+    {
+        pHeartbeat->u8Misses++;
+        pHeartbeat->u32MissesTotal++;
+        drv_socket_link_report_loss(pSocket->pRuntime->adapter_if);
+        if (pHeartbeat->u8Misses >= CONFIG_SOCKET_HEARTBEAT_MISS_COUNT)
+        {
+            ESP_LOGE(TAG, "Socket %s[%d] %d peer dead: %d heartbeats not answered", pSocket->cName, nConnectionIndex, pConnection->nSocket, pHeartbeat->u8Misses);
+            pSocket->pRuntime->stats.u32HeartbeatDeadPeers++;
+            socket_disconnect_connection(pSocket, nConnectionIndex);   /* Removing Socket Client Connection */
+            return;
+        }
+    }
 
-    int eError = bind(pSocket->nSocketIndexServer, (struct sockaddr *)&pSocket->pRuntime->adapterif_addr, sizeof(pSocket->pRuntime->adapterif_addr));
-    if (eError != 0) 
+    pHeartbeat->u32Sequence++;
+    socket_heartbeat_frame(au8Frame, DRV_SOCKET_HEARTBEAT_REQUEST, pHeartbeat->u32Sequence, (uint32_t)esp_timer_get_time());
+    int nLengthSent = pSocket->pRuntime->pSendIo(pSocket, nConnectionIndex, au8Frame, sizeof(au8Frame));     /* UDP server peer - sendto the peer address */
+    pConnection->stats.u32SendCalls++;
+    if (nLengthSent == sizeof(au8Frame))
     {
-        err = errno;
-        ESP_LOGE(TAG, "Socket %s %d unable to bind: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));
+        pConnection->stats.u64BytesOut += nLengthSent;
+        pConnection->stats.u32PacketsOut++;
+        pHeartbeat->u32Sent++;
+        pHeartbeat->bOutstanding = true;
+    }
+}
 
-        struct sockaddr_in *test_addr_ip4 = (struct sockaddr_in *)&pSocket->pRuntime->adapterif_addr;
-        //dest_addr_ip4->sin_addr.s_addr = pSocket->pRuntime->adapter_interface_ip_address;
+/* heartbeat frame received (pFrame[3] valid type) - answer a peer request, RTT of the own request echo */
+void socket_heartbeat_receive(drv_socket_t* pSocket, int nConnectionIndex, uint8_t* pFrame)
+{
+    drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nConnectionIndex);
+    drv_socket_heartbeat_t* pHeartbeat = &pConnection->heartbeat;
+    uint32_t u32Sequence = ((uint32_t)pFrame[4] << 24) | ((uint32_t)pFrame[5] << 16) | ((uint32_t)pFrame[6] << 8) | (uint32_t)pFrame[7];
+    uint32_t u32TimeUs = ((uint32_t)pFrame[8] << 24) | ((uint32_t)pFrame[9] << 16) | ((uint32_t)pFrame[10] << 8) | (uint32_t)pFrame[11];
+    bool bOwn = pHeartbeat->bOutstanding && (u32Sequence == pHeartbeat->u32Sequence);
 
-        in_addr_t interfaceAddress = test_addr_ip4->sin_addr.s_addr;
-        const ip4_addr_t* pInterfaceAddress = (const ip4_addr_t*)&interfaceAddress;
-        char cAdapterInterfaceIP[16];
-        char *adapter_interface_ip = ip4addr_ntoa_r(pInterfaceAddress, cAdapterInterfaceIP, sizeof(cAdapterInterfaceIP));
-        ESP_LOGW(TAG, "Socket %s %d adapterif addr:%s port:%d family:%d", pSocket->cName, pSocket->nSocketIndexServer, adapter_interface_ip, htons(test_addr_ip4->sin_port), test_addr_ip4->sin_family);
-        
-        socket_disconnect(pSocket);
-        //close(pSocket->nSocketIndexServer);
-        //pSocket->nSocketIndexServer = -1;
+    if ((pFrame[3] == DRV_SOCKET_HEARTBEAT_REQUEST) && (bOwn == false))
+    {
+        /* peer heartbeat - answer */
+        pFrame[3] = DRV_SOCKET_HEARTBEAT_ECHO;
+        pSocket->pRuntime->pSendIo(pSocket, nConnectionIndex, pFrame, DRV_SOCKET_HEARTBEAT_FRAME_SIZE);
     }
-    else
+    else if (bOwn)
     {
-        ESP_LOGI(TAG, "Socket %s %d bound to IF %s:%d", pSocket->cName, pSocket->nSocketIndexServer, pSocket->pRuntime->cAdapterInterfaceIP, pSocket->u16Port);
+        uint32_t u32RttUs = (uint32_t)esp_timer_get_time() - u32TimeUs;
+        uint32_t u32DeltaUs = (u32RttUs > pHeartbeat->u32RttLastUs) ? (u32RttUs - pHeartbeat->u32RttLastUs) : (pHeartbeat->u32RttLastUs - u32RttUs);
 
-        eError = listen(pSocket->nSocketIndexServer, 1);
-        if (eError != 0) 
+        if (pHeartbeat->u32Echoes == 0)
         {
-            err = errno;
-            ESP_LOGE(TAG, "Error occurred during listen socket %s %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, err, strerror(err));
-            socket_disconnect(pSocket);
-            //close(pSocket->nSocketIndexServer);
-            //pSocket->nSocketIndexServer = -1;
+            pHeartbeat->u32RttSmoothUs = u32RttUs;
         }
         else
         {
-            ESP_LOGI(TAG, "Socket %s %d listening", pSocket->cName, pSocket->nSocketIndexServer);
+            pHeartbeat->u32RttSmoothUs = (uint32_t)((int32_t)pHeartbeat->u32RttSmoothUs + ((int32_t)u32RttUs - (int32_t)pHeartbeat->u32RttSmoothUs) / 8);
+            pHeartbeat->u32JitterUs = (uint32_t)((int32_t)pHeartbeat->u32JitterUs + ((int32_t)u32DeltaUs - (int32_t)pHeartbeat->u32JitterUs) / 16);
+        }
+        pHeartbeat->u32RttLastUs = u32RttUs;
+        if (u32RttUs > pHeartbeat->u32RttMaxUs) pHeartbeat->u32RttMaxUs = u32RttUs;
+        pHeartbeat->u32Echoes++;
+        pHeartbeat->u8Misses = 0;
+        pHeartbeat->bOutstanding = false;
+        drv_socket_link_report_rtt(pSocket->pRuntime->adapter_if, u32RttUs);
+    }
+}
 
-            struct sockaddr_storage source_addr; // Large enough for both IPv4 or IPv6
-            socklen_t addr_len = sizeof(source_addr);
+/* data record header size of the connection (stream sockets with heartbeat only, 0 - data sent unframed) */
+int socket_heartbeat_record_size(drv_socket_t* pSocket)
+{
+    return (pSocket->bHeartbeatUse && (pSocket->protocol_type == DRV_SOCKET_SOCK_STREAM)) ? DRV_SOCKET_HEARTBEAT_RECORD_SIZE : 0;
+}
 
-            // Set a timeout of 30 seconds
-            struct timeval timeout;
-            timeout.tv_sec = 30;
-            timeout.tv_usec = 0;
+/* data record header: 0x7E 'D' 16 bit data length (network order) */
+void socket_heartbeat_record(uint8_t* pHeader, int nLength)
+{
+    pHeader[0] = DRV_SOCKET_HEARTBEAT_MAGIC_0;
+    pHeader[1] = DRV_SOCKET_HEARTBEAT_RECORD_DATA;
+    pHeader[2] = (uint8_t)(nLength >> 8);
+    pHeader[3] = (uint8_t)(nLength >> 0);
+}
 
-            // Set the socket to non-blocking mode
-            fcntl(pSocket->nSocketIndexServer, F_SETFL, O_NONBLOCK);
+/* 
+ * Returns the data length with the heartbeat frames removed (-1 - stream framing error, disconnect).
+ * Datagram: a heartbeat is a whole datagram. Stream: data records and heartbeat frames only, a record or
+ * frame header split over reads is kept in the connection until complete.
+ */
+int socket_heartbeat_filter(drv_socket_t* pSocket, int nConnectionIndex, uint8_t* pData, int nLength)
+{
+    drv_socket_heartbeat_t* pHeartbeat = &socket_connection_get(pSocket, nConnectionIndex)->heartbeat;
+    uint8_t* pRecord = pHeartbeat->au8RecordRx;
+    int nIn = 0;
+    int nOut = 0;
 
-            // Use select() to wait for the socket to become readable or for the timeout to expire
-            fd_set rfds;
-            FD_ZERO(&rfds);
-            FD_SET(pSocket->nSocketIndexServer, &rfds);
-            int ready = select(pSocket->nSocketIndexServer + 1, &rfds, NULL, NULL, &timeout);
+    if (pSocket->protocol_type != DRV_SOCKET_SOCK_STREAM)
+    {
+        if ((nLength == DRV_SOCKET_HEARTBEAT_FRAME_SIZE) && (pData[0] == DRV_SOCKET_HEARTBEAT_MAGIC_0) && (pData[1] == DRV_SOCKET_HEARTBEAT_MAGIC_1) 
+         && (pData[2] == DRV_SOCKET_HEARTBEAT_MAGIC_2) && (pData[3] <= DRV_SOCKET_HEARTBEAT_ECHO))
+        {
+            socket_heartbeat_receive(pSocket, nConnectionIndex, pData);
+            return 0;
+        }
+        return nLength;
+    }
 
-            if (ready < 0) 
+    while (nIn < nLength)
+    {
+        if (pHeartbeat->u16RecordDataLeft)
+        {
+            int nCopy = nLength - nIn;
+            if (nCopy > pHeartbeat->u16RecordDataLeft)
             {
-                ESP_LOGE(TAG, "Socket %s %d Error in select() function: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, errno, strerror(errno));
-                socket_disconnect(pSocket);
-                //close(pSocket->nSocketIndexServer);
-                //pSocket->nSocketIndexServer = -1;
-            } 
-            else if (ready == 0) 
+                nCopy = pHeartbeat->u16RecordDataLeft;
+            }
+            memmove(&pData[nOut], &pData[nIn], nCopy);
+            nIn += nCopy;
+            nOut += nCopy;
+            pHeartbeat->u16RecordDataLeft -= nCopy;
+            continue;
+        }
+
+        pRecord[pHeartbeat->u8RecordRxCount++] = pData[nIn++];
+        if (pRecord[0] != DRV_SOCKET_HEARTBEAT_MAGIC_0)
+        {
+            return -1;
+        }
+        if (pHeartbeat->u8RecordRxCount < 2)
+        {
+            continue;
+        }
+        if (pRecord[1] == DRV_SOCKET_HEARTBEAT_RECORD_DATA)
+        {
+            if (pHeartbeat->u8RecordRxCount == DRV_SOCKET_HEARTBEAT_RECORD_SIZE)
             {
-                ESP_LOGW(TAG, "Socket %s %d Timeout waiting for client to connect", pSocket->cName, pSocket->nSocketIndexServer);
-                //socket_disconnect(pSocket);
-                //close(pSocket->nSocketIndexServer);
-                //pSocket->nSocketIndexServer = -1;
-            } 
-            else 
+                pHeartbeat->u16RecordDataLeft = ((uint16_t)pRecord[2] << 8) | (uint16_t)pRecord[3];
+                pHeartbeat->u8RecordRxCount = 0;
+            }
+        }
+        else if (pRecord[1] == DRV_SOCKET_HEARTBEAT_MAGIC_1)
+        {
+            if (pHeartbeat->u8RecordRxCount == DRV_SOCKET_HEARTBEAT_FRAME_SIZE)
             {
-                int nNewSocketClientIndex = accept(pSocket->nSocketIndexServer, (struct sockaddr *)&source_addr, &addr_len);
-                if (nNewSocketClientIndex < 0) 
-                {
-                    err = errno;
-                    ESP_LOGE(TAG, "Socket %s %d Unable to accept connection %d: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexServer, nNewSocketClientIndex, err, strerror(err));
-                    socket_disconnect(pSocket);
-                    //close(pSocket->nSocketIndexServer);
-                    //pSocket->nSocketIndexServer = -1;
-                }
-                else
+                if ((pRecord[2] != DRV_SOCKET_HEARTBEAT_MAGIC_2) || (pRecord[3] > DRV_SOCKET_HEARTBEAT_ECHO))
                 {
-                    char addr_str[128];
-                    if (source_addr.ss_family == PF_INET) 
-                    {
-                        inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str) - 1);
-                    }
-                    else if (source_addr.ss_family == PF_INET6) 
-                    {
-                        #if LWIP_IPV6
-                        inet6_ntoa_r(((struct sockaddr_in6 *)&source_addr)->sin6_addr, addr_str, sizeof(addr_str) - 1);
-                        #else
-                        ESP_LOGE(TAG, "Socket %s %d IPv6 Need LWIP_IPV6 defined", pSocket->cName, pSocket->nSocketIndexServer);
-                        #endif
-                    }
-                    ESP_LOGI(TAG, "Socket %s %d accepted ip address: %s", pSocket->cName, pSocket->nSocketIndexServer, addr_str);
-
-                    if (socket_connection_add_to_list(pSocket, nNewSocketClientIndex))
-                    {
-                        pSocket->nSocketIndexPrimerIP[pSocket->nSocketConnectionsCount-1] = source_addr;
-                    }
-                     //pSocket->nSocketIndexPrimer = nNewSocketClientIndex;
+                    return -1;
                 }
+                socket_heartbeat_receive(pSocket, nConnectionIndex, pRecord);
+                pHeartbeat->u8RecordRxCount = 0;
             }
-            // Set the socket back to blocking mode
-            fcntl(pSocket->nSocketIndexServer, F_SETFL, 0);
+        }
+        else
+        {
+            return -1;
         }
     }
+    return nOut;
 }
 
-void socket_connect_client(drv_socket_t* pSocket)
+void socket_wake_init(drv_socket_t* pSocket)
 {
-    int err;
-    int nConnectionIndex  = 0;
-    
-    if (pSocket->nSocketConnectionsCount != 1)
+    #if CONFIG_SOCKET_EVENT_WAKEUP
+    if (bSocketEventFdRegistered == false)
     {
-        ESP_LOGE(TAG, "Socket %s unexpected client type with %d connections ", pSocket->cName, pSocket->nSocketConnectionsCount);
+        esp_vfs_eventfd_config_t config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+        esp_err_t eError = esp_vfs_eventfd_register(&config);
+        if ((eError == ESP_OK) || (eError == ESP_ERR_INVALID_STATE))    /* invalid state - already registered by the application */
+        {
+            bSocketEventFdRegistered = true;
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Unable to register eventfd vfs: %s", esp_err_to_name(eError));
+        }
     }
-    else
+
+    if (bSocketEventFdRegistered)
     {
-        /* client bind should be not neccesairy because an auto bind will take place at first send/recv/sendto/recvfrom using a system assigned local port */
-        int eError = bind(pSocket->nSocketIndexPrimer[nConnectionIndex], (struct sockaddr *)&pSocket->pRuntime->adapterif_addr, sizeof(pSocket->pRuntime->adapterif_addr));
-        if (eError != 0) 
+        pSocket->pRuntime->nWakeEventFd = eventfd(0, 0);
+        if (pSocket->pRuntime->nWakeEventFd < 0)
         {
-            err = errno;
-            ESP_LOGE(TAG, "Socket %s %d unable to bind: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexPrimer[nConnectionIndex], err, strerror(err));
-            socket_disconnect(pSocket);
-            //close(pSocket->nSocketIndexPrimer);
-            //pSocket->nSocketIndexPrimer = -1;
+            ESP_LOGE(TAG, "Unable to create wake eventfd for socket %s (fixed %d ms loop used)", pSocket->cName, DRV_SOCKET_TASK_REST_TIME_MS);
+        }
+    }
+    #endif
+}
+
+void socket_wake_deinit(drv_socket_t* pSocket)
+{
+    #if CONFIG_SOCKET_EVENT_WAKEUP
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    int nWakeEventFd;
+    int nWakeUsers;
+
+    /* no new wake from now on, the writes in progress complete before the close */
+    portENTER_CRITICAL(&wake_mux);
+    nWakeEventFd = pRuntime->nWakeEventFd;
+    pRuntime->nWakeEventFd = -1;
+    nWakeUsers = pRuntime->nWakeUsers;
+    portEXIT_CRITICAL(&wake_mux);
+    while (nWakeUsers > 0)
+    {
+        vTaskDelay(1);
+        portENTER_CRITICAL(&wake_mux);
+        nWakeUsers = pRuntime->nWakeUsers;
+        portEXIT_CRITICAL(&wake_mux);
+    }
+    if (nWakeEventFd >= 0)
+    {
+        close(nWakeEventFd);
+    }
+    #endif
+}
+
+#if CONFIG_SOCKET_EVENT_WAKEUP
+/* ticks until the nearest deadline (0 - work pending, do not sleep) - connections only force an immediate loop for pending send data */
+TickType_t socket_get_wait_ticks(drv_socket_t* pSocket)
+{
+    TickType_t nWaitTicks = drv_socket_timer_next_ticks(&pSocket->pRuntime->timerWheel, pdMS_TO_TICKS(DRV_SOCKET_IDLE_WAKE_TIME_MS));
+
+    for (int nPosition = 0; nPosition < pSocket->nSocketConnectionsCount; nPosition++)
+    {
+        drv_socket_connection_t* pConnection = socket_connection_get(pSocket, socket_connection_slot(pSocket, nPosition));
+        if (pConnection->bSendEnable && pSocket->pRuntime->bDatagramMode)
+        {
+            int nNext = drv_socket_dgram_peek(&pSocket->pRuntime->dgramSend, NULL, NULL, 0);
+            if (nNext >= 0)
+            {
+                TickType_t nRateTicks = pSocket->pRuntime->bDgramSendBlocked ? nTaskRestTimeTicks : socket_rate_wait_ticks(pSocket, pConnection, nNext);
+                if (nRateTicks == 0)
+                {
+                    return 0;
+                }
+                if (nRateTicks < nWaitTicks)
+                {
+                    nWaitTicks = nRateTicks;
+                }
+            }
         }
         else
+        if (pConnection->bSendEnable && pConnection->bSendNotReady)
         {
-            ESP_LOGI(TAG, "Socket %s %d bound to IF %s:%d", pSocket->cName, pSocket->nSocketIndexPrimer[nConnectionIndex], pSocket->pRuntime->cAdapterInterfaceIP, pSocket->u16Port);
-
-            /* Connect to the host by the network interface */
-            if (pSocket->pRuntime->bBroadcastRxTx == false)
+            /* not writable - the select write set wakes the task */
+        }
+        else
+        if (pConnection->bSendEnable && (pConnection->pSendHeld != NULL))
+        {
+            if (nTaskRestTimeTicks < nWaitTicks)
             {
-                int eError = connect(pSocket->nSocketIndexPrimer[nConnectionIndex], (struct sockaddr *)&pSocket->pRuntime->host_addr_main, sizeof(pSocket->pRuntime->host_addr_main));
-                if (eError != 0) 
+                nWaitTicks = nTaskRestTimeTicks;    /* no buffers (ENOMEM) - held frame retried after the task rest time */
+            }
+        }
+        else
+        if (pConnection->bSendEnable)
+        {
+            int nPending = drv_stream_get_size(pConnection->pSendStream);
+            if (pConnection->bPingDue || ((nPending > 0) && (socket_coalesce_hold(pSocket, pConnection, nPending) == false)))
+            {
+                TickType_t nRateTicks = socket_rate_wait_ticks(pSocket, pConnection, nPending);
+                if (nRateTicks == 0)
                 {
-                    err = errno;
-                    ESP_LOGE(TAG, "Socket %s %d unable to connect: errno %d (%s)", pSocket->cName, pSocket->nSocketIndexPrimer[nConnectionIndex], err, strerror(err));
-                    socket_disconnect(pSocket);
-                    //close(pSocket->nSocketIndexPrimer);
-                    //pSocket->nSocketIndexPrimer = -1; 
+                    return 0;
                 }
-                else
+                if (nRateTicks < nWaitTicks)
                 {
-                    ESP_LOGI(TAG, "Socket %s %d connected, port %d", pSocket->cName, pSocket->nSocketIndexPrimer[nConnectionIndex], pSocket->u16Port);
+                    nWaitTicks = nRateTicks;    /* rate limited - wake when the tokens are available */
                 }
             }
-            else
+        }
+        else if (pConnection->bIndentifyNeeded == false)
+        {
+            return 0;   /* send enable pending */
+        }
+
+        if (SOCKET_PREVENT_OVERFLOW(pSocket) && (drv_stream_get_free(pConnection->pRecvStream) == 0))
+        {
+            /* receive stream consumer is not signaled - poll until space is available */
+            if (nTaskRestTimeTicks < nWaitTicks)
             {
-                ESP_LOGI(TAG, "Socket %s %d connected only trough bind (broadcast host address detected), port %d", pSocket->cName, pSocket->nSocketIndexPrimer[nConnectionIndex], pSocket->u16Port);
+                nWaitTicks = nTaskRestTimeTicks;
             }
         }
     }
+    return nWaitTicks;
 }
-
-void socket_prepare_ip_info(drv_socket_t* pSocket)
-{
-    socket_get_adapter_interface_ip(pSocket);
-    socket_prepare_adapter_interface_ip_info(pSocket);
-
-    pSocket->pRuntime->pLastUsedHostIP = socket_get_host_ip_address(pSocket);
-    socket_prepare_host_ip_info(pSocket);
-}
-
-void socket_set_options(drv_socket_t* pSocket, int nConnectionIndex)
+#endif
+
+/* 
+ * Schedule the next connect attempt after a failure. First retry is fast (jitter only),
+ * then exponential backoff with equal jitter: delay in [cap/2, cap], cap doubles up to the maximum.
+ * Jitter spreads the reconnect of many devices after a common outage.
+ */
+void socket_reconnect_schedule(drv_socket_t* pSocket)
 {
-    int err;
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    uint32_t u32DelayMs;
 
-    /* When changed with primer socket here was the main socket (nSocketIndex) */
-    if (pSocket->bPermitBroadcast)
+    if (pRuntime->u16ReconnectAttempt == 0)
     {
-        int bc = 1;
-        if (setsockopt(pSocket->nSocketIndexPrimer[nConnectionIndex], SOL_SOCKET, SO_BROADCAST, &bc, sizeof(bc)) < 0)
-        {
-            err = errno;
-            ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option permit broadcast: errno %d (%s)", pSocket->cName, nConnectionIndex, pSocket->nSocketIndexPrimer[nConnectionIndex], err, strerror(err));
-        }
+        u32DelayMs = esp_random() % (DRV_SOCKET_RECONNECT_FIRST_MS + 1);
     }
-
-    if (pSocket->protocol_type == SOCK_STREAM)   /* if TCP */
+    else
     {
-        // Set tcp keepalive option
-        int keepAlive = 1;
-        int keepIdle = CONFIG_SOCKET_DEFAULT_KEEPALIVE_IDLE;
-        int keepInterval = CONFIG_SOCKET_DEFAULT_KEEPALIVE_INTERVAL;
-        int keepCount = CONFIG_SOCKET_DEFAULT_KEEPALIVE_COUNT;
-        
-        if(setsockopt(pSocket->nSocketIndexPrimer[nConnectionIndex], SOL_SOCKET, SO_KEEPALIVE, &keepAlive, sizeof(int)) < 0)
-        {
-            err = errno;
-            ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option keep alive: errno %d (%s)", pSocket->cName, nConnectionIndex, pSocket->nSocketIndexPrimer[nConnectionIndex], err, strerror(err));
-        }
-
-        if(setsockopt(pSocket->nSocketIndexPrimer[nConnectionIndex], IPPROTO_TCP, TCP_KEEPIDLE, &keepIdle, sizeof(int)) < 0)
+        uint32_t u32CapMs = CONFIG_SOCKET_RECONNECT_BACKOFF_MAX_MS;
+        if (pRuntime->u16ReconnectAttempt <= 16)
         {
-            err = errno;
-            ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option keep idle: errno %d (%s)", pSocket->cName, nConnectionIndex, pSocket->nSocketIndexPrimer[nConnectionIndex], err, strerror(err));
+            u32CapMs = (uint32_t)CONFIG_SOCKET_RECONNECT_BACKOFF_MIN_MS << (pRuntime->u16ReconnectAttempt - 1);
+            if (u32CapMs > CONFIG_SOCKET_RECONNECT_BACKOFF_MAX_MS)
+            {
+                u32CapMs = CONFIG_SOCKET_RECONNECT_BACKOFF_MAX_MS;
+            }
         }
+        u32DelayMs = (u32CapMs / 2) + (esp_random() % ((u32CapMs / 2) + 1));
+    }
+    if (pRuntime->u16ReconnectAttempt < UINT16_MAX)
+    {
+        pRuntime->u16ReconnectAttempt++;
+    }
+    drv_socket_timer_start(&pRuntime->timerWheel, &pRuntime->timerReconnect, pdMS_TO_TICKS(u32DelayMs));
+    ESP_LOGW(TAG, "Socket %s reconnect attempt %d in %u ms", pSocket->cName, pRuntime->u16ReconnectAttempt, (unsigned)u32DelayMs);
+}
 
-        if(setsockopt(pSocket->nSocketIndexPrimer[nConnectionIndex], IPPROTO_TCP, TCP_KEEPINTVL, &keepInterval, sizeof(int)) < 0)
-        {
-            err = errno;
-            ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option keep intvl: errno %d (%s)", pSocket->cName, nConnectionIndex, pSocket->nSocketIndexPrimer[nConnectionIndex], err, strerror(err));
-        }
+/* remaining ticks until the scheduled connect attempt (0 - attempt now) */
+TickType_t socket_reconnect_wait_ticks(drv_socket_t* pSocket)
+{
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
 
-        if(setsockopt(pSocket->nSocketIndexPrimer[nConnectionIndex], IPPROTO_TCP, TCP_KEEPCNT, &keepCount, sizeof(int)) < 0)
-        {
-            err = errno;
-            ESP_LOGE(TAG, "Socket %s[%d] %d Failed to set sock option keen cnt: errno %d (%s)", pSocket->cName, nConnectionIndex, pSocket->nSocketIndexPrimer[nConnectionIndex], err, strerror(err));
-        }
-    }
+    return drv_socket_timer_remaining(&pRuntime->timerWheel, &pRuntime->timerReconnect);
 }
 
-void socket_on_connect(drv_socket_t* pSocket, int nConnectionIndex)
+void socket_reconnect_success(drv_socket_t* pSocket)
 {
-    if (pSocket->bResetSendStreamOnConnect)
-    {
-        drv_stream_init(pSocket->pSendStream[nConnectionIndex], NULL, 0);
-    }
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
 
-    drv_stream_init(pSocket->pRecvStream[nConnectionIndex], NULL, 0);
+    pRuntime->u16ReconnectAttempt = 0;
+    drv_socket_timer_stop(&pRuntime->timerWheel, &pRuntime->timerReconnect);
+    pRuntime->bEndpointCached = (pRuntime->pLastUsedHostIP == pSocket->cHostIPResolved);
+}
 
-    if (pSocket->onConnect != NULL)
-    {
-        pSocket->onConnect(nConnectionIndex);
-    }
-    
+/* 
+ * send does not block (select without wait) - a stalled peer does not hold the other connections in send(),
+ * checked before each send of a service round (the sends of a round fill the socket buffer)
+ */
+bool socket_connection_writable(drv_socket_connection_t* pConnection)
+{
+    fd_set wfds;
+    struct timeval timeout = {0, 0};
 
-    pSocket->bIndentifyNeeded = pSocket->bIndentifyForced;
-    if (pSocket->bIndentifyNeeded)
+    if ((pConnection->nSocket < 0) || (pConnection->bSendEnable == false)
+     || ((drv_stream_get_size(pConnection->pSendStream) == 0) && (pConnection->bPingDue == false) && (pConnection->pSendHeld == NULL)))
     {
-        pSocket->bSendEnable = false;
+        return true;    /* nothing to send */
     }
-    else
-    {
-        pSocket->bSendEnable = pSocket->bAutoSendEnable;
-    }
-    
-    pSocket->nTimeoutSendEnable = 0;
-    pSocket->nPingTicks = 0;
-    pSocket->nPingCount = 0;
+    FD_ZERO(&wfds);
+    FD_SET(pConnection->nSocket, &wfds);
+    return (select(pConnection->nSocket + 1, NULL, &wfds, NULL, &timeout) > 0);
 }
 
-void socket_add_to_list(drv_socket_t* pSocket)
+/* 
+ * deficit round robin over the connections: each round a connection gets CONFIG_SOCKET_SERVICE_QUANTUM bytes per weight
+ * and is served (receive then send) until they are used or it has nothing to transfer, the first served connection 
+ * rotates between loops. CONFIG_SOCKET_SERVICE_BUDGET_US ends the round - the next loop starts from the first connection not served.
+ */
+void socket_service_connections(drv_socket_t* pSocket, int64_t s64LoopStartUs)
 {
-    nSocketCountTotal++;
-    if (nSocketListCount < DRV_SOCKET_COUNT_MAX)
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
+    uint8_t au8Slot[DRV_SOCKET_MAX_CLIENTS];
+    int nCount = pSocket->nSocketConnectionsCount;
+
+    if (nCount <= 0)
     {
-        pSocketList[nSocketListCount++] = pSocket;
+        return;
+    }
+    /* snapshot - on disconnect the last connection is moved in the position of the removed one */
+    int nStart = pRuntime->nServiceStart % nCount;
+    for (int nPosition = 0; nPosition < nCount; nPosition++)
+    {
+        au8Slot[nPosition] = socket_connection_slot(pSocket, (nStart + nPosition) % nCount);
     }
-    
-}
 
-void socket_del_from_list(drv_socket_t* pSocket)
-{
-    nSocketCountTotal--;
-    for (int index = 0; index < nSocketListCount; index++)
+    int nServed;
+    for (nServed = 0; nServed < nCount; nServed++)
     {
-        if (pSocketList[index] == pSocket)
+        int nIndex = au8Slot[nServed];
+
+        if ((CONFIG_SOCKET_SERVICE_BUDGET_US > 0) && (nServed > 0) && ((esp_timer_get_time() - s64LoopStartUs) >= CONFIG_SOCKET_SERVICE_BUDGET_US))
         {
-            pSocketList[index] = NULL;
-            for (int pos = index+1; pos < nSocketListCount; pos++)
+            pRuntime->stats.u32ServiceBudgetCuts++;
+            break;
+        }
+        if (socket_connection_active(pSocket, nIndex) == false)
+        {
+            continue;
+        }
+
+        drv_socket_connection_t* pConnection = socket_connection_get(pSocket, nIndex);
+        bool bSendReady = true;
+
+        pConnection->bSendNotReady = false;
+
+        if (pConnection->s32Deficit < 0)
+        {
+            pConnection->s32Deficit += CONFIG_SOCKET_SERVICE_QUANTUM * pConnection->u8Weight;
+        }
+        else
+        {
+            pConnection->s32Deficit = CONFIG_SOCKET_SERVICE_QUANTUM * pConnection->u8Weight;
+        }
+        while (pConnection->s32Deficit > 0)
+        {
+            uint64_t u64Bytes = pConnection->stats.u64BytesIn + pConnection->stats.u64BytesOut;
+
+            /* Receive Data */
+            socket_recv(pSocket, nIndex);
+            /* Send Data */
+            if (socket_connection_active(pSocket, nIndex))
             {
-                
-                pSocketList[pos-1] = pSocketList[pos];
-                pSocketList[pos] = NULL;
+                bSendReady = socket_connection_writable(pConnection);
+                if (bSendReady)
+                {
+                    socket_send(pSocket, nIndex);
+                }
+                else
+                {
+                    pRuntime->stats.u32SendNotReady++;
+                    pConnection->bSendNotReady = true;      /* socket_wait_events waits until writable */
+                }
+            }
+            if (socket_connection_active(pSocket, nIndex) == false)
+            {
+                break;
+            }
+            u64Bytes = pConnection->stats.u64BytesIn + pConnection->stats.u64BytesOut - u64Bytes;
+            if (u64Bytes == 0)
+            {
+                pConnection->s32Deficit = 0;     /* nothing to transfer - no quanta saved for later */
+                break;
+            }
+            pConnection->s32Deficit -= (int32_t)u64Bytes;
+            if ((bSendReady == false) || ((CONFIG_SOCKET_SERVICE_BUDGET_US > 0) && ((esp_timer_get_time() - s64LoopStartUs) >= CONFIG_SOCKET_SERVICE_BUDGET_US)))
+            {
+                break;
             }
-            nSocketListCount--;
         }
     }
+    /* budget cut - continue from the first connection not served, otherwise rotate by one */
+    pRuntime->nServiceStart = (nStart + ((nServed < nCount) ? nServed : 1)) % nCount;
 }
 
-void socket_runtime_init(drv_socket_t* pSocket)
+/* block until socket data, stream push, disconnect request or the next deadline */
+void socket_wait_events(drv_socket_t* pSocket)
 {
-    /* Runtime Initialization */
-    strcpy(pSocket->pRuntime->cAdapterInterfaceIP,"0.0.0.0");
-    pSocket->pRuntime->pLastUsedHostIP = pSocket->cHostIP;
-    pSocket->pRuntime->bBroadcastRxTx = false;
-    bzero((void*)&pSocket->pRuntime->host_addr_main, sizeof(pSocket->pRuntime->host_addr_main));
-    bzero((void*)&pSocket->pRuntime->host_addr_recv, sizeof(pSocket->pRuntime->host_addr_recv));
-    bzero((void*)&pSocket->pRuntime->host_addr_send, sizeof(pSocket->pRuntime->host_addr_send));
-    bzero((void*)&pSocket->pRuntime->adapterif_addr, sizeof(pSocket->pRuntime->adapterif_addr));
+    #if CONFIG_SOCKET_EVENT_WAKEUP
+    drv_socket_runtime_t* pRuntime = pSocket->pRuntime;
 
-    #if CONFIG_USE_ETHERNET
-    pSocket->pRuntime->adapter_if = ESP_IF_ETH + drv_eth_get_netif_count(); //set as not selected if
-    #else
-    pSocket->pRuntime->adapter_if = ESP_IF_ETH; //set as not selected if
-    #endif
-}
+    TickType_t nWaitTicks;
 
-void socket_force_disconnect(drv_socket_t* pSocket)
-{
-    /* drv_socket_t Initialization */
-    if (pSocket->nSocketIndexServer >= 0)
-    {
-        shutdown(pSocket->nSocketIndexServer, SHUT_RDWR);
-        close(pSocket->nSocketIndexServer);
-        pSocket->nSocketIndexServer = -1;
-    }
-    for (int nIndex = 0; nIndex < DRV_SOCKET_MAX_CLIENTS; nIndex++)
+    if ((pRuntime->nWakeEventFd >= 0) && (pSocket->bConnected == false) && (pSocket->bConnectDeny == false))
     {
-        if (pSocket->nSocketIndexPrimer[nIndex] >= 0)
+        /* reconnect backoff - only the wake event interrupts it */
+        nWaitTicks = socket_reconnect_wait_ticks(pSocket);
+        if (nWaitTicks == 0)
         {
-            shutdown(pSocket->nSocketIndexPrimer[nIndex], SHUT_RDWR);
-            //shutdown(pSocket->nSocketIndexClient, 0);
-            close(pSocket->nSocketIndexPrimer[nIndex]);
-            pSocket->nSocketIndexPrimer[nIndex] = -1;
+            vTaskDelay(nTaskRestTimeTicks);
+            return;
         }
     }
-}
+    else
+    if ((pRuntime->nWakeEventFd < 0) || (pSocket->bConnected == false) || pSocket->bConnectDeny || pSocket->bDisconnectRequest)
+    {
+        vTaskDelay(nTaskRestTimeTicks);
+        return;
+    }
+    else
+    {
+        nWaitTicks = socket_get_wait_ticks(pSocket);
+    }
 
-bool socket_check_interface_connected(esp_interface_t interface)
-{
-    if(interface == ESP_IF_WIFI_STA)
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(pRuntime->nWakeEventFd, &rfds);
+    int nMaxFd = pRuntime->nWakeEventFd;
+
+    if (pSocket->bConnected == false)
     {
-        #if CONFIG_USE_WIFI
-        return drv_wifi_get_sta_connected();
-        #else
-        return false;
-        #endif
+        /* wake event only */
     }
-    else if(interface == ESP_IF_WIFI_AP)
+    else
+    if (pSocket->bServerType && (pSocket->nSocketIndexServer >= 0))
     {
-        #if CONFIG_USE_WIFI
-        return drv_wifi_get_ap_connected();
-        #else
-        return false;
-        #endif
+        FD_SET(pSocket->nSocketIndexServer, &rfds);
+        if (pSocket->nSocketIndexServer > nMaxFd) nMaxFd = pSocket->nSocketIndexServer;
     }
-    else //if(interface >= ESP_IF_ETH)
+    for (int nPosition = 0; nPosition < pSocket->nSocketConnectionsCount; nPosition++)
     {
-        #if CONFIG_USE_ETHERNET
-        int eth_index = interface - ESP_IF_ETH;
-        return drv_eth_get_connected(eth_index);
-        #else
-        return false;
-        #endif
+        drv_socket_connection_t* pConnection = socket_connection_get(pSocket, socket_connection_slot(pSocket, nPosition));
+        int nSocketClient = pConnection->nSocket;
+        if (nSocketClient < 0) continue;
+        if (SOCKET_PREVENT_OVERFLOW(pSocket) && (drv_stream_get_free(pConnection->pRecvStream) == 0)) continue;
+        FD_SET(nSocketClient, &rfds);
+        if (nSocketClient > nMaxFd) nMaxFd = nSocketClient;
     }
-}
 
-void socket_select_adapter_if(drv_socket_t* pSocket)
-{
-    #if CONFIG_USE_ETHERNET
-    if (pSocket->pRuntime->adapter_if >= (ESP_IF_ETH + drv_eth_get_netif_count()))  //not selected valid if
-    #else
-    if (pSocket->pRuntime->adapter_if >= ESP_IF_ETH)  //not selected valid if
-    #endif
+    if ((pSocket->bConnected) && (pRuntime->nPathSocket >= 0))
     {
-        ESP_LOGE(TAG, "Socket %s not selected valid if", pSocket->cName);
-        pSocket->pRuntime->adapter_if = pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_DEFAULT];
-        pSocket->bDisconnectRequest = true;
+        FD_SET(pRuntime->nPathSocket, &rfds);
+        if (pRuntime->nPathSocket > nMaxFd) nMaxFd = pRuntime->nPathSocket;
     }
-    else if (pSocket->pRuntime->adapter_if == pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_DEFAULT])
+
+    uint32_t nWaitMs = nWaitTicks * portTICK_PERIOD_MS;
+    struct timeval timeout;
+    timeout.tv_sec = nWaitMs / 1000;
+    timeout.tv_usec = (nWaitMs % 1000) * 1000;
+
+    /* standby and make-before-break connect completion, writable connections with a postponed send also wake the loop */
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    for (int nPosition = 0; nPosition < pSocket->nSocketConnectionsCount; nPosition++)
     {
-        if (socket_check_interface_connected(pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_DEFAULT]))
-        {
-            if (pSocket->bPriorityBackupAdapterInterface == DRV_SOCKET_PRIORITY_INTERFACE_BACKUP)
-            {
-                if (socket_check_interface_connected(pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_BACKUP]))
-                {
-                    ESP_LOGW(TAG, "Socket %s switch to INTERFACE DEFAULT -> BACKUP", pSocket->cName);
-                    pSocket->pRuntime->adapter_if = pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_BACKUP];
-                    pSocket->bDisconnectRequest = true;
-                } 
-            }
-        }
-        else
+        drv_socket_connection_t* pConnection = socket_connection_get(pSocket, socket_connection_slot(pSocket, nPosition));
+        if ((pConnection->nSocket >= 0) && pConnection->bSendNotReady)
         {
-            if (socket_check_interface_connected(pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_BACKUP]))
-            {
-                ESP_LOGW(TAG, "Socket %s switch to INTERFACE DEFAULT -> BACKUP", pSocket->cName);
-                pSocket->pRuntime->adapter_if = pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_BACKUP];
-                //pSocket->bDisconnectRequest = true;
-            } 
+            FD_SET(pConnection->nSocket, &wfds);
+            if (pConnection->nSocket > nMaxFd) nMaxFd = pConnection->nSocket;
         }
     }
-    else if (pSocket->pRuntime->adapter_if == pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_BACKUP])
+    if ((pSocket->pRuntime->nStandbySocket >= 0) && pSocket->pRuntime->bStandbyConnecting)
     {
-        if (socket_check_interface_connected(pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_BACKUP]))
-        {
-            if (pSocket->bPriorityBackupAdapterInterface == DRV_SOCKET_PRIORITY_INTERFACE_DEFAULT)
-            {
-                if (socket_check_interface_connected(pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_DEFAULT]))
-                {
-                    ESP_LOGW(TAG, "Socket %s switch to INTERFACE BACKUP -> DEFAULT", pSocket->cName);
-                    pSocket->pRuntime->adapter_if = pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_DEFAULT];
-                    pSocket->bDisconnectRequest = true;
-                }
-            }
-        }
-        else
-        {
-            if (socket_check_interface_connected(pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_DEFAULT]))
-            {
-                ESP_LOGW(TAG, "Socket %s switch to INTERFACE BACKUP -> DEFAULT", pSocket->cName);
-                pSocket->pRuntime->adapter_if = pSocket->adapter_interface[DRV_SOCKET_ADAPTER_INTERFACE_DEFAULT];
-                //pSocket->bDisconnectRequest = true;
-            }  
-        }
+        FD_SET(pSocket->pRuntime->nStandbySocket, &wfds);
+        if (pSocket->pRuntime->nStandbySocket > nMaxFd) nMaxFd = pSocket->pRuntime->nStandbySocket;
+    }
+    if (pSocket->pRuntime->nMigrateSocket >= 0)
+    {
+        FD_SET(pSocket->pRuntime->nMigrateSocket, &wfds);
+        if (pSocket->pRuntime->nMigrateSocket > nMaxFd) nMaxFd = pSocket->pRuntime->nMigrateSocket;
     }
 
+    int ready = select(nMaxFd + 1, &rfds, &wfds, NULL, &timeout);
+    if (ready < 0)
+    {
+        ESP_LOGE(TAG, "Socket %s Error in select() wait function: errno %d (%s)", pSocket->cName, errno, strerror(errno));
+        vTaskDelay(nTaskRestTimeTicks);
+    }
+    else if ((ready > 0) && FD_ISSET(pRuntime->nWakeEventFd, &rfds))
+    {
+        uint64_t u64Signal;
+        read(pRuntime->nWakeEventFd, &u64Signal, sizeof(u64Signal));
+    }
+    #else
+    vTaskDelay(nTaskRestTimeTicks);
+    #endif
 }
 
 
@@ -1523,7 +5770,7 @@ static void socket_task(void* parameters)
         vTaskDelete(NULL);
     }
 
-    drv_socket_runtime_t* pSocketRuntime = malloc(sizeof(drv_socket_runtime_t));
+    drv_socket_runtime_t* pSocketRuntime = socket_runtime_alloc(pSocket);
 
     if (pSocketRuntime == NULL)
     {
@@ -1535,6 +5782,16 @@ static void socket_task(void* parameters)
     pSocket->pRuntime = pSocketRuntime;
 
     socket_runtime_init(pSocket);
+    socket_interface_list_apply(pSocket);
+    socket_pipeline_init(pSocket);
+    socket_interface_events_init();
+    #if CONFIG_SOCKET_FEATURE_IDENTIFY
+    socket_identify_match_init();
+    #endif
+    DRV_TRACE_NAME(pSocket, pSocket->cName);
+    socket_stats_reset(pSocket);
+    socket_wake_init(pSocket);
+    socket_dgram_init(pSocket);
     socket_force_disconnect(pSocket);
 
     pSocket->nTaskLoopCounter = 0;
@@ -1546,8 +5803,36 @@ static void socket_task(void* parameters)
   
     while(pSocket->bActiveTask)
     {
+        int64_t s64LoopStartUs = esp_timer_get_time();
+        esp_interface_t adapter_if_before = pSocket->pRuntime->adapter_if;
+
+        if (pSocket->pRuntime->bInterfaceListChanged)
+        {
+            socket_interface_list_apply(pSocket);
+        }
 
-        socket_select_adapter_if(pSocket);
+        /* expired deadlines (ping, identification, heartbeat, reconnect, logs) */
+        drv_socket_timer_process(&pSocket->pRuntime->timerWheel, xTaskGetTickCount());
+
+        /* interface events, list or deny changes only - link quality selection checks the scores each loop */
+        bool bInterfaceDirty = socket_interface_dirty(pSocket);
+        if (bInterfaceDirty || pSocket->bLinkQualitySelect)
+        {
+            socket_select_adapter_if(pSocket);
+        }
+        if (pSocket->pRuntime->adapter_if != adapter_if_before)
+        {
+            pSocket->pRuntime->bIdentifyValid = false;
+        }
+        if (pSocket->pRuntime->bOptionsChanged)
+        {
+            socket_options_apply(pSocket);
+        }
+        socket_stats_service(pSocket);
+        if ((pSocket->pRuntime->adapter_if != adapter_if_before) && (pSocket->pRuntime->stats.u32Connects > 0))
+        {
+            pSocket->pRuntime->stats.u32InterfaceSwitches++;
+        }
 
         /* socket disconnect */
         //if ((pSocket->nSocketIndexPrimer >= 0) || (pSocket->nSocketIndexServer >= 0))
@@ -1561,20 +5846,9 @@ static void socket_task(void* parameters)
         }
 
         /* socket is must be disconnected */
-        if (pSocket->pRuntime != NULL)
+        if (bInterfaceDirty || (pSocket->pRuntime->deny_if != pSocket->pRuntime->adapter_if))
         {
-            if (pSocket->pRuntime->adapter_if == ESP_IF_ETH)//to do fix for more than one eth interface
-            {
-                pSocket->bConnectDeny = pSocket->bConnectDenyETH;
-            }
-            else if (pSocket->pRuntime->adapter_if == ESP_IF_WIFI_STA)
-            {
-                pSocket->bConnectDeny = pSocket->bConnectDenySTA;
-            }
-            else if (pSocket->pRuntime->adapter_if == ESP_IF_WIFI_AP)
-            {
-                pSocket->bConnectDeny = pSocket->bConnectDenyAP;
-            }
+            socket_connect_deny_update(pSocket);
         }
 
         if (pSocket->bConnectDeny)
@@ -1586,24 +5860,43 @@ static void socket_task(void* parameters)
         if (pSocket->bConnected)
         {
             /* Data from/to all connections */
-            for (int nIndex = 0; nIndex < pSocket->nSocketConnectionsCount; nIndex++)
+            socket_service_connections(pSocket, s64LoopStartUs);
+            /* check for incoming connections */
+            if (pSocket->pRuntime->bPeerDemux)
             {
-                /* Receive Data */
-                socket_recv(pSocket, nIndex);
-                /* Send Data */
-                socket_send(pSocket, nIndex);
+                socket_peer_recv(pSocket);
             }
-            /* check for incoming connections */
+            else
             if (pSocket->bServerType)
             {
                 socket_connect_server_periodic(pSocket);
             }
+            else
+            {
+                socket_migrate_maintain(pSocket);
+                socket_standby_maintain(pSocket);
+                socket_dual_path_maintain(pSocket);
+                if (pSocket->nSocketConnectionsCount > 0)
+                {
+                    socket_dual_path_recv(pSocket, socket_connection_slot(pSocket, 0));
+                }
+            }
             
             
 
             //ESP_LOGI(TAG, "socket %s %d: Loop Connected", pSocket->cName, nSocketClient);
         }
         else
+        if (socket_standby_promote(pSocket))
+        {
+            /* switched to the hot standby connection */
+        }
+        else
+        if (socket_reconnect_wait_ticks(pSocket) > 0)
+        {
+            /* reconnect backoff in progress */
+        }
+        else
         {
             /* start connection from beginning */
             //socket_disconnect(pSocket);
@@ -1619,7 +5912,7 @@ static void socket_task(void* parameters)
                 }
                 else
                 {
-                    ESP_LOGW(TAG, "socket client %s[0] %d: Try Create Socket", pSocket->cName, pSocket->nSocketIndexPrimer[0]);
+                    ESP_LOGW(TAG, "socket client %s: Try Create Socket", pSocket->cName);
                 }
                 /* Try Create Socket */
                 socket_strt(pSocket);
@@ -1637,7 +5930,7 @@ static void socket_task(void* parameters)
                 }
                 else
                 {
-                    ESP_LOGW(TAG, "socket client %s[0] %d: Try Connect Socket", pSocket->cName, pSocket->nSocketIndexPrimer[0]);
+                    ESP_LOGW(TAG, "socket client %s[%d] %d: Try Connect Socket", pSocket->cName, socket_connection_slot(pSocket, 0), socket_connection_get(pSocket, socket_connection_slot(pSocket, 0))->nSocket);
                 }
                 /* Try Connect Socket */
                 socket_prepare_ip_info(pSocket);
@@ -1648,35 +5941,46 @@ static void socket_task(void* parameters)
                 }
                 else /* Client socket type */
                 {
+                    drv_socket_stats_t* pStats = &pSocket->pRuntime->stats;
+                    int64_t s64TimeStartUs = esp_timer_get_time();
                     socket_connect_client(pSocket);
+                    pStats->u32ConnectTimeLastMs = (uint32_t)((esp_timer_get_time() - s64TimeStartUs) / 1000);
+                    if (pStats->u32ConnectTimeLastMs > pStats->u32ConnectTimeMaxMs) pStats->u32ConnectTimeMaxMs = pStats->u32ConnectTimeLastMs;
                 }
 
-                if ((pSocket->bServerType == true) && (pSocket->nSocketIndexServer >= 0)) 
-                {
-                    pSocket->bConnected = true;
-                    pSocket->bDisconnectRequest = false;
-                }
-                else
-                if (pSocket->nSocketConnectionsCount > 0)
+                if (((pSocket->bServerType == true) && (pSocket->nSocketIndexServer >= 0)) 
+                 || (pSocket->nSocketConnectionsCount > 0))
                 //if (pSocket->nSocketIndexPrimer[0] > 0)
                 {
-                    
                     pSocket->bConnected = true;
                     pSocket->bDisconnectRequest = false;
+                    if (pSocket->pRuntime->stats.u32Connects++ > 0)
+                    {
+                        pSocket->pRuntime->stats.u32Reconnects++;
+                    }
+                    socket_reconnect_success(pSocket);
+                    socket_failover_done(pSocket);
                 }
                 else
                 {
                     //pSocket->bConnected = false; - not needed
-                    vTaskDelay(nReconnectTimeTicks); 
+                    socket_reconnect_schedule(pSocket);
                 }
             }
         }
         pSocket->nTaskLoopCounter++;
-        vTaskDelay(nTaskRestTimeTicks);
+        socket_stats_loop(pSocket, s64LoopStartUs);
+        socket_wait_events(pSocket);
     }
     socket_force_disconnect(pSocket);
+    socket_dgram_deinit(pSocket);
+    socket_wake_deinit(pSocket);
+    /* a pending background resolve keeps the request until its callback */
+    drv_dns_request_release(pSocketRuntime->pDnsRefresh);
     socket_del_from_list(pSocket);
-    pSocket->pRuntime = NULL;
+    portENTER_CRITICAL(&wake_mux);
+    pSocket->pRuntime = NULL;       /* drv_socket_wake() reads the runtime under wake_mux */
+    portEXIT_CRITICAL(&wake_mux);
     free(pSocketRuntime);
     pSocket->pTask = NULL;
     vTaskDelete(NULL);
@@ -1686,6 +5990,8 @@ static void socket_task(void* parameters)
 esp_err_t drv_socket_task(drv_socket_t* pSocket, int priority)
 {
     if (pSocket == NULL) return ESP_FAIL;
+    pSocket->bActiveTask = false;
+    drv_socket_wake(pSocket);       /* interrupt select() wait of the running task */
     do
     {
         pSocket->bActiveTask = false;
@@ -1709,5 +6015,7 @@ esp_err_t drv_socket_task(drv_socket_t* pSocket, int priority)
 
 void drv_socket_init(void)
 {
-
+    #if CONFIG_SOCKET_FEATURE_IDENTIFY
+    socket_identify_match_init();
+    #endif
 }
\ No newline at end of file
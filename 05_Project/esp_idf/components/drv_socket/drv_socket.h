@@ -27,6 +27,10 @@ extern "C"
 #include "esp_err.h"
 #include "esp_interface.h"
 #include "drv_stream_if.h"
+#include "drv_dns.h"
+#include "drv_socket_timer.h"
+#include "drv_socket_rate.h"
+#include "drv_socket_dgram.h"
 #include "lwip/sockets.h"
 
     
@@ -36,6 +40,64 @@ extern "C"
 #define DRV_SOCKET_DEFAULT_URL  "www.ivetell.com"
 #define DRV_SOCKET_DEFAULT_IP   "84.40.115.3"
 #define DRV_SOCKET_MAX_CLIENTS  CONFIG_SOCKET_SERVER_MAX_CLIENTS
+#define DRV_SOCKET_CONNECTION_POOL_SIZE  CONFIG_SOCKET_CONNECTION_POOL_SIZE
+
+#define DRV_SOCKET_SLOT_FREE                    0xFF        /* au8ConnectionPosition[] value of a not used slot */
+#define DRV_SOCKET_SEGMENT_BUCKETS              6           /* sent size distribution (power of 2 buckets from 64 bytes) */
+#define DRV_SOCKET_INTERFACE_COUNT_MAX          8           /* interface policy list length */
+#define DRV_SOCKET_CONNECTION_HANDLE_INVALID    0
+#define DRV_SOCKET_DGRAM_SIZE_MAX               1472        /* datagram mode: larger received datagrams are truncated, larger sends rejected */
+#define DRV_SOCKET_DGRAM_BATCH_MAX              32          /* datagram mode: datagrams received and sent per connection service */
+#define DRV_SOCKET_PEER_HASH_BITS               6           /* UDP server peer table: 64 buckets (peer address hash -> connection slot) */
+#define DRV_SOCKET_PEER_HASH_SIZE               (1 << DRV_SOCKET_PEER_HASH_BITS)
+#define DRV_SOCKET_COALESCE_DEFAULT_US          20000       /* send coalescing deadline when only u16CoalesceBytes is set */
+
+/* 
+ * dual-path datagram header (bDualPath): magic, path (0 active / 1 alternate interface), 16 bit sender flow id, 
+ * 32 bit sequence (network order). Both copies of a datagram carry the same sequence - the receiver keeps the first.
+ * The flow id (random per sender start) groups both paths of a sender on a UDP server (different source addresses).
+ */
+#define DRV_SOCKET_DUAL_PATH_HEADER_SIZE        8
+#define DRV_SOCKET_DUAL_PATH_MAGIC              0xD2
+#define DRV_SOCKET_DUAL_PATH_ARRIVAL_COUNT      16          /* first arrival times kept for the path lag (power of 2) */
+#define DRV_SOCKET_DUAL_PATH_FLOW_COUNT         8           /* UDP server: dual-path senders tracked (least recent replaced) */
+
+/* 
+ * heartbeat frame (bHeartbeatUse): magic 0x7E 'H' 'B', type, 32 bit sequence, 32 bit sender time (us) - network order.
+ * Datagram sockets: a frame is a whole datagram. Stream sockets: the data is sent in records 0x7E 'D' 16 bit length
+ * followed by the data - frames are sent and recognized only between records (both peers use bHeartbeatUse).
+ */
+#define DRV_SOCKET_HEARTBEAT_FRAME_SIZE         12
+#define DRV_SOCKET_HEARTBEAT_RECORD_SIZE        4
+#define DRV_SOCKET_HEARTBEAT_RECORD_DATA        'D'
+#define DRV_SOCKET_HEARTBEAT_MAGIC_0            0x7E
+#define DRV_SOCKET_HEARTBEAT_MAGIC_1            'H'
+#define DRV_SOCKET_HEARTBEAT_MAGIC_2            'B'
+#define DRV_SOCKET_HEARTBEAT_REQUEST            0
+#define DRV_SOCKET_HEARTBEAT_ECHO               1
+
+/* 
+ * binary identify (bIdentifyBinary): request - magic 0x7E 'I' 'D', type 0; answer - magic, type 1, MAC (6 bytes), 
+ * version major, minor, 32 bit build, 32 bit capabilities (DRV_SOCKET_CAPABILITY_*) - network order. One round trip.
+ */
+#define DRV_SOCKET_IDENTIFY_REQUEST_SIZE        4
+#define DRV_SOCKET_IDENTIFY_ANSWER_SIZE         20
+#define DRV_SOCKET_IDENTIFY_MAGIC_0             0x7E
+#define DRV_SOCKET_IDENTIFY_MAGIC_1             'I'
+#define DRV_SOCKET_IDENTIFY_MAGIC_2             'D'
+#define DRV_SOCKET_IDENTIFY_REQUEST             0
+#define DRV_SOCKET_IDENTIFY_ANSWER              1
+
+#define DRV_SOCKET_CAPABILITY_PING              0x00000001
+#define DRV_SOCKET_CAPABILITY_HEARTBEAT         0x00000002
+#define DRV_SOCKET_CAPABILITY_DUAL_PATH         0x00000004
+#define DRV_SOCKET_CAPABILITY_LINE_ENDING_CR    0x00000008
+
+#define DRV_SOCKET_LINK_HISTORY_COUNT           16          /* link quality interface decisions kept (power of 2) */
+
+#define DRV_SOCKET_STAGE_COUNT_MAX              4           /* application transform stages per direction */
+#define DRV_SOCKET_PIPELINE_COUNT_MAX           (DRV_SOCKET_STAGE_COUNT_MAX + 3)    /* + built-in stages */
+#define DRV_SOCKET_STAGE_SEND_HEADROOM_MAX      512         /* send stages headroom total (send buffer 1024 - frame header - data) */
 
 /* *****************************************************************************
  * Constants and Macros Definitions
@@ -93,6 +155,18 @@ used #include "lwip/sockets.h"
 /* *****************************************************************************
  * Enumeration Definitions
  **************************************************************************** */
+/* trace events (connection argument is index << 16 | socket) - keep in sync with drv_trace/tools/drv_trace_decode.py */
+typedef enum
+{
+    DRV_SOCKET_TRACE_RECV_PEEK,             // connection, length
+    DRV_SOCKET_TRACE_RECV_FROM,             // connection, IPv4 (network order), port
+    DRV_SOCKET_TRACE_RECV_PROCESS,          // connection, length after onReceive, length
+    DRV_SOCKET_TRACE_RECV_PUSH,             // connection, length, recv stream size
+    DRV_SOCKET_TRACE_SEND_TO,               // connection, IPv4 (network order), port
+    DRV_SOCKET_TRACE_SEND,                  // connection, length sent, length
+    DRV_SOCKET_TRACE_DGRAM_RECV,            // connection, length, datagrams queued
+} drv_socket_trace_event_t;
+
 typedef enum
 {
     DRV_SOCKET_AF_UNSPEC = AF_UNSPEC,
@@ -140,11 +214,32 @@ typedef enum
     DRV_SOCKET_PRIORITY_INTERFACE_BACKUP,
 }drv_socket_interface_priority_t;
 
+typedef enum
+{
+    DRV_SOCKET_INTERFACE_SELECT_PRIORITY,       /* first connected in list order - switch back when a preferred one comes up */
+    DRV_SOCKET_INTERFACE_SELECT_STICKY,         /* stay on the current while connected - on loss take the first connected in list order */
+    DRV_SOCKET_INTERFACE_SELECT_COST,           /* lowest cost connected (equal cost - list order) */
+}drv_socket_interface_select_t;
+
+typedef enum
+{
+    DRV_SOCKET_LINK_DECISION_SWITCH,            /* active interface degraded - switched to a better scored one */
+    DRV_SOCKET_LINK_DECISION_SUPPRESS,          /* policy switch not done - target scored worse than the active interface or hold-down */
+}drv_socket_link_decision_type_t;
+
+typedef enum
+{
+    DRV_SOCKET_STAGE_RECV,                      /* received data before the push to the receive stream */
+    DRV_SOCKET_STAGE_SEND,                      /* data pulled from the send stream before send() */
+    DRV_SOCKET_STAGE_DIRECTION_COUNT
+}drv_socket_stage_direction_t;
+
 
 
 /* *****************************************************************************
  * Type Definitions
  **************************************************************************** */
+/* nConnectionIndex is the connection slot - stable for the whole life of the connection */
 typedef void (*drv_socket_on_connect_t)(int nConnectionIndex);
 typedef int (*drv_socket_on_receive_t)(int nConnectionIndex, char* pData, int nMaxSize);
 typedef void (*drv_socket_on_send_t)(int nConnectionIndex, char* pData, int nSize);
@@ -152,36 +247,373 @@ typedef void (*drv_socket_on_disconnect_t)(int nConnectionIndex);
 typedef void (*drv_socket_on_recvfrom_t)(uint32_t,uint16_t);
 typedef void (*drv_socket_on_sendto_t)(uint32_t*,uint16_t*);
 
+/* transform stage: pData processed in place (nSize bytes available), returns the new length - 0 consumed (next stages skipped) */
+typedef int (*drv_socket_stage_process_t)(void* pArg, int nConnectionIndex, uint8_t* pData, int nLength, int nSize);
+
+typedef struct
+{
+    drv_socket_stage_process_t pProcess;
+    void* pArg;
+    uint16_t u16Headroom;                   // bytes the stage may add to the data
+    bool bIdle;                             // called also without data (stage generating data)
+} drv_socket_stage_t;
+
+/* interface list entry (per socket) */
+typedef struct
+{
+    esp_interface_t adapter_if;             // ESP_IF_WIFI_STA, ESP_IF_WIFI_AP, ESP_IF_ETH + eth index
+    bool bConnectDeny;                      // never use this interface for the socket
+    uint8_t u8Cost;                         // metric for DRV_SOCKET_INTERFACE_SELECT_COST (lower is better)
+} drv_socket_interface_policy_t;
+
+/* link quality of an interface (shared by all sockets) */
+typedef struct
+{
+    uint32_t u32RttUs;                      // smoothed (1/8) round trip time
+    uint16_t u16LossPermille;               // smoothed (1/8) loss
+    int8_t s8Rssi;                          // Wi-Fi station signal (0 - not known)
+    uint32_t u32Samples;                    // RTT and loss reports
+    TickType_t nUpdateTicks;                // last report
+    uint32_t u32Score;                      // at the last update (lower is better)
+} drv_socket_link_quality_t;
+
+/* link quality interface decision (history) */
+typedef struct
+{
+    uint32_t u32TimeMs;
+    const char* pName;                      // socket name
+    drv_socket_link_decision_type_t eType;
+    esp_interface_t from_if;
+    esp_interface_t to_if;
+    uint32_t u32ScoreFrom;
+    uint32_t u32ScoreTo;
+} drv_socket_link_decision_t;
+
+/* generation << 16 | slot - detects use of a connection that was closed and its slot reused */
+typedef uint32_t drv_socket_connection_handle_t;
+
+/* data path counters (per connection, summed per socket) */
+typedef struct
+{
+    uint64_t u64BytesIn;
+    uint64_t u64BytesOut;
+    uint32_t u32PacketsIn;
+    uint32_t u32PacketsOut;
+    uint32_t u32RecvCalls;                  // recv/recvfrom syscalls (peek included)
+    uint32_t u32SendCalls;                  // send/sendto syscalls
+    uint32_t u32ShortWrites;
+    uint32_t u32Again;                      // EAGAIN/EWOULDBLOCK results
+    uint32_t u32Throttled;                  // sends delayed by the rate limits
+} drv_socket_io_stats_t;
+
+/* dual-path datagram counters (per path) */
+typedef struct
+{
+    uint32_t u32Sent;
+    uint32_t u32SendErrors;
+    uint32_t u32Received;
+    uint32_t u32First;                      // delivered - arrived before the other path copy
+    uint32_t u32Late;                       // dropped - the other path copy was first
+    uint32_t u32LagLastUs;                  // late arrival behind the other path
+    uint32_t u32LagMaxUs;
+    uint64_t u64LagSumUs;
+} drv_socket_path_stats_t;
+
+/* dual-path duplicate filter of one sender */
+typedef struct
+{
+    bool bValid;                            // u32SequenceRx valid
+    uint16_t u16Flow;                       // sender flow id (UDP server)
+    uint32_t u32SequenceRx;                 // highest received sequence
+    uint64_t u64WindowRx;                   // received bitmap - bit n is sequence u32SequenceRx - n
+    TickType_t nTicks;                      // last datagram (UDP server: least recent flow replaced)
+} drv_socket_path_window_t;
+
+/* dual-path first arrival (path lag measurement) */
+typedef struct
+{
+    uint32_t u32Sequence;
+    uint32_t u32TimeUs;                     // esp_timer low 32 bits
+    uint8_t u8Path;
+} drv_socket_path_arrival_t;
+
+/* per socket counters */
+typedef struct
+{
+    drv_socket_io_stats_t ioClosed;         // totals of already closed connections
+    uint32_t u32Accepts;
+    uint32_t u32Rejects;
+    uint32_t u32Reconnects;
+    uint32_t u32InterfaceSwitches;
+    uint32_t u32DnsTimeLastMs;
+    uint32_t u32DnsTimeMaxMs;
+    uint32_t u32ConnectTimeLastMs;          // client sockets only
+    uint32_t u32ConnectTimeMaxMs;
+    uint32_t u32FailoverTimeLastMs;         // interface event -> data path restored on the new interface
+    uint32_t u32FailoverTimeMaxMs;
+    uint32_t u32Migrations;                 // make-before-break switches
+    uint32_t u32StandbySwitches;            // hot standby connection promoted
+    uint32_t u32Connects;
+    uint32_t u32HeartbeatDeadPeers;         // connections closed on heartbeat misses
+    uint32_t u32ServiceBudgetCuts;          // loops ended by CONFIG_SOCKET_SERVICE_BUDGET_US (next loop starts there)
+    uint32_t u32SendNotReady;               // sends postponed - connection not writable
+    uint32_t u32FlushSize;                  // coalesced sends started by u16CoalesceBytes or a full send stream
+    uint32_t u32FlushDeadline;              // ... by u32CoalesceUs
+    uint32_t u32FlushRequest;               // ... by drv_socket_flush or a due ping
+    uint32_t au32SegmentCount[DRV_SOCKET_SEGMENT_BUCKETS];  // sent sizes: <64, <128, <256, <512, <1024, >=1024 bytes
+    uint32_t u32DgramRecvBatches;           // datagram mode: receive services with at least one datagram
+    uint32_t u32DgramRecvBatchMax;          // most datagrams drained in one service
+    uint32_t u32DgramSendBatches;
+    uint32_t u32DgramSendBatchMax;
+    uint32_t u32DgramSendErrors;            // datagrams dropped on send error (not EAGAIN/ENOMEM)
+    uint32_t u32PeerIdleClosed;             // UDP server: peer connections closed after the idle time
+    uint32_t u32PeerReplaced;               // ... the longest idle peer replaced by a new one (table full)
+    uint32_t u32PeerDropped;                // ... datagrams without a connection (table full) or not delivered (receive stream full)
+    uint32_t u32LoopCount;
+    uint32_t u32LoopTimeMinUs;
+    uint32_t u32LoopTimeMaxUs;
+    uint64_t u64LoopTimeSumUs;
+    int64_t s64RateWindowStartUs;           // rolling throughput window
+    uint64_t u64RateBytesInMark;
+    uint64_t u64RateBytesOutMark;
+    uint32_t u32RateInBps;                  // bytes per second of the last window
+    uint32_t u32RateOutBps;
+    drv_socket_path_stats_t asPath[2];      // dual-path: 0 active interface, 1 alternate interface
+} drv_socket_stats_t;
+
+/* heartbeat state and RTT (per connection) */
+typedef struct
+{
+    uint32_t u32Sequence;                   // last request sent
+    bool bOutstanding;                      // last request not answered
+    uint8_t u8Misses;                       // consecutive not answered requests
+    uint32_t u32RttLastUs;
+    uint32_t u32RttSmoothUs;                // 1/8 smoothed
+    uint32_t u32RttMaxUs;
+    uint32_t u32JitterUs;                   // 1/16 smoothed RTT difference
+    uint32_t u32Sent;
+    uint32_t u32Echoes;
+    uint32_t u32MissesTotal;
+    uint8_t au8RecordRx[DRV_SOCKET_HEARTBEAT_FRAME_SIZE];    // stream: record header or frame split over reads
+    uint8_t u8RecordRxCount;
+    uint16_t u16RecordDataLeft;             // stream: data bytes left of the current record
+} drv_socket_heartbeat_t;
+
+/* socket options applied on create (and on drv_socket_set_options to the open sockets) - all zero: stack defaults, Kconfig keepalive */
+typedef struct
+{
+    uint8_t u8Dscp;                         // IP_TOS DSCP (0..63), e.g. 46 EF for control traffic
+    bool bNoDelay;                          // TCP_NODELAY - no Nagle delay of small segments
+    bool bKeepAliveOff;
+    uint16_t u16KeepAliveIdleS;             // 0 - CONFIG_SOCKET_DEFAULT_KEEPALIVE_IDLE
+    uint16_t u16KeepAliveIntervalS;         // 0 - CONFIG_SOCKET_DEFAULT_KEEPALIVE_INTERVAL
+    uint8_t u8KeepAliveCount;               // 0 - CONFIG_SOCKET_DEFAULT_KEEPALIVE_COUNT
+    bool bLinger;                           // SO_LINGER with u16LingerS (0 - reset on close)
+    uint16_t u16LingerS;
+    int nSendBufferSize;                    // SO_SNDBUF, 0 - stack default
+    int nRecvBufferSize;                    // SO_RCVBUF, 0 - stack default
+    bool bBufferAutoTune;                   // buffers sized from the measured bandwidth-delay product (buffer sizes above are the start values)
+} drv_socket_options_t;
+
+/* buffer auto-tune state (per connection) */
+typedef struct
+{
+    int nSendBufferSize;                    // last set/read (0 - not known)
+    int nRecvBufferSize;
+    uint64_t u64BytesOutMark;               // bytes of the previous period
+    uint64_t u64BytesInMark;
+    bool bSendFailed;                       // option not supported by the stack - not tried again
+    bool bRecvFailed;
+} drv_socket_buffer_tune_t;
+
+/* compact peer address (IPv4 or IPv6) */
+typedef struct
+{
+    uint8_t u8Family;                       // AF_INET / AF_INET6 / AF_UNSPEC (not known)
+    uint16_t u16Port;                       // host byte order
+    union
+    {
+        uint32_t u32IPv4;                   // network byte order
+        uint8_t au8IPv6[16];
+    };
+} drv_socket_peer_t;
+
+struct drv_socket_s;
+
+/* connection data transfer selected once for the socket configuration (socket_io_select) - TCP/UDP or UDP broadcast */
+typedef int (*drv_socket_recv_io_t)(struct drv_socket_s* pSocket, int nConnectionIndex, uint8_t* pData, int nLength, int nFlags);
+typedef int (*drv_socket_send_io_t)(struct drv_socket_s* pSocket, int nConnectionIndex, uint8_t* pData, int nLength);
+
+/* per-connection state (shared pool object) - hot fields (touched every loop or every recv/send call) first, cold fields after */
+typedef struct drv_socket_connection_s
+{
+    /* hot */
+    int nSocket;                            // connection socket descriptor (-1 not used)
+    bool bSendEnable;
+    bool bIndentifyNeeded;
+    drv_stream_t* pSendStream;
+    drv_stream_t* pRecvStream;
+    bool bPingDue;                          // no send activity for DRV_SOCKET_PING_SEND_TIME_MS
+    volatile bool bFlushRequest;            // drv_socket_flush - send all buffered data now
+    bool bSendNotReady;                     // send postponed - not writable (waited for in the select write set)
+    uint8_t* pSendHeld;                     // frame not sent (EAGAIN/ENOMEM) - sent before any new data
+    uint16_t u16SendHeldLength;             // held frame length (header included)
+    uint8_t u8SendHeldHeader;               // held frame header size
+    bool bSendHeldDualPath;                 // held frame has the dual-path header (alternate copy already sent)
+    int64_t s64UnsentUs;                    // first unsent byte seen (0 - send stream empty)
+    uint8_t u8IdentifyMatchState;           // identify request matcher state (kept across reads)
+    uint8_t u8LineEndingPrev;               // last byte of the previous read (line ending pairs split over reads)
+    uint8_t u8Weight;                       // service quanta per round (drv_socket_set_connection_weight)
+    int32_t s32Deficit;                     // bytes left of the service quanta (negative - overrun of the last round)
+    drv_socket_io_stats_t stats;            // counted on each recv/send call
+    drv_socket_rate_t rate;                 // connection send limit (drv_socket_set_connection_rate) - refilled on each send
+
+    /* cold */
+    TickType_t nConnectTicks;               // connection start tick
+    size_t nPingCount;
+    drv_socket_peer_t peer;                 // accepted client address (AF_UNSPEC for client sockets)
+    TickType_t nPeerActivityTicks;          // UDP server peer: last datagram received (idle eviction)
+    drv_socket_heartbeat_t heartbeat;
+    drv_socket_buffer_tune_t bufferTune;
+    drv_socket_timer_t timerPing;           // restarted on each send
+    drv_socket_timer_t timerIdentify;       // identification timeout
+    drv_socket_timer_t timerHeartbeat;      // heartbeat period
+    drv_socket_timer_t timerCoalesce;       // coalesce deadline wakeup (hold-off)
+    drv_stream_t sSendStream;               // streams used when the application does not provide them
+    drv_stream_t sRecvStream;
+    struct drv_socket_connection_s* pPoolNext;
+
+} drv_socket_connection_t;
+
 typedef struct 
 {
     char cAdapterInterfaceIP[16];
     char * pLastUsedHostIP;
     bool bBroadcastRxTx;
+    drv_socket_recv_io_t pRecvIo;
+    drv_socket_send_io_t pSendIo;
     struct sockaddr_storage adapterif_addr;   // Large enough for both IPv4 or IPv6
     struct sockaddr_storage host_addr_main; // Large enough for both IPv4 or IPv6
     struct sockaddr_storage host_addr_recv; // Large enough for both IPv4 or IPv6
     struct sockaddr_storage host_addr_send; // Large enough for both IPv4 or IPv6
     esp_interface_t adapter_if;             // the selected if
+    int nWakeEventFd;                       // eventfd used to wake the socket task from select()
+    int nWakeUsers;                         // drv_socket_wake() calls writing to nWakeEventFd (under wake_mux)
+
+    /* connection slot table (slot index is used as nConnectionIndex) - arrays allocated after the runtime, nSlotCount entries */
+    int nSlotCount;                                 // DRV_SOCKET_MAX_CLIENTS for server, 1 for client
+    int nFreeSlotCount;
+    drv_socket_connection_t** apConnection;         // slot -> pool connection object (NULL if free)
+    uint16_t* au16Generation;                       // incremented on each slot use
+    uint8_t* au8ConnectionSlot;                     // active slots, first nSocketConnectionsCount valid (unordered)
+    uint8_t* au8ConnectionPosition;                 // slot -> position in au8ConnectionSlot or DRV_SOCKET_SLOT_FREE
+    uint8_t* au8FreeSlot;                           // free slots stack
+    uint8_t* au8PeerNext;                           // UDP server: slot -> next slot of the same peer hash bucket
+    drv_socket_stats_t stats;
+    int nServiceStart;                              // position served first in the next loop (rotated)
+    volatile bool bInterfaceListChanged;    // drv_socket_set_interface_list - copied by the task
+    drv_socket_interface_policy_t asInterface[DRV_SOCKET_INTERFACE_COUNT_MAX];  // task copy of the interface list
+    int nInterfaceCount;
+    drv_socket_interface_select_t eInterfaceSelect;
+    bool bInterfaceDirty;                   // interface selection and connect deny re-evaluated in the next loop
+    uint32_t u32InterfaceGeneration;        // interface state generation seen
+    uint8_t u8ConnectDenySeen;              // bConnectDenyETH/STA/AP seen (bits 0/1/2)
+    esp_interface_t deny_if;                // interface bConnectDeny was evaluated for
+    volatile bool bStatsPrintRequest;       // drv_socket_stats_print - printed by the task
+    volatile bool bStatsResetRequest;       // drv_socket_stats_reset - reset by the task
+
+    /* identification answers built once per interface (socket_identify_build) */
+    bool bIdentifyValid;
+    esp_interface_t identify_if;
+    uint8_t au8IdentifyMac[6];
+    int nIdentifyBannerLength;
+    char cIdentifyBanner[64];
+    uint8_t au8IdentifyAnswer[DRV_SOCKET_IDENTIFY_ANSWER_SIZE];
+
+    /* deadlines of the socket task (connection timers included) */
+    drv_socket_timer_wheel_t timerWheel;
+    drv_socket_timer_t timerAcceptLog;      // "waiting for client" log hold-off
+    drv_socket_timer_t timerBufferTune;     // buffer auto-tune period
+
+    drv_socket_rate_t rate;                 // socket send limit (all connections)
+    volatile bool bOptionsChanged;          // drv_socket_set_options - applied to the open sockets by the task
+
+    /* UDP server peer table - one connection per peer address, all on the server socket */
+    bool bPeerDemux;                        // UDP server socket
+    uint8_t au8PeerHash[DRV_SOCKET_PEER_HASH_SIZE];  // first slot of the bucket or DRV_SOCKET_SLOT_FREE
+    drv_socket_timer_t timerPeerIdle;       // idle peer check period
+    TickType_t nPeerReplaceTicks;           // last replace scan without an idle peer (table full)
+
+    /* datagram mode queues (bDatagramMode UDP) - record per datagram with the source/destination drv_socket_peer_t */
+    bool bDatagramMode;                     // queues allocated - socket_recv/socket_send use the datagram engine
+    bool bDgramSendBlocked;                 // last send EAGAIN/ENOMEM - retried after the task rest time, not at once
+    drv_socket_dgram_queue_t dgramRecv;
+    drv_socket_dgram_queue_t dgramSend;
+
+    /* transform pipelines composed at the task start (socket_pipeline_init) */
+    drv_socket_stage_t asPipeline[DRV_SOCKET_STAGE_DIRECTION_COUNT][DRV_SOCKET_PIPELINE_COUNT_MAX];
+    uint8_t au8PipelineCount[DRV_SOCKET_STAGE_DIRECTION_COUNT];
+    uint16_t au16PipelineHeadroom[DRV_SOCKET_STAGE_DIRECTION_COUNT];
+
+    /* reconnect backoff and cached endpoint */
+    bool bEndpointCached;                   // cHostIPResolved connected successfully - reused without DNS
+    uint16_t u16ReconnectAttempt;           // failed connect attempts since the last success
+    drv_socket_timer_t timerReconnect;      // next connect attempt
+    drv_dns_request_t* pDnsRefresh;         // background resolve of cURL (released on task exit, may outlive the runtime)
+
+    /* interface failover */
+    int64_t s64FailoverStartUs;             // interface event time of a pending failover (0 - none)
+    TickType_t nMigrateRetryTicks;          // next make-before-break attempt after a failed one
+    int nMigrateSocket;                     // make-before-break connect in progress (-1 none)
+    esp_interface_t migrate_if;
+    TickType_t nMigrateTicks;               // connect timeout
+
+    /* hot standby connection (not in the connection table until promoted) */
+    int nStandbySocket;                     // -1 not used
+    esp_interface_t standby_if;
+    bool bStandbyConnecting;                // non-blocking connect in progress
+    TickType_t nStandbyTicks;               // next open retry / liveness check
+    int64_t s64ConnectionLostUs;            // client connection lost (standby switch time start)
+
+    /* dual-path datagrams (second socket on the alternate interface) */
+    int nPathSocket;                        // -1 not used
+    esp_interface_t path_if;
+    TickType_t nPathTicks;                  // next open retry
+    uint32_t u32PathSequenceTx;
+    uint16_t u16PathFlowTx;                 // flow id sent in the header
+    drv_socket_path_window_t pathRx;        // UDP client duplicate filter
+    drv_socket_path_window_t asPathFlowRx[DRV_SOCKET_DUAL_PATH_FLOW_COUNT];   // UDP server duplicate filter per sender
+    drv_socket_path_arrival_t asPathArrival[DRV_SOCKET_DUAL_PATH_ARRIVAL_COUNT];
+
+    /* link quality selection */
+    bool bLinkSwitched;                     // nLinkSwitchTicks valid
+    TickType_t nLinkSwitchTicks;            // last link quality switch (hold-down)
 
 } drv_socket_runtime_t;
 
 
-typedef struct
+/*
+ * API change: the per-connection fields moved to drv_socket_connection_t (task owned, not public) and are removed here:
+ *  nSocketIndexPrimer[]    - drv_socket_get_connection_handle / drv_socket_get_connection_index (slot), fd is not exported
+ *  nSocketIndexPrimerIP[]  - drv_socket_get_connection_peer
+ *  bSendEnable             - drv_socket_get_send_enable
+ *  bIndentifyNeeded, nTimeoutSendEnable, nPingTicks, nPingCount - internal per connection, no replacement
+ */
+typedef struct drv_socket_s
 {
 
-    int nSocketIndexPrimer[DRV_SOCKET_MAX_CLIENTS];
     int nSocketIndexServer;
     int nSocketConnectionsCount;
     bool bServerType;
     bool bActiveTask;
     bool bConnected;
-    bool bSendEnable;               
     bool bSendFillEnable;               /* Used always to be able to fill send data to send stream (used outside of drv_socket.c) */
     bool bAutoSendEnable;
     bool bIndentifyForced;
-    bool bIndentifyNeeded;
+    bool bIdentifyBinary;               /* answer the binary identify request (MAC, version, capabilities) - identification complete in one round trip */
     bool bResetSendStreamOnConnect;
     bool bPingUse;
+    bool bHeartbeatUse;                 /* binary heartbeat with echo matching: RTT/jitter per connection, dead peer after CONFIG_SOCKET_HEARTBEAT_MISS_COUNT misses */
     bool bLineEndingFixCRLFToCR;
     bool bPermitBroadcast;
     bool bDisconnectRequest;
@@ -190,15 +622,17 @@ typedef struct
     bool bConnectDenySTA;
     bool bConnectDenyAP;
     bool bPriorityBackupAdapterInterface;
+    bool bMakeBeforeBreak;              /* TCP client: connect on the new interface before closing the old connection on priority switch */
+    bool bHotStandby;                   /* TCP client: keep an idle connection on the next usable interface and switch to it on failure */
+    bool bLinkQualitySelect;            /* leave a degraded active interface for a better scored one (RTT, loss, RSSI) with hysteresis */
+    bool bDualPath;                     /* UDP client: send each datagram on the active and the alternate interface (sequence header, duplicates dropped on receive); UDP server: header of dual-path senders removed, duplicates dropped */
     bool bPreventOverflowReceivedData;
+    uint16_t u16PeerIdleS;              /* UDP server: peer connection closed after this time without datagrams (0 - DRV_SOCKET_PEER_IDLE_DEFAULT_S) */
+    bool bDatagramMode;                 /* UDP: datagram queues (drv_socket_send_datagram/drv_socket_recv_datagram) keep boundaries and peer addresses, streams and stages not used */
     #ifdef CONFIG_EXAMPLE_IPV6
     bool bIPV6;
     #endif
 
-    size_t nPingTicks;
-    size_t nPingCount;
-    size_t nTimeoutSendEnable;
-
     int nTaskLoopCounter;
 
 
@@ -207,7 +641,17 @@ typedef struct
     char cHostIPResolved[16];
     char cURL[32];
     uint16_t u16Port;
-    esp_interface_t adapter_interface[2];
+    esp_interface_t adapter_interface[2];   /* default/backup pair - used when nInterfaceCount is 0 */
+    drv_socket_interface_policy_t asInterface[DRV_SOCKET_INTERFACE_COUNT_MAX];  /* ordered interface list (highest priority first), drv_socket_set_interface_list at runtime */
+    int nInterfaceCount;
+    drv_socket_interface_select_t eInterfaceSelect;
+    uint32_t u32RateLimitBps;           /* send limit of the socket (all connections), 0 - no limit (drv_socket_set_rate at runtime) */
+    uint32_t u32RateBurstBytes;         /* 0 - DRV_SOCKET_RATE_BURST_TIME_MS of the rate */
+    uint32_t u32ConnectionRateLimitBps; /* send limit of each connection set on connect (drv_socket_set_connection_rate at runtime) */
+    uint32_t u32ConnectionRateBurstBytes;
+    drv_socket_options_t options;       /* drv_socket_set_options at runtime */
+    uint16_t u16CoalesceBytes;          /* send coalescing: hold the data until this many bytes are buffered or the send stream is full (0 - no size condition) */
+    uint32_t u32CoalesceUs;             /* ... or this time passed since the first unsent byte (0 - DRV_SOCKET_COALESCE_DEFAULT_US), drv_socket_flush sends at once */
 
     drv_socket_address_family_t address_family;
     //drv_socket_protocol_family_t protocol_family;
@@ -215,7 +659,7 @@ typedef struct
     drv_socket_protocol_type_t protocol_type;
 
     TaskHandle_t pTask;
-    drv_stream_t * pSendStream[DRV_SOCKET_MAX_CLIENTS];
+    drv_stream_t * pSendStream[DRV_SOCKET_MAX_CLIENTS];     /* optional application streams per connection slot (NULL - own stream of the connection, see drv_socket_get_send_stream) */
     drv_stream_t * pRecvStream[DRV_SOCKET_MAX_CLIENTS];
     drv_socket_on_connect_t onConnect;
     drv_socket_on_receive_t onReceive;
@@ -223,8 +667,9 @@ typedef struct
     drv_socket_on_disconnect_t onDisconnect;
     drv_socket_on_recvfrom_t onReceiveFrom;
     drv_socket_on_sendto_t onSendTo;
+    drv_socket_stage_t asStage[DRV_SOCKET_STAGE_DIRECTION_COUNT][DRV_SOCKET_STAGE_COUNT_MAX];   /* application stages (drv_socket_add_stage) */
+    uint8_t au8StageCount[DRV_SOCKET_STAGE_DIRECTION_COUNT];
     drv_socket_runtime_t* pRuntime;
-    struct sockaddr_storage nSocketIndexPrimerIP[DRV_SOCKET_MAX_CLIENTS];
 
 } drv_socket_t;
 
@@ -243,6 +688,30 @@ void drv_socket_list(void);
 int drv_socket_get_position(const char* name);
 drv_socket_t* drv_socket_get_handle(const char* name);
 void drv_socket_disconnect(drv_socket_t* pSocket);
+void drv_socket_wake(drv_socket_t* pSocket);
+drv_socket_connection_handle_t drv_socket_get_connection_handle(drv_socket_t* pSocket, int nConnectionIndex);
+int drv_socket_get_connection_index(drv_socket_t* pSocket, drv_socket_connection_handle_t hConnection);
+drv_stream_t* drv_socket_get_send_stream(drv_socket_t* pSocket, int nConnectionIndex);
+drv_stream_t* drv_socket_get_recv_stream(drv_socket_t* pSocket, int nConnectionIndex);
+bool drv_socket_get_connection_peer(drv_socket_t* pSocket, int nConnectionIndex, drv_socket_peer_t* pPeer);
+bool drv_socket_get_send_enable(drv_socket_t* pSocket, int nConnectionIndex);
+bool drv_socket_set_connection_weight(drv_socket_t* pSocket, int nConnectionIndex, uint8_t u8Weight);
+void drv_socket_set_rate(drv_socket_t* pSocket, uint32_t u32RateBps, uint32_t u32BurstBytes);
+bool drv_socket_set_connection_rate(drv_socket_t* pSocket, int nConnectionIndex, uint32_t u32RateBps, uint32_t u32BurstBytes);
+bool drv_socket_set_interface_rate(esp_interface_t adapter_if, uint32_t u32RateBps, uint32_t u32BurstBytes);
+void drv_socket_interface_rate_print(void);
+void drv_socket_flush(drv_socket_t* pSocket, int nConnectionIndex);
+bool drv_socket_send_datagram(drv_socket_t* pSocket, const drv_socket_peer_t* pPeer, const uint8_t* pData, int nLength);
+int drv_socket_recv_datagram(drv_socket_t* pSocket, drv_socket_peer_t* pPeer, uint8_t* pData, int nSize);
+void drv_socket_set_options(drv_socket_t* pSocket, const drv_socket_options_t* pOptions);
+void drv_socket_get_options(drv_socket_t* pSocket, drv_socket_options_t* pOptions);
+void drv_socket_set_interface_list(drv_socket_t* pSocket, const drv_socket_interface_policy_t* pInterface, int nCount, drv_socket_interface_select_t eSelect);
+bool drv_socket_add_stage(drv_socket_t* pSocket, drv_socket_stage_direction_t eDirection, drv_socket_stage_process_t pProcess, void* pArg, uint16_t u16Headroom);
+void drv_socket_stats_print(drv_socket_t* pSocket);
+void drv_socket_stats_reset(drv_socket_t* pSocket);
+void drv_socket_link_report_rtt(esp_interface_t adapter_if, uint32_t u32RttUs);
+void drv_socket_link_report_loss(esp_interface_t adapter_if);
+void drv_socket_link_print(void);
 esp_err_t drv_socket_task(drv_socket_t* pSocket, int priority);
 void drv_socket_init(void);
 
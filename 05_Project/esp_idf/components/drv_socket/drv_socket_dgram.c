@@ -0,0 +1,212 @@
+/* *****************************************************************************
+ * File:   drv_socket_dgram.c
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Datagram queue (record ring - boundaries and peer address kept)
+ *
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include "drv_socket_dgram.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+#define DGRAM_WRAP              0xFFFF      /* record length of the wrap marker - next record at the buffer start */
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function-Like Macros
+ **************************************************************************** */
+#define DGRAM_ALIGN(nSize)                  (((nSize) + 3) & ~3)
+#define DGRAM_HEADER_SIZE(pQueue)           (sizeof(uint32_t) + (pQueue)->nMetaSize)
+#define DGRAM_RECORD_SIZE(pQueue, nLength)  (DGRAM_HEADER_SIZE(pQueue) + DGRAM_ALIGN(nLength))
+
+/* *****************************************************************************
+ * Variables Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Prototype of functions definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Functions
+ **************************************************************************** */
+bool drv_socket_dgram_init(drv_socket_dgram_queue_t* pQueue, size_t nSize, size_t nMetaSize)
+{
+    memset(pQueue, 0, sizeof(drv_socket_dgram_queue_t));
+    nSize &= ~3;
+    pQueue->pBuffer = malloc(nSize);
+    pQueue->flag_available = xSemaphoreCreateBinary();
+    if ((pQueue->pBuffer == NULL) || (pQueue->flag_available == NULL))
+    {
+        drv_socket_dgram_deinit(pQueue);
+        return false;
+    }
+    pQueue->nSize = nSize;
+    pQueue->nMetaSize = DGRAM_ALIGN(nMetaSize);
+    xSemaphoreGive(pQueue->flag_available);
+    return true;
+}
+
+void drv_socket_dgram_deinit(drv_socket_dgram_queue_t* pQueue)
+{
+    if (pQueue->flag_available != NULL)
+    {
+        vSemaphoreDelete(pQueue->flag_available);
+    }
+    free(pQueue->pBuffer);
+    memset(pQueue, 0, sizeof(drv_socket_dgram_queue_t));
+}
+
+void drv_socket_dgram_set_on_push(drv_socket_dgram_queue_t* pQueue, drv_socket_dgram_on_push_t onPush, void* pArg)
+{
+    pQueue->pOnPushArg = pArg;
+    pQueue->onPush = onPush;
+}
+
+/* false - no space (datagram dropped and counted) or not initialized; pMeta NULL - metadata zeroed */
+bool drv_socket_dgram_push(drv_socket_dgram_queue_t* pQueue, const void* pMeta, const uint8_t* pData, int nLength)
+{
+    bool bResult = false;
+
+    if ((pQueue->pBuffer == NULL) || (nLength < 0) || (nLength >= DGRAM_WRAP))
+    {
+        return false;
+    }
+    size_t nRecord = DGRAM_RECORD_SIZE(pQueue, nLength);
+
+    xSemaphoreTake(pQueue->flag_available, portMAX_DELAY);
+
+    size_t nGap = 0;
+    if ((pQueue->nHead >= pQueue->nTail) && ((pQueue->nSize - pQueue->nHead) < nRecord))
+    {
+        nGap = pQueue->nSize - pQueue->nHead;   /* record does not fit at the end - wrap */
+    }
+    if ((pQueue->nUsed + nGap + nRecord) <= pQueue->nSize)
+    {
+        if (nGap)
+        {
+            *(uint32_t*)&pQueue->pBuffer[pQueue->nHead] = DGRAM_WRAP;     /* gap is at least 4 bytes (all sizes aligned) */
+            pQueue->nUsed += nGap;
+            pQueue->nHead = 0;
+        }
+        uint8_t* pRecord = &pQueue->pBuffer[pQueue->nHead];
+        *(uint32_t*)pRecord = nLength;
+        if (pMeta != NULL)
+        {
+            memcpy(pRecord + sizeof(uint32_t), pMeta, pQueue->nMetaSize);
+        }
+        else
+        {
+            memset(pRecord + sizeof(uint32_t), 0, pQueue->nMetaSize);
+        }
+        memcpy(pRecord + DGRAM_HEADER_SIZE(pQueue), pData, nLength);
+        pQueue->nHead += nRecord;
+        if (pQueue->nHead >= pQueue->nSize)
+        {
+            pQueue->nHead = 0;
+        }
+        pQueue->nUsed += nRecord;
+        pQueue->u32Count++;
+        bResult = true;
+    }
+    else
+    {
+        pQueue->u32Dropped++;
+    }
+
+    xSemaphoreGive(pQueue->flag_available);
+    if (bResult && (pQueue->onPush != NULL))
+    {
+        pQueue->onPush(pQueue->pOnPushArg);
+    }
+    return bResult;
+}
+
+/* oldest datagram copied (data truncated to nSize, pMeta/pData may be NULL), bRemove - taken from the queue */
+static int dgram_read(drv_socket_dgram_queue_t* pQueue, void* pMeta, uint8_t* pData, int nSize, bool bRemove)
+{
+    int nLength = -1;
+
+    if (pQueue->pBuffer == NULL)
+    {
+        return -1;
+    }
+    xSemaphoreTake(pQueue->flag_available, portMAX_DELAY);
+    if (pQueue->u32Count > 0)
+    {
+        if (*(uint32_t*)&pQueue->pBuffer[pQueue->nTail] == DGRAM_WRAP)
+        {
+            pQueue->nUsed -= pQueue->nSize - pQueue->nTail;
+            pQueue->nTail = 0;
+        }
+        uint8_t* pRecord = &pQueue->pBuffer[pQueue->nTail];
+        nLength = *(uint32_t*)pRecord;
+        if (pMeta != NULL)
+        {
+            memcpy(pMeta, pRecord + sizeof(uint32_t), pQueue->nMetaSize);
+        }
+        if (pData != NULL)
+        {
+            memcpy(pData, pRecord + DGRAM_HEADER_SIZE(pQueue), (nLength < nSize) ? nLength : nSize);
+        }
+
+        if (bRemove)
+        {
+            size_t nRecord = DGRAM_RECORD_SIZE(pQueue, nLength);
+            pQueue->nTail += nRecord;
+            if (pQueue->nTail >= pQueue->nSize)
+            {
+                pQueue->nTail = 0;
+            }
+            pQueue->nUsed -= nRecord;
+            pQueue->u32Count--;
+            if (pQueue->u32Count == 0)
+            {
+                pQueue->nHead = 0;      /* empty - largest contiguous space */
+                pQueue->nTail = 0;
+                pQueue->nUsed = 0;
+            }
+        }
+    }
+    xSemaphoreGive(pQueue->flag_available);
+    return nLength;
+}
+
+/* length of the oldest datagram (kept in the queue), -1 - queue empty */
+int drv_socket_dgram_peek(drv_socket_dgram_queue_t* pQueue, void* pMeta, uint8_t* pData, int nSize)
+{
+    return dgram_read(pQueue, pMeta, pData, nSize, false);
+}
+
+/* length of the oldest datagram (removed, data beyond nSize discarded), -1 - queue empty */
+int drv_socket_dgram_pull(drv_socket_dgram_queue_t* pQueue, void* pMeta, uint8_t* pData, int nSize)
+{
+    return dgram_read(pQueue, pMeta, pData, nSize, true);
+}
+
+uint32_t drv_socket_dgram_count(drv_socket_dgram_queue_t* pQueue)
+{
+    return pQueue->u32Count;
+}
+
@@ -0,0 +1,84 @@
+/* *****************************************************************************
+ * File:   drv_socket_dgram.h
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Datagram queue (record ring - boundaries and peer address kept)
+ *
+ **************************************************************************** */
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+typedef void (*drv_socket_dgram_on_push_t)(void* pArg);
+
+/* records [length][metadata][data] 4 byte aligned in a ring, a record is never split (wrap marker at the end) */
+typedef struct
+{
+    uint8_t* pBuffer;
+    size_t nSize;
+    size_t nMetaSize;                       // per record metadata (e.g. source/destination address), 4 byte aligned
+    size_t nHead;                           // next record written
+    size_t nTail;                           // next record read
+    size_t nUsed;                           // bytes of records and wrap gap
+    uint32_t u32Count;                      // records queued
+    uint32_t u32Dropped;                    // push without space
+    SemaphoreHandle_t flag_available;
+    drv_socket_dgram_on_push_t onPush;      /* called after successful push (used to wake the queue consumer) */
+    void* pOnPushArg;
+} drv_socket_dgram_queue_t;
+
+/* *****************************************************************************
+ * Function-Like Macro
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Variables External Usage
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function Prototypes
+ **************************************************************************** */
+bool drv_socket_dgram_init(drv_socket_dgram_queue_t* pQueue, size_t nSize, size_t nMetaSize);
+void drv_socket_dgram_deinit(drv_socket_dgram_queue_t* pQueue);
+void drv_socket_dgram_set_on_push(drv_socket_dgram_queue_t* pQueue, drv_socket_dgram_on_push_t onPush, void* pArg);
+bool drv_socket_dgram_push(drv_socket_dgram_queue_t* pQueue, const void* pMeta, const uint8_t* pData, int nLength);
+int drv_socket_dgram_peek(drv_socket_dgram_queue_t* pQueue, void* pMeta, uint8_t* pData, int nSize);
+int drv_socket_dgram_pull(drv_socket_dgram_queue_t* pQueue, void* pMeta, uint8_t* pData, int nSize);
+uint32_t drv_socket_dgram_count(drv_socket_dgram_queue_t* pQueue);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
@@ -0,0 +1,104 @@
+/* *****************************************************************************
+ * File:   drv_socket_line.c
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Line ending normalization of the received data (in place, streaming)
+ *
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include "drv_socket_line.h"
+
+#include <string.h>
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+/* native word (32 bit on the targets) - bytes tested together */
+#define LINE_WORD_SIZE          sizeof(line_word_t)
+#define LINE_WORD_ONES          ((line_word_t)-1 / 0xFF)
+#define LINE_WORD_HIGHS         (LINE_WORD_ONES * 0x80)
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+typedef size_t line_word_t;
+
+/* *****************************************************************************
+ * Function-Like Macros
+ **************************************************************************** */
+#define LINE_WORD_HAS_ZERO(w)           (((w) - LINE_WORD_ONES) & ~(w) & LINE_WORD_HIGHS)
+#define LINE_WORD_HAS_BYTE(w, b)        LINE_WORD_HAS_ZERO((w) ^ (LINE_WORD_ONES * (b)))
+
+/* *****************************************************************************
+ * Variables Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Prototype of functions definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Functions
+ **************************************************************************** */
+/* 
+ * CRLF -> CR and LFCR -> LF in one pass (compaction in place), returns the new length.
+ * *pu8Prev is the last kept byte of the previous chunk (0 after a removed pair) - pairs split over reads are found too.
+ * Words without CR/LF are moved at once, only the bytes around line endings are handled one by one.
+ */
+int drv_socket_line_crlf_to_cr(uint8_t* pData, int nLength, uint8_t* pu8Prev)
+{
+    uint8_t u8Prev = *pu8Prev;
+    int nIn = 0;
+    int nOut = 0;
+
+    while (nIn < nLength)
+    {
+        if ((u8Prev != '\r') && (u8Prev != '\n'))
+        {
+            while (nIn + (int)LINE_WORD_SIZE <= nLength)
+            {
+                line_word_t uWord;
+                memcpy(&uWord, &pData[nIn], LINE_WORD_SIZE);
+                if (LINE_WORD_HAS_BYTE(uWord, '\r') || LINE_WORD_HAS_BYTE(uWord, '\n'))
+                {
+                    break;
+                }
+                if (nOut != nIn)
+                {
+                    memcpy(&pData[nOut], &uWord, LINE_WORD_SIZE);
+                }
+                nIn += LINE_WORD_SIZE;
+                nOut += LINE_WORD_SIZE;
+                u8Prev = pData[nOut - 1];
+            }
+            if (nIn >= nLength)
+            {
+                break;
+            }
+        }
+
+        uint8_t u8Byte = pData[nIn++];
+        if (((u8Prev == '\r') && (u8Byte == '\n')) || ((u8Prev == '\n') && (u8Byte == '\r')))
+        {
+            u8Prev = 0;     /* second byte of the pair removed */
+            continue;
+        }
+        pData[nOut++] = u8Byte;
+        u8Prev = u8Byte;
+    }
+    *pu8Prev = u8Prev;
+    return nOut;
+}
@@ -0,0 +1,59 @@
+/* *****************************************************************************
+ * File:   drv_socket_line.h
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Line ending normalization of the received data (in place, streaming)
+ *
+ **************************************************************************** */
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function-Like Macro
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Variables External Usage
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function Prototypes
+ **************************************************************************** */
+int drv_socket_line_crlf_to_cr(uint8_t* pData, int nLength, uint8_t* pu8Prev);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
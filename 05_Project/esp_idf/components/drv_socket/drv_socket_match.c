@@ -0,0 +1,168 @@
+/* *****************************************************************************
+ * File:   drv_socket_match.c
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Streaming multi-pattern matcher (Aho-Corasick automaton)
+ *
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include "drv_socket_match.h"
+
+#include <string.h>
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+#define MATCH_NONE      0xFF
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function-Like Macros
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Variables Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Prototype of functions definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Functions
+ **************************************************************************** */
+/* returns false if the patterns do not fit in DRV_SOCKET_MATCH_STATES_MAX / DRV_SOCKET_MATCH_CLASSES_MAX */
+bool drv_socket_match_build(drv_socket_match_t* pMatch, const drv_socket_match_pattern_t* asPattern, int nCount)
+{
+    uint8_t au8Fail[DRV_SOCKET_MATCH_STATES_MAX];
+    uint8_t au8Queue[DRV_SOCKET_MATCH_STATES_MAX];
+    int nQueueHead = 0;
+    int nQueueTail = 0;
+
+    memset(pMatch, 0, sizeof(drv_socket_match_t));
+    memset(pMatch->au8Next, MATCH_NONE, sizeof(pMatch->au8Next));
+    pMatch->u8States = 1;
+    pMatch->u8Classes = 1;
+
+    /* byte classes and trie */
+    for (int nPattern = 0; nPattern < nCount; nPattern++)
+    {
+        int nState = 0;
+        for (int index = 0; index < asPattern[nPattern].u8Length; index++)
+        {
+            uint8_t u8Byte = asPattern[nPattern].pData[index];
+            if (pMatch->au8Class[u8Byte] == 0)
+            {
+                if (pMatch->u8Classes >= DRV_SOCKET_MATCH_CLASSES_MAX)
+                {
+                    return false;
+                }
+                pMatch->au8Class[u8Byte] = pMatch->u8Classes++;
+            }
+            uint8_t* pNext = &pMatch->au8Next[nState][pMatch->au8Class[u8Byte]];
+            if (*pNext == MATCH_NONE)
+            {
+                if (pMatch->u8States >= DRV_SOCKET_MATCH_STATES_MAX)
+                {
+                    return false;
+                }
+                *pNext = pMatch->u8States++;
+            }
+            nState = *pNext;
+        }
+        if (pMatch->au8Output[nState] == 0)
+        {
+            pMatch->au8Output[nState] = nPattern + 1;
+        }
+    }
+
+    /* failure links breadth first - missing transitions replaced by the ones of the failure state */
+    for (int nClass = 0; nClass < DRV_SOCKET_MATCH_CLASSES_MAX; nClass++)
+    {
+        uint8_t u8Next = pMatch->au8Next[0][nClass];
+        if (u8Next == MATCH_NONE)
+        {
+            pMatch->au8Next[0][nClass] = 0;
+        }
+        else
+        {
+            au8Fail[u8Next] = 0;
+            au8Queue[nQueueTail++] = u8Next;
+        }
+    }
+    while (nQueueHead < nQueueTail)
+    {
+        int nState = au8Queue[nQueueHead++];
+        for (int nClass = 0; nClass < DRV_SOCKET_MATCH_CLASSES_MAX; nClass++)
+        {
+            uint8_t u8Next = pMatch->au8Next[nState][nClass];
+            uint8_t u8FailNext = pMatch->au8Next[au8Fail[nState]][nClass];
+            if (u8Next == MATCH_NONE)
+            {
+                pMatch->au8Next[nState][nClass] = u8FailNext;
+            }
+            else
+            {
+                au8Fail[u8Next] = u8FailNext;
+                if (pMatch->au8Output[u8Next] == 0)
+                {
+                    pMatch->au8Output[u8Next] = pMatch->au8Output[u8FailNext];  /* pattern ending as a suffix */
+                }
+                au8Queue[nQueueTail++] = u8Next;
+            }
+        }
+    }
+    return true;
+}
+
+/* 
+ * scan pData from *pnOffset: returns the matched pattern index (*pnOffset after its last byte) 
+ * or -1 at the end of the data (*pnOffset = nLength). *pu8State continues over the calls (split patterns).
+ */
+int drv_socket_match_run(const drv_socket_match_t* pMatch, uint8_t* pu8State, const uint8_t* pData, int nLength, int* pnOffset)
+{
+    uint8_t u8State = *pu8State;
+    int index = *pnOffset;
+
+    while (index < nLength)
+    {
+        /* root - skip bytes not starting any pattern */
+        if (u8State == 0)
+        {
+            while ((index < nLength) && (pMatch->au8Class[pData[index]] == 0))
+            {
+                index++;
+            }
+            if (index >= nLength)
+            {
+                break;
+            }
+        }
+        u8State = pMatch->au8Next[u8State][pMatch->au8Class[pData[index++]]];
+        if (pMatch->au8Output[u8State])
+        {
+            *pu8State = u8State;
+            *pnOffset = index;
+            return pMatch->au8Output[u8State] - 1;
+        }
+    }
+    *pu8State = u8State;
+    *pnOffset = nLength;
+    return -1;
+}
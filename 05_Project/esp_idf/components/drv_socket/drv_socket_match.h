@@ -0,0 +1,80 @@
+/* *****************************************************************************
+ * File:   drv_socket_match.h
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Streaming multi-pattern matcher (Aho-Corasick automaton)
+ *
+ **************************************************************************** */
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+#define DRV_SOCKET_MATCH_STATES_MAX     32          /* total pattern length + 1 */
+#define DRV_SOCKET_MATCH_CLASSES_MAX    16          /* distinct pattern bytes + 1 (class 0 - byte not in any pattern) */
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+typedef struct
+{
+    const uint8_t* pData;
+    uint8_t u8Length;
+} drv_socket_match_pattern_t;
+
+/* 
+ * complete transition table (failure links resolved at build time) - one lookup per input byte, 
+ * the state (uint8_t, 0 - root) is kept by the user between calls
+ */
+typedef struct
+{
+    uint8_t au8Class[256];                                                      // input byte -> class
+    uint8_t au8Next[DRV_SOCKET_MATCH_STATES_MAX][DRV_SOCKET_MATCH_CLASSES_MAX];
+    uint8_t au8Output[DRV_SOCKET_MATCH_STATES_MAX];                             // matched pattern + 1 (0 - none)
+    uint8_t u8States;
+    uint8_t u8Classes;
+} drv_socket_match_t;
+
+/* *****************************************************************************
+ * Function-Like Macro
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Variables External Usage
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function Prototypes
+ **************************************************************************** */
+bool drv_socket_match_build(drv_socket_match_t* pMatch, const drv_socket_match_pattern_t* asPattern, int nCount);
+int drv_socket_match_run(const drv_socket_match_t* pMatch, uint8_t* pu8State, const uint8_t* pData, int nLength, int* pnOffset);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
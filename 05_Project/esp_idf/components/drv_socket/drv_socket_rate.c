@@ -0,0 +1,131 @@
+/* *****************************************************************************
+ * File:   drv_socket_rate.c
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Token bucket rate limiter (bytes per second with burst)
+ *
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include "drv_socket_rate.h"
+
+#include <string.h>
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+#define RATE_SCALE      1000000LL       /* credit units per byte (rate in bytes/s times elapsed us) */
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function-Like Macros
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Variables Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Prototype of functions definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Functions
+ **************************************************************************** */
+/* rate 0 - no limit, burst 0 - DRV_SOCKET_RATE_BURST_TIME_MS of the rate; starts with a full bucket, counters kept */
+void drv_socket_rate_init(drv_socket_rate_t* pRate, uint32_t u32RateBps, uint32_t u32BurstBytes, int64_t s64NowUs)
+{
+    if (u32BurstBytes == 0)
+    {
+        u32BurstBytes = (uint32_t)(((uint64_t)u32RateBps * DRV_SOCKET_RATE_BURST_TIME_MS) / 1000);
+    }
+    if (u32BurstBytes < DRV_SOCKET_RATE_BURST_MIN)
+    {
+        u32BurstBytes = DRV_SOCKET_RATE_BURST_MIN;
+    }
+    pRate->u32RateBps = u32RateBps;
+    pRate->u32BurstBytes = u32BurstBytes;
+    pRate->s64Credit = (int64_t)u32BurstBytes * RATE_SCALE;
+    pRate->s64UpdateUs = s64NowUs;
+}
+
+/* bytes that can be sent now (DRV_SOCKET_RATE_UNLIMITED if no limit) */
+int drv_socket_rate_available(drv_socket_rate_t* pRate, int64_t s64NowUs)
+{
+    if (pRate->u32RateBps == 0)
+    {
+        return DRV_SOCKET_RATE_UNLIMITED;
+    }
+
+    int64_t s64ElapsedUs = s64NowUs - pRate->s64UpdateUs;
+    int64_t s64CreditMax = (int64_t)pRate->u32BurstBytes * RATE_SCALE;
+
+    if (s64ElapsedUs > 0)
+    {
+        /* a full bucket is reached at most after burst/rate seconds - longer idle time does not overflow */
+        if (s64ElapsedUs > (s64CreditMax / pRate->u32RateBps) + 1)
+        {
+            pRate->s64Credit = s64CreditMax;
+        }
+        else
+        {
+            pRate->s64Credit += s64ElapsedUs * pRate->u32RateBps;
+            if (pRate->s64Credit > s64CreditMax)
+            {
+                pRate->s64Credit = s64CreditMax;
+            }
+        }
+        pRate->s64UpdateUs = s64NowUs;
+    }
+    if (pRate->s64Credit <= 0)
+    {
+        return 0;
+    }
+    return (int)(pRate->s64Credit / RATE_SCALE);
+}
+
+/* bytes sent - the credit may go negative (header bytes, ping), repaid before the next send */
+void drv_socket_rate_consume(drv_socket_rate_t* pRate, int nBytes)
+{
+    pRate->u64Bytes += nBytes;
+    if (pRate->u32RateBps != 0)
+    {
+        pRate->s64Credit -= (int64_t)nBytes * RATE_SCALE;
+    }
+}
+
+/* time until nBytes are available (after drv_socket_rate_available), 0 - available now or no limit */
+uint32_t drv_socket_rate_wait_us(drv_socket_rate_t* pRate, int nBytes)
+{
+    if (pRate->u32RateBps == 0)
+    {
+        return 0;
+    }
+    if (nBytes > (int)pRate->u32BurstBytes)
+    {
+        nBytes = pRate->u32BurstBytes;
+    }
+
+    int64_t s64Missing = (int64_t)nBytes * RATE_SCALE - pRate->s64Credit;
+    if (s64Missing <= 0)
+    {
+        return 0;
+    }
+    return (uint32_t)((s64Missing + pRate->u32RateBps - 1) / pRate->u32RateBps);
+}
+
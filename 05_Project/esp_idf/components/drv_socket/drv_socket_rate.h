@@ -0,0 +1,73 @@
+/* *****************************************************************************
+ * File:   drv_socket_rate.h
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Token bucket rate limiter (bytes per second with burst)
+ *
+ **************************************************************************** */
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+#define DRV_SOCKET_RATE_UNLIMITED       INT32_MAX
+#define DRV_SOCKET_RATE_BURST_MIN       1460        /* one full segment at least */
+#define DRV_SOCKET_RATE_BURST_TIME_MS   100         /* burst if not given - rate of 100 ms */
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+typedef struct
+{
+    uint32_t u32RateBps;                    // 0 - no limit
+    uint32_t u32BurstBytes;                 // bucket size
+    int64_t s64Credit;                      // tokens in bytes * 1000000 (byte fractions kept between refills, negative - overrun)
+    int64_t s64UpdateUs;                    // last refill
+    uint64_t u64Bytes;                      // bytes passed
+    uint32_t u32Throttled;                  // sends delayed because of no tokens
+} drv_socket_rate_t;
+
+/* *****************************************************************************
+ * Function-Like Macro
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Variables External Usage
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function Prototypes
+ **************************************************************************** */
+void drv_socket_rate_init(drv_socket_rate_t* pRate, uint32_t u32RateBps, uint32_t u32BurstBytes, int64_t s64NowUs);
+int drv_socket_rate_available(drv_socket_rate_t* pRate, int64_t s64NowUs);
+void drv_socket_rate_consume(drv_socket_rate_t* pRate, int nBytes);
+uint32_t drv_socket_rate_wait_us(drv_socket_rate_t* pRate, int nBytes);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
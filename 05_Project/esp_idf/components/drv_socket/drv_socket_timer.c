@@ -0,0 +1,282 @@
+/* *****************************************************************************
+ * File:   drv_socket_timer.c
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Hierarchical timer wheel (tick resolution, O(1) start and stop)
+ *
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include "drv_socket_timer.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+#define TIMER_SLOT_MASK         (DRV_SOCKET_TIMER_SLOTS - 1)
+#define TIMER_LEVEL_SHIFT(l)    (DRV_SOCKET_TIMER_LEVEL_BITS * (l))
+#define TIMER_RANGE_TICKS       ((TickType_t)1 << TIMER_LEVEL_SHIFT(DRV_SOCKET_TIMER_LEVELS))
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function-Like Macros
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Variables Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Prototype of functions definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Functions
+ **************************************************************************** */
+/* offset of the first non-empty slot starting from nFrom (cyclic), u64Used must not be 0 */
+static int timer_slot_offset(uint64_t u64Used, int nFrom)
+{
+    uint64_t u64Rotated = (nFrom == 0) ? u64Used : ((u64Used >> nFrom) | (u64Used << (DRV_SOCKET_TIMER_SLOTS - nFrom)));
+    return __builtin_ctzll(u64Rotated);
+}
+
+/*
+ * Level by the distance from nBase (the first tick not processed yet): level 0 - fired when its slot is reached,
+ * upper levels - moved down when the wheel enters the slot period. Beyond the range - parked in the last level.
+ */
+static void timer_link(drv_socket_timer_wheel_t* pWheel, drv_socket_timer_t* pTimer, TickType_t nBase)
+{
+    TickType_t nSlotTicks = pTimer->nExpireTicks;
+    TickType_t nDelta = nSlotTicks - nBase;
+    int nLevel;
+
+    if ((int32_t)nDelta < 0)
+    {
+        nSlotTicks = nBase;     /* already due */
+        nDelta = 0;
+    }
+    for (nLevel = 0; nLevel < DRV_SOCKET_TIMER_LEVELS - 1; nLevel++)
+    {
+        if (nDelta < ((TickType_t)1 << TIMER_LEVEL_SHIFT(nLevel + 1)))
+        {
+            break;
+        }
+    }
+    if (nDelta >= TIMER_RANGE_TICKS)
+    {
+        nSlotTicks = nBase + TIMER_RANGE_TICKS - 1;
+    }
+
+    int nSlot = (nSlotTicks >> TIMER_LEVEL_SHIFT(nLevel)) & TIMER_SLOT_MASK;
+    drv_socket_timer_t** ppHead = &pWheel->apSlot[nLevel][nSlot];
+
+    pTimer->pNext = *ppHead;
+    if (pTimer->pNext != NULL)
+    {
+        pTimer->pNext->ppPrev = &pTimer->pNext;
+    }
+    pTimer->ppPrev = ppHead;
+    pTimer->u8Level = nLevel;
+    pTimer->u8Slot = nSlot;
+    *ppHead = pTimer;
+    pWheel->au64Used[nLevel] |= (uint64_t)1 << nSlot;
+}
+
+static void timer_unlink(drv_socket_timer_wheel_t* pWheel, drv_socket_timer_t* pTimer)
+{
+    *pTimer->ppPrev = pTimer->pNext;
+    if (pTimer->pNext != NULL)
+    {
+        pTimer->pNext->ppPrev = pTimer->ppPrev;
+    }
+    pTimer->pNext = NULL;
+    pTimer->ppPrev = NULL;
+
+    if (pWheel->apSlot[pTimer->u8Level][pTimer->u8Slot] == NULL)
+    {
+        pWheel->au64Used[pTimer->u8Level] &= ~((uint64_t)1 << pTimer->u8Slot);
+    }
+}
+
+static void timer_cascade(drv_socket_timer_wheel_t* pWheel, int nLevel, TickType_t nBase)
+{
+    int nSlot = (nBase >> TIMER_LEVEL_SHIFT(nLevel)) & TIMER_SLOT_MASK;
+    drv_socket_timer_t* pTimer = pWheel->apSlot[nLevel][nSlot];
+
+    pWheel->apSlot[nLevel][nSlot] = NULL;
+    pWheel->au64Used[nLevel] &= ~((uint64_t)1 << nSlot);
+    while (pTimer != NULL)
+    {
+        drv_socket_timer_t* pNext = pTimer->pNext;
+        timer_link(pWheel, pTimer, nBase);
+        pTimer = pNext;
+    }
+}
+
+static void timer_fire(drv_socket_timer_wheel_t* pWheel, int nSlot)
+{
+    /* detached list - callbacks may start and stop any timer (also the ones still in this list) */
+    drv_socket_timer_t* pList = pWheel->apSlot[0][nSlot];
+
+    if (pList == NULL)
+    {
+        return;
+    }
+    pWheel->apSlot[0][nSlot] = NULL;
+    pWheel->au64Used[0] &= ~((uint64_t)1 << nSlot);
+    pList->ppPrev = &pList;
+
+    while (pList != NULL)
+    {
+        drv_socket_timer_t* pTimer = pList;
+        *pTimer->ppPrev = pTimer->pNext;
+        if (pTimer->pNext != NULL)
+        {
+            pTimer->pNext->ppPrev = pTimer->ppPrev;
+        }
+        pTimer->pNext = NULL;
+        pTimer->ppPrev = NULL;
+        pTimer->bActive = false;
+        pWheel->nCount--;
+        if (pTimer->pCallback != NULL)
+        {
+            pTimer->pCallback(pTimer->pArg, pTimer->nArg);
+        }
+    }
+}
+
+void drv_socket_timer_wheel_init(drv_socket_timer_wheel_t* pWheel, TickType_t nTicksNow)
+{
+    memset(pWheel, 0, sizeof(drv_socket_timer_wheel_t));
+    pWheel->nTicks = nTicksNow;
+}
+
+void drv_socket_timer_init(drv_socket_timer_t* pTimer, drv_socket_timer_callback_t pCallback, void* pArg, int nArg)
+{
+    memset(pTimer, 0, sizeof(drv_socket_timer_t));
+    pTimer->pCallback = pCallback;
+    pTimer->pArg = pArg;
+    pTimer->nArg = nArg;
+}
+
+/* (re)start with an absolute expire tick count - periodic users add the period to the last expire (no drift) */
+void drv_socket_timer_start_at(drv_socket_timer_wheel_t* pWheel, drv_socket_timer_t* pTimer, TickType_t nExpireTicks)
+{
+    drv_socket_timer_stop(pWheel, pTimer);
+    pTimer->nExpireTicks = nExpireTicks;
+    timer_link(pWheel, pTimer, pWheel->nTicks + 1);
+    pTimer->bActive = true;
+    pWheel->nCount++;
+}
+
+void drv_socket_timer_start(drv_socket_timer_wheel_t* pWheel, drv_socket_timer_t* pTimer, TickType_t nDelayTicks)
+{
+    drv_socket_timer_start_at(pWheel, pTimer, xTaskGetTickCount() + nDelayTicks);
+}
+
+void drv_socket_timer_stop(drv_socket_timer_wheel_t* pWheel, drv_socket_timer_t* pTimer)
+{
+    if (pTimer->bActive)
+    {
+        timer_unlink(pWheel, pTimer);
+        pTimer->bActive = false;
+        pWheel->nCount--;
+    }
+}
+
+/* ticks until the timer expires (0 - not active or due) */
+TickType_t drv_socket_timer_remaining(drv_socket_timer_wheel_t* pWheel, drv_socket_timer_t* pTimer)
+{
+    TickType_t nLeft = pTimer->nExpireTicks - xTaskGetTickCount();
+
+    if ((pTimer->bActive == false) || ((int32_t)nLeft <= 0))
+    {
+        return 0;
+    }
+    return nLeft;
+}
+
+/* fire all timers expired up to nTicksNow - empty periods are skipped by the used slot bits */
+void drv_socket_timer_process(drv_socket_timer_wheel_t* pWheel, TickType_t nTicksNow)
+{
+    while ((int32_t)(nTicksNow - pWheel->nTicks) > 0)
+    {
+        TickType_t nLeft = nTicksNow - pWheel->nTicks;
+
+        if (pWheel->nCount == 0)
+        {
+            pWheel->nTicks = nTicksNow;
+            break;
+        }
+
+        TickType_t nStep = DRV_SOCKET_TIMER_SLOTS - (pWheel->nTicks & TIMER_SLOT_MASK);     /* to the next level 0 period */
+        if (pWheel->au64Used[0])
+        {
+            TickType_t nSlotStep = timer_slot_offset(pWheel->au64Used[0], (pWheel->nTicks + 1) & TIMER_SLOT_MASK) + 1;
+            if (nSlotStep < nStep) nStep = nSlotStep;
+        }
+        if (nStep > nLeft) nStep = nLeft;
+
+        TickType_t nNext = pWheel->nTicks + nStep;
+        for (int nLevel = DRV_SOCKET_TIMER_LEVELS - 1; nLevel > 0; nLevel--)
+        {
+            if ((nNext & (((TickType_t)1 << TIMER_LEVEL_SHIFT(nLevel)) - 1)) == 0)
+            {
+                timer_cascade(pWheel, nLevel, nNext);
+            }
+        }
+        pWheel->nTicks = nNext;
+        timer_fire(pWheel, nNext & TIMER_SLOT_MASK);
+    }
+}
+
+/* ticks from now until the next timer (or upper level cascade) is due, limited to nMaxTicks */
+TickType_t drv_socket_timer_next_ticks(drv_socket_timer_wheel_t* pWheel, TickType_t nMaxTicks)
+{
+    TickType_t nNearest = TIMER_RANGE_TICKS;     /* distance from pWheel->nTicks */
+
+    if (pWheel->nCount == 0)
+    {
+        return nMaxTicks;
+    }
+    if (pWheel->au64Used[0])
+    {
+        nNearest = timer_slot_offset(pWheel->au64Used[0], (pWheel->nTicks + 1) & TIMER_SLOT_MASK) + 1;
+    }
+    for (int nLevel = 1; nLevel < DRV_SOCKET_TIMER_LEVELS; nLevel++)
+    {
+        if (pWheel->au64Used[nLevel])
+        {
+            TickType_t nPeriod = pWheel->nTicks >> TIMER_LEVEL_SHIFT(nLevel);
+            int nOffset = timer_slot_offset(pWheel->au64Used[nLevel], (nPeriod + 1) & TIMER_SLOT_MASK);
+            TickType_t nDistance = ((nPeriod + 1 + nOffset) << TIMER_LEVEL_SHIFT(nLevel)) - pWheel->nTicks;
+            if (nDistance < nNearest) nNearest = nDistance;
+        }
+    }
+
+    TickType_t nLeft = pWheel->nTicks + nNearest - xTaskGetTickCount();
+    if ((int32_t)nLeft <= 0)
+    {
+        return 0;
+    }
+    return (nLeft < nMaxTicks) ? nLeft : nMaxTicks;
+}
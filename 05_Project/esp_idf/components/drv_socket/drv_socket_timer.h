@@ -0,0 +1,94 @@
+/* *****************************************************************************
+ * File:   drv_socket_timer.h
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Hierarchical timer wheel (tick resolution, O(1) start and stop)
+ *
+ **************************************************************************** */
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+#define DRV_SOCKET_TIMER_LEVEL_BITS     6
+#define DRV_SOCKET_TIMER_SLOTS          (1 << DRV_SOCKET_TIMER_LEVEL_BITS)     /* slots per level */
+#define DRV_SOCKET_TIMER_LEVELS         3                                       /* 64^3 ticks range - longer timers are cascaded again */
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+/* nArg is the connection index for the per-connection timers, NULL callback - hold-off timer (bActive only) */
+typedef void (*drv_socket_timer_callback_t)(void* pArg, int nArg);
+
+/* timer node - owned by the user (embedded in the connection/runtime), linked in one wheel slot while active */
+typedef struct drv_socket_timer_s
+{
+    struct drv_socket_timer_s* pNext;
+    struct drv_socket_timer_s** ppPrev;     // link pointing to this node
+    TickType_t nExpireTicks;
+    drv_socket_timer_callback_t pCallback;
+    void* pArg;
+    int nArg;
+    bool bActive;
+    uint8_t u8Level;                        // wheel position while active
+    uint8_t u8Slot;
+} drv_socket_timer_t;
+
+typedef struct
+{
+    TickType_t nTicks;                                                          // processed up to
+    int nCount;                                                                 // active timers
+    uint64_t au64Used[DRV_SOCKET_TIMER_LEVELS];                                 // non-empty slots
+    drv_socket_timer_t* apSlot[DRV_SOCKET_TIMER_LEVELS][DRV_SOCKET_TIMER_SLOTS];
+} drv_socket_timer_wheel_t;
+
+/* *****************************************************************************
+ * Function-Like Macro
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Variables External Usage
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function Prototypes
+ **************************************************************************** */
+void drv_socket_timer_wheel_init(drv_socket_timer_wheel_t* pWheel, TickType_t nTicksNow);
+void drv_socket_timer_init(drv_socket_timer_t* pTimer, drv_socket_timer_callback_t pCallback, void* pArg, int nArg);
+void drv_socket_timer_start_at(drv_socket_timer_wheel_t* pWheel, drv_socket_timer_t* pTimer, TickType_t nExpireTicks);
+void drv_socket_timer_start(drv_socket_timer_wheel_t* pWheel, drv_socket_timer_t* pTimer, TickType_t nDelayTicks);
+void drv_socket_timer_stop(drv_socket_timer_wheel_t* pWheel, drv_socket_timer_t* pTimer);
+TickType_t drv_socket_timer_remaining(drv_socket_timer_wheel_t* pWheel, drv_socket_timer_t* pTimer);
+void drv_socket_timer_process(drv_socket_timer_wheel_t* pWheel, TickType_t nTicksNow);
+TickType_t drv_socket_timer_next_ticks(drv_socket_timer_wheel_t* pWheel, TickType_t nMaxTicks);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
@@ -0,0 +1,141 @@
+/* *****************************************************************************
+ * File:   drv_socket_line_bench.c
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Host benchmark of drv_socket_line_crlf_to_cr() against the previous
+ *              shift-per-pair loop (same output checked, also with split chunks)
+ *
+ * Build:  gcc -O2 -I.. drv_socket_line_bench.c ../drv_socket_line.c -o line_bench
+ * Usage:  line_bench [chunk size] [iterations]
+ *
+ **************************************************************************** */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "drv_socket_line.h"
+
+/* previous socket_recv() implementation */
+static int line_shift_loop(uint8_t* au8Temp, int nLength)
+{
+    for (int i = 0; i < nLength; i++)
+    {
+        if (i > 0)
+        {
+            if((au8Temp[i-1] == '\r') && (au8Temp[i] == '\n'))
+            {
+                nLength--;
+                for (int j = i; j < nLength; j++)
+                {
+                    au8Temp[j] = au8Temp[j+1];
+                }
+            }
+            else
+            if((au8Temp[i-1] == '\n') && (au8Temp[i] == '\r'))
+            {
+                nLength--;
+                for (int j = i; j < nLength; j++)
+                {
+                    au8Temp[j] = au8Temp[j+1];
+                }
+            }
+        }
+    }
+    return nLength;
+}
+
+static double time_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* console like text: lines of 10..70 characters, CRLF (sometimes LFCR or a single CR/LF) */
+static void text_fill(uint8_t* pData, int nLength)
+{
+    int index = 0;
+    while (index < nLength)
+    {
+        int nLine = 10 + rand() % 60;
+        for (int i = 0; (i < nLine) && (index < nLength); i++)
+        {
+            pData[index++] = ' ' + rand() % 95;
+        }
+        const char* pEnd = ((rand() % 8) == 0) ? "\n\r" : ((rand() % 8) == 0) ? "\r" : "\r\n";
+        for (int i = 0; pEnd[i] && (index < nLength); i++)
+        {
+            pData[index++] = pEnd[i];
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int nChunk = (argc > 1) ? atoi(argv[1]) : 1460;
+    int nIterations = (argc > 2) ? atoi(argv[2]) : 20000;
+    uint8_t* pSource = malloc(nChunk);
+    uint8_t* pOld = malloc(nChunk);
+    uint8_t* pNew = malloc(nChunk);
+    int nLengthOld = 0;
+    int nLengthNew = 0;
+
+    srand(1);
+    text_fill(pSource, nChunk);
+
+    /* same result on a single chunk */
+    memcpy(pOld, pSource, nChunk);
+    memcpy(pNew, pSource, nChunk);
+    uint8_t u8Prev = 0;
+    nLengthOld = line_shift_loop(pOld, nChunk);
+    nLengthNew = drv_socket_line_crlf_to_cr(pNew, nChunk, &u8Prev);
+    if ((nLengthOld != nLengthNew) || memcmp(pOld, pNew, nLengthOld))
+    {
+        printf("FAIL: single chunk output differs (%d/%d bytes)\n", nLengthOld, nLengthNew);
+        return 1;
+    }
+
+    /* same result when split at every position */
+    for (int nSplit = 1; nSplit < nChunk; nSplit++)
+    {
+        memcpy(pNew, pSource, nChunk);
+        u8Prev = 0;
+        int nFirst = drv_socket_line_crlf_to_cr(pNew, nSplit, &u8Prev);
+        int nSecond = drv_socket_line_crlf_to_cr(&pNew[nSplit], nChunk - nSplit, &u8Prev);
+        memmove(&pNew[nFirst], &pNew[nSplit], nSecond);
+        if (((nFirst + nSecond) != nLengthOld) || memcmp(pOld, pNew, nLengthOld))
+        {
+            printf("FAIL: split at %d differs\n", nSplit);
+            return 1;
+        }
+    }
+
+    double fStart = time_now();
+    for (int i = 0; i < nIterations; i++)
+    {
+        memcpy(pOld, pSource, nChunk);
+        nLengthOld = line_shift_loop(pOld, nChunk);
+    }
+    double fOld = time_now() - fStart;
+
+    fStart = time_now();
+    for (int i = 0; i < nIterations; i++)
+    {
+        memcpy(pNew, pSource, nChunk);
+        u8Prev = 0;
+        nLengthNew = drv_socket_line_crlf_to_cr(pNew, nChunk, &u8Prev);
+    }
+    double fNew = time_now() - fStart;
+
+    double fMBytes = (double)nChunk * nIterations / 1e6;
+    printf("chunk %d bytes -> %d, %d iterations\n", nChunk, nLengthNew, nIterations);
+    printf("shift loop : %8.1f MB/s\n", fMBytes / fOld);
+    printf("compaction : %8.1f MB/s (x%.1f)\n", fMBytes / fNew, fOld / fNew);
+    free(pSource);
+    free(pOld);
+    free(pNew);
+    return 0;
+}
@@ -22,6 +22,8 @@
 #include "freertos/semphr.h"
 #include "esp_log.h"
 
+#include "drv_trace_if.h"
+
 /* *****************************************************************************
  * Configuration Definitions
  **************************************************************************** */
@@ -35,6 +37,10 @@
 
 #define DRV_STREAM_COUNT_MAX            20
 
+#ifndef CONFIG_STREAM_TRACE_LEVEL
+#define CONFIG_STREAM_TRACE_LEVEL       DRV_TRACE_LEVEL_NONE
+#endif
+
 void esp_log_write_custom(esp_log_level_t level,
                    const char *tag,
                    const char *format, ...);
@@ -74,6 +80,7 @@ void esp_log_write_custom(esp_log_level_t level,
 /* *****************************************************************************
  * Function-Like Macros
  **************************************************************************** */
+#define STREAM_TRACE(nLevel, eEvent, psStream, a0, a1) DRV_TRACE(CONFIG_STREAM_TRACE_LEVEL, DRV_TRACE_COMPONENT_STREAM, nLevel, eEvent, psStream, a0, a1, 0)
 int drv_stream_push_log_message(char* pdata, int nSize);
 int drv_stream_pull_log_message(char* pdata, int nSize);
 int log_vprintf_stream(const char *fmt, va_list args);
@@ -226,6 +233,9 @@ void drv_stream_init(drv_stream_t* psStream, uint8_t* pBuffer, size_t nLength)
     }
     psStream->pStream = NULL;
     psStream->nLength = 0;
+    psStream->onPush = NULL;        /* a re-used stream does not wake the previous owner */
+    psStream->pOnPushArg = NULL;
+    DRV_TRACE_NAME(psStream, psStream->cName);
 
 
     if (nLength > 0)
@@ -278,11 +288,13 @@ size_t drv_stream_push(drv_stream_t* psStream, uint8_t* pData, size_t nSize)
         {
             int bytesRemove = (nSize + psStream->nLength) - (psStream->nLengthMax - DRV_STREAM_REMOVE_EXTRA_ON_SKIP);
             ESP_LOGF(TAG, "Stream %s Skipped %d/%d bytes", psStream->cName, bytesRemove, nSize + psStream->nLength);
+            STREAM_TRACE(DRV_TRACE_LEVEL_ERROR, DRV_STREAM_TRACE_SKIP, psStream, bytesRemove, nSize + psStream->nLength);
             stream_pull_internal(psStream, NULL, bytesRemove);
         }
         else if((nSize + psStream->nLength) > (psStream->nLengthMax - DRV_STREAM_REMOVE_EXTRA_ON_SKIP))
         {
             ESP_LOGP(TAG, "Stream %s Warning %d/%d bytes", psStream->cName, nSize + psStream->nLength, psStream->nLengthMax);
+            STREAM_TRACE(DRV_TRACE_LEVEL_INFO, DRV_STREAM_TRACE_WARNING, psStream, nSize + psStream->nLength, psStream->nLengthMax);
         }
     }
     if (psStream->bRingBuffer)
@@ -311,7 +323,9 @@ size_t drv_stream_push(drv_stream_t* psStream, uint8_t* pData, size_t nSize)
         else
         {
             ESP_LOGF(TAG, "Failure not enough memory available for drv_stream_push");
+            STREAM_TRACE(DRV_TRACE_LEVEL_ERROR, DRV_STREAM_TRACE_NO_MEMORY, psStream, nSize, 0);
         }
+        STREAM_TRACE(DRV_TRACE_LEVEL_DEBUG, DRV_STREAM_TRACE_PUSH, psStream, nResult, psStream->nLength);
 
 #if 0
         uint8_t* pNewStream = (uint8_t*)malloc(nSize + psStream->nLength);
@@ -339,6 +353,10 @@ size_t drv_stream_push(drv_stream_t* psStream, uint8_t* pData, size_t nSize)
 
     }
     xSemaphoreGive(psStream->flag_available);
+    if ((nResult > 0) && (psStream->onPush != NULL))
+    {
+        psStream->onPush(psStream->pOnPushArg);
+    }
     return nResult;
 }
 
@@ -449,6 +467,7 @@ size_t drv_stream_pull(drv_stream_t* psStream, uint8_t* pData, size_t nSize)
     }
     xSemaphoreTake(psStream->flag_available, portMAX_DELAY);
     size_t nResult = stream_pull_internal(psStream, pData, nSize);
+    STREAM_TRACE(DRV_TRACE_LEVEL_DEBUG, DRV_STREAM_TRACE_PULL, psStream, nSize, nResult);
     xSemaphoreGive(psStream->flag_available);
     return nResult;
 }
@@ -534,4 +553,14 @@ int drv_stream_get_free(drv_stream_t* pStream)
         }
     }
     return result;
+}
+
+void drv_stream_set_on_push(drv_stream_t* pStream, drv_stream_on_push_t onPush, void* pArg)
+{
+    if (pStream != NULL)
+    {
+        pStream->onPush = NULL;
+        pStream->pOnPushArg = pArg;
+        pStream->onPush = onPush;
+    }
 }
\ No newline at end of file
@@ -35,10 +35,21 @@ extern "C"
 /* *****************************************************************************
  * Enumeration Definitions
  **************************************************************************** */
+/* trace events - keep in sync with drv_trace/tools/drv_trace_decode.py */
+typedef enum
+{
+    DRV_STREAM_TRACE_PUSH,                  // size, length after
+    DRV_STREAM_TRACE_PULL,                  // requested, pulled
+    DRV_STREAM_TRACE_SKIP,                  // removed, length requested
+    DRV_STREAM_TRACE_WARNING,               // length requested, length max
+    DRV_STREAM_TRACE_NO_MEMORY,             // size
+} drv_stream_trace_event_t;
 
 /* *****************************************************************************
  * Type Definitions
  **************************************************************************** */
+typedef void (*drv_stream_on_push_t)(void* pArg);
+
 typedef struct
 {
     char cName[16];
@@ -47,6 +58,8 @@ typedef struct
     bool bRingBuffer;
     SemaphoreHandle_t flag_available;
     size_t nLengthMax;
+    drv_stream_on_push_t onPush;        /* called after successful push (used to wake the stream consumer) */
+    void* pOnPushArg;
 } drv_stream_t;
 
 /* *****************************************************************************
@@ -69,6 +82,7 @@ int drv_stream_get_position(const char* name);
 drv_stream_t* drv_stream_get_handle(const char* name);
 int drv_stream_get_size(drv_stream_t* pStream);
 int drv_stream_get_free(drv_stream_t* pStream);
+void drv_stream_set_on_push(drv_stream_t* pStream, drv_stream_on_push_t onPush, void* pArg);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,124 @@
+/* *****************************************************************************
+ * File:   cmd_trace.c
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ * 
+ * Description: Trace ring console commands
+ * 
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include "cmd_trace.h"
+#include "drv_trace.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_console.h"
+#include "esp_system.h"
+
+#include "argtable3/argtable3.h"
+
+#include "drv_console_if.h"
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+#define TAG "cmd_trace"
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function-Like Macros
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Variables Definitions
+ **************************************************************************** */
+
+static struct {
+    struct arg_str *command;
+    struct arg_end *end;
+} trace_args;
+
+
+/* *****************************************************************************
+ * Prototype of functions definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Functions
+ **************************************************************************** */
+static int update_trace(int argc, char **argv)
+{
+    drv_console_set_other_log_disabled();
+
+    int nerrors = arg_parse(argc, argv, (void **)&trace_args);
+    if (nerrors != ESP_OK)
+    {
+        arg_print_errors(stderr, trace_args.end, argv[0]);
+        return ESP_FAIL;
+    }
+
+    const char* trace_command = trace_args.command->sval[0];
+    if (strcmp(trace_command,"dump") == 0)
+    {
+        drv_trace_dump();
+    }
+    else
+    if (strcmp(trace_command,"clear") == 0)
+    {
+        drv_trace_clear();
+    }
+    else
+    if (strcmp(trace_command,"start") == 0)
+    {
+        drv_trace_enable(true);
+    }
+    else
+    if (strcmp(trace_command,"stop") == 0)
+    {
+        drv_trace_enable(false);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Error Trace command %s not supported", trace_command);
+    }
+
+    return 0;
+}
+
+static void register_trace(void)
+{
+    trace_args.command = arg_strn(NULL, NULL, "<command>", 1, 1, "Command can be : trace {dump|clear|start|stop}");
+    trace_args.end = arg_end(2);
+
+    const esp_console_cmd_t cmd_trace = {
+        .command = "trace",
+        .help = "Trace Ring Manage Request",
+        .hint = NULL,
+        .func = &update_trace,
+        .argtable = &trace_args,
+    };
+
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd_trace));
+}
+
+
+void cmd_trace_register(void)
+{
+    register_trace();
+}
@@ -0,0 +1,184 @@
+/* *****************************************************************************
+ * File:   drv_trace.c
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Compile-time gated binary trace points (RAM ring)
+ *
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include "drv_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+#define TAG "drv_trace"
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+#define DRV_TRACE_NAME_COUNT_MAX    32
+#define DRV_TRACE_FORMAT_VERSION    1
+
+#if (CONFIG_DRV_TRACE_RECORD_COUNT & (CONFIG_DRV_TRACE_RECORD_COUNT - 1)) != 0
+#error "CONFIG_DRV_TRACE_RECORD_COUNT must be a power of 2"
+#endif
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+typedef struct
+{
+    uint32_t u32Key;
+    const char* pName;
+} drv_trace_name_t;
+
+/* *****************************************************************************
+ * Function-Like Macros
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Variables Definitions
+ **************************************************************************** */
+#if CONFIG_DRV_TRACE_ENABLE
+static drv_trace_record_t asTraceRing[CONFIG_DRV_TRACE_RECORD_COUNT];
+static uint32_t u32TraceWriteCount = 0;     /* total records written (ring position is the low bits) */
+static bool bTraceEnabled = true;
+static drv_trace_name_t asTraceName[DRV_TRACE_NAME_COUNT_MAX];
+static int nTraceNameCount = 0;
+static portMUX_TYPE trace_mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+/* *****************************************************************************
+ * Prototype of functions definitions
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Functions
+ **************************************************************************** */
+void drv_trace_write(uint8_t u8Component, uint8_t u8Level, uint16_t u16Event, uint32_t u32Key, uint32_t u32Arg0, uint32_t u32Arg1, uint32_t u32Arg2)
+{
+#if CONFIG_DRV_TRACE_ENABLE
+    uint32_t u32TimeUs = (uint32_t)esp_timer_get_time();
+
+    portENTER_CRITICAL_SAFE(&trace_mux);
+    if (bTraceEnabled)
+    {
+        drv_trace_record_t* pRecord = &asTraceRing[u32TraceWriteCount & (CONFIG_DRV_TRACE_RECORD_COUNT - 1)];
+        u32TraceWriteCount++;
+        pRecord->u32TimeUs = u32TimeUs;
+        pRecord->u16Event = u16Event;
+        pRecord->u8Component = u8Component;
+        pRecord->u8Level = u8Level;
+        pRecord->u32Key = u32Key;
+        pRecord->au32Arg[0] = u32Arg0;
+        pRecord->au32Arg[1] = u32Arg1;
+        pRecord->au32Arg[2] = u32Arg2;
+    }
+    portEXIT_CRITICAL_SAFE(&trace_mux);
+#endif
+}
+
+/* pName must stay valid (object name storage) - used by the decoder only */
+void drv_trace_set_name(uint32_t u32Key, const char* pName)
+{
+#if CONFIG_DRV_TRACE_ENABLE
+    portENTER_CRITICAL(&trace_mux);
+    int index;
+    for (index = 0; index < nTraceNameCount; index++)
+    {
+        if (asTraceName[index].u32Key == u32Key)
+        {
+            break;
+        }
+    }
+    if (index < DRV_TRACE_NAME_COUNT_MAX)
+    {
+        asTraceName[index].u32Key = u32Key;
+        asTraceName[index].pName = pName;
+        if (index == nTraceNameCount)
+        {
+            nTraceNameCount++;
+        }
+    }
+    portEXIT_CRITICAL(&trace_mux);
+#endif
+}
+
+void drv_trace_enable(bool bEnable)
+{
+#if CONFIG_DRV_TRACE_ENABLE
+    portENTER_CRITICAL(&trace_mux);
+    bTraceEnabled = bEnable;
+    portEXIT_CRITICAL(&trace_mux);
+#endif
+}
+
+void drv_trace_clear(void)
+{
+#if CONFIG_DRV_TRACE_ENABLE
+    portENTER_CRITICAL(&trace_mux);
+    u32TraceWriteCount = 0;
+    portEXIT_CRITICAL(&trace_mux);
+#endif
+}
+
+/*
+ * Text dump for tools/drv_trace_decode.py:
+ *   TRACE BEGIN <version> <record size> <records> <total written>
+ *   TRACE N <key> <name>
+ *   TRACE R <record hex, little endian>
+ *   TRACE END
+ */
+void drv_trace_dump(void)
+{
+#if CONFIG_DRV_TRACE_ENABLE
+    bool bEnabledBefore;
+
+    /* stop writers while dumping (printing is slow) */
+    portENTER_CRITICAL(&trace_mux);
+    bEnabledBefore = bTraceEnabled;
+    bTraceEnabled = false;
+    portEXIT_CRITICAL(&trace_mux);
+
+    uint32_t u32Total = u32TraceWriteCount;
+    uint32_t u32Count = (u32Total < CONFIG_DRV_TRACE_RECORD_COUNT) ? u32Total : CONFIG_DRV_TRACE_RECORD_COUNT;
+
+    printf("TRACE BEGIN %d %d %u %u\n", DRV_TRACE_FORMAT_VERSION, (int)sizeof(drv_trace_record_t), (unsigned)u32Count, (unsigned)u32Total);
+    for (int index = 0; index < nTraceNameCount; index++)
+    {
+        printf("TRACE N %08X %s\n", (unsigned)asTraceName[index].u32Key, asTraceName[index].pName);
+    }
+    for (uint32_t u32Index = u32Total - u32Count; u32Index != u32Total; u32Index++)
+    {
+        uint8_t* pData = (uint8_t*)&asTraceRing[u32Index & (CONFIG_DRV_TRACE_RECORD_COUNT - 1)];
+        printf("TRACE R ");
+        for (int nByte = 0; nByte < sizeof(drv_trace_record_t); nByte++)
+        {
+            printf("%02X", pData[nByte]);
+        }
+        printf("\n");
+    }
+    printf("TRACE END\n");
+
+    drv_trace_enable(bEnabledBefore);
+#else
+    ESP_LOGW(TAG, "Trace points disabled (CONFIG_DRV_TRACE_ENABLE)");
+#endif
+}
@@ -0,0 +1,112 @@
+/* *****************************************************************************
+ * File:   drv_trace.h
+ * Author: Dimitar Lilov
+ *
+ * Created on 2022 06 18
+ *
+ * Description: Compile-time gated binary trace points (RAM ring)
+ *
+ **************************************************************************** */
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/* *****************************************************************************
+ * Header Includes
+ **************************************************************************** */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+
+/* *****************************************************************************
+ * Configuration Definitions
+ **************************************************************************** */
+#ifndef CONFIG_DRV_TRACE_ENABLE
+#define CONFIG_DRV_TRACE_ENABLE         0
+#endif
+
+#ifndef CONFIG_DRV_TRACE_RECORD_COUNT
+#define CONFIG_DRV_TRACE_RECORD_COUNT   256
+#endif
+
+/* *****************************************************************************
+ * Constants and Macros Definitions
+ **************************************************************************** */
+#define DRV_TRACE_LEVEL_NONE    0
+#define DRV_TRACE_LEVEL_ERROR   1
+#define DRV_TRACE_LEVEL_INFO    2
+#define DRV_TRACE_LEVEL_DEBUG   3
+
+/* *****************************************************************************
+ * Enumeration Definitions
+ **************************************************************************** */
+/* component identifiers - keep in sync with tools/drv_trace_decode.py */
+typedef enum
+{
+    DRV_TRACE_COMPONENT_NONE,
+    DRV_TRACE_COMPONENT_SOCKET,
+    DRV_TRACE_COMPONENT_STREAM,
+} drv_trace_component_t;
+
+/* *****************************************************************************
+ * Type Definitions
+ **************************************************************************** */
+typedef struct
+{
+    uint32_t u32TimeUs;                     // esp_timer low 32 bits
+    uint16_t u16Event;                      // component specific event
+    uint8_t u8Component;                    // drv_trace_component_t
+    uint8_t u8Level;
+    uint32_t u32Key;                        // object (see drv_trace_set_name)
+    uint32_t au32Arg[3];
+} drv_trace_record_t;
+
+/* *****************************************************************************
+ * Function-Like Macro
+ **************************************************************************** */
+/*
+ * nComponentLevel is the component configured level (compile time constant)
+ * so disabled levels are removed by the compiler. With CONFIG_DRV_TRACE_ENABLE
+ * not set the arguments are never evaluated and nothing is generated.
+ */
+#if CONFIG_DRV_TRACE_ENABLE
+#define DRV_TRACE(nComponentLevel, eComponent, nLevel, eEvent, pKey, a0, a1, a2) do {  \
+        if ((nLevel) <= (nComponentLevel))                                              \
+        {                                                                               \
+            drv_trace_write((eComponent), (nLevel), (eEvent), (uint32_t)(uintptr_t)(pKey), \
+                            (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2));            \
+        }                                                                               \
+    } while(0)
+#define DRV_TRACE_NAME(pKey, pName)     drv_trace_set_name((uint32_t)(uintptr_t)(pKey), (pName))
+#else
+#define DRV_TRACE(nComponentLevel, eComponent, nLevel, eEvent, pKey, a0, a1, a2) do {  \
+        if (0) { (void)(pKey); (void)(a0); (void)(a1); (void)(a2); }                    \
+    } while(0)
+#define DRV_TRACE_NAME(pKey, pName)     do { if (0) { (void)(pKey); (void)(pName); } } while(0)
+#endif
+
+/* *****************************************************************************
+ * Variables External Usage
+ **************************************************************************** */
+
+/* *****************************************************************************
+ * Function Prototypes
+ **************************************************************************** */
+void drv_trace_write(uint8_t u8Component, uint8_t u8Level, uint16_t u16Event, uint32_t u32Key, uint32_t u32Arg0, uint32_t u32Arg1, uint32_t u32Arg2);
+void drv_trace_set_name(uint32_t u32Key, const char* pName);
+void drv_trace_enable(bool bEnable);
+void drv_trace_clear(void);
+void drv_trace_dump(void);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+# *****************************************************************************
+# File:   drv_trace_decode.py
+# Author: Dimitar Lilov
+#
+# Created on 2022 06 18
+#
+# Description: Decode "trace dump" console output (drv_trace ring)
+#
+# Usage: drv_trace_decode.py [log file]    (stdin if not given)
+#
+# *****************************************************************************
+import socket
+import struct
+import sys
+
+RECORD_FORMAT = "<IHBBIIII"
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+LEVELS = {0: "-", 1: "E", 2: "I", 3: "D"}
+
+# keep in sync with drv_trace_component_t (drv_trace.h)
+COMPONENT_SOCKET = 1
+COMPONENT_STREAM = 2
+
+
+def ip4(value):
+    return socket.inet_ntoa(struct.pack("<I", value))
+
+
+def connection(value):
+    return "[%d] %d" % (value >> 16, value & 0xFFFF)
+
+
+# keep in sync with drv_socket_trace_event_t (drv_socket.h)
+SOCKET_EVENTS = {
+    0: ("recv_peek", lambda a: "%s length %d" % (connection(a[0]), a[1])),
+    1: ("recv_from", lambda a: "%s from %s:%d" % (connection(a[0]), ip4(a[1]), a[2])),
+    2: ("recv_process", lambda a: "%s onReceive %d/%d bytes" % (connection(a[0]), a[1], a[2])),
+    3: ("recv_push", lambda a: "%s push %d bytes -> %d" % (connection(a[0]), a[1], a[2])),
+    4: ("send_to", lambda a: "%s to %s:%d" % (connection(a[0]), ip4(a[1]), a[2])),
+    5: ("send", lambda a: "%s sent %d/%d bytes" % (connection(a[0]), struct.unpack("<i", struct.pack("<I", a[1]))[0], a[2])),
+    6: ("dgram_recv", lambda a: "%s datagram %d bytes -> %d queued" % (connection(a[0]), a[1], a[2])),
+}
+
+# keep in sync with drv_stream_trace_event_t (drv_stream.h)
+STREAM_EVENTS = {
+    0: ("push", lambda a: "%d bytes -> %d" % (a[0], a[1])),
+    1: ("pull", lambda a: "%d/%d bytes" % (a[1], a[0])),
+    2: ("skip", lambda a: "removed %d/%d bytes" % (a[0], a[1])),
+    3: ("warning", lambda a: "%d/%d bytes" % (a[0], a[1])),
+    4: ("no_memory", lambda a: "%d bytes" % (a[0])),
+}
+
+COMPONENTS = {
+    COMPONENT_SOCKET: ("socket", SOCKET_EVENTS),
+    COMPONENT_STREAM: ("stream", STREAM_EVENTS),
+}
+
+
+def decode(lines):
+    names = {}
+    records = []
+    for line in lines:
+        position = line.find("TRACE ")
+        if position < 0:
+            continue
+        fields = line[position:].split()
+        if len(fields) < 2:
+            continue
+        if fields[1] == "BEGIN":
+            names = {}
+            records = []
+            if len(fields) >= 4 and int(fields[3]) != RECORD_SIZE:
+                sys.exit("record size %s not supported (expected %d)" % (fields[3], RECORD_SIZE))
+        elif fields[1] == "N" and len(fields) >= 4:
+            names[int(fields[2], 16)] = fields[3]
+        elif fields[1] == "R" and len(fields) >= 3:
+            records.append(struct.unpack(RECORD_FORMAT, bytes.fromhex(fields[2])))
+        elif fields[1] == "END":
+            break
+
+    time_high = 0
+    time_last = None
+    time_first = None
+    for (time_us, event, component, level, key, arg0, arg1, arg2) in records:
+        # unwrap the 32 bit microsecond timestamp
+        if time_last is not None and time_us < time_last:
+            time_high += 1 << 32
+        time_last = time_us
+        time_full = time_high + time_us
+        if time_first is None:
+            time_first = time_full
+
+        component_name, events = COMPONENTS.get(component, ("comp%d" % component, {}))
+        event_name, formatter = events.get(event, ("event%d" % event, lambda a: "%08X %08X %08X" % tuple(a)))
+        print("%12.6f %s %-6s %-10s %-12s %s" % (
+            (time_full - time_first) / 1000000.0,
+            LEVELS.get(level, "?"),
+            component_name,
+            names.get(key, "%08X" % key),
+            event_name,
+            formatter((arg0, arg1, arg2))))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], errors="replace") as log:
+            decode(log)
+    else:
+        decode(sys.stdin)